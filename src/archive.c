@@ -7,26 +7,86 @@
 #include "archive.h"
 #include "main.h"
 	
-//Archive structure
+//Archive structures
+#define ARCHIVE_MAGIC 0x32524100 //"\0AR2", can't be the start of a v1 name
+
 typedef struct
 {
 	char path[12];
 	u32 pos;
 } ArchiveFile;
 
+typedef struct
+{
+	u32 magic;
+	u16 files, mask;
+	u16 table[0]; //mask + 1 (a power of 2, at least 2) entries of file index + 1 (0 if empty), followed by the files
+} ArchiveHeader;
+
+typedef struct
+{
+	u32 hash;
+	u32 pos, size;
+	char path[12];
+} ArchiveFile2;
+
 //Archive functions
-IO_Data Archive_Find(IO_Data arc, const char *path)
+u32 Archive_Hash(const char *path)
 {
-	//Check against all archive files
-	for (const ArchiveFile *file = (const ArchiveFile*)arc; file->path[0] != '\0'; file++)
+	//Hash the 12 byte zero padded name
+	u32 hash = ARCHIVE_HASH_BASIS;
+	for (int i = 0; i < 12; i++)
+	{
+		hash = (hash ^ (u8)*path) * ARCHIVE_HASH_PRIME;
+		if (*path != '\0')
+			path++;
+	}
+	return hash;
+}
+
+static const ArchiveFile2 *Archive_Probe(IO_Data arc, u32 hash)
+{
+	//Probe hash table until an empty slot
+	const ArchiveHeader *header = (const ArchiveHeader*)arc;
+	const ArchiveFile2 *files = (const ArchiveFile2*)(header->table + header->mask + 1);
+	
+	for (u16 i = hash & header->mask;; i = (i + 1) & header->mask)
+	{
+		u16 index = header->table[i];
+		if (index == 0)
+			return NULL;
+		
+		const ArchiveFile2 *file = &files[index - 1];
+		if (file->hash == hash)
+			return file;
+	}
+}
+
+IO_Data Archive_FindHash(IO_Data arc, u32 hash)
+{
+	if (*((const u32*)arc) == ARCHIVE_MAGIC)
+	{
+		//Look up in hash table
+		const ArchiveFile2 *file = Archive_Probe(arc, hash);
+		if (file != NULL)
+			return (IO_Data)((u8*)arc + file->pos);
+	}
+	else
 	{
-		if (strncmp(file->path, path, 12))
-			continue;
-		return (IO_Data)((u8*)arc + file->pos);
+		//Hash all archive files
+		for (const ArchiveFile *file = (const ArchiveFile*)arc; file->path[0] != '\0'; file++)
+		{
+			char path[13];
+			memcpy(path, file->path, 12);
+			path[12] = '\0';
+			if (Archive_Hash(path) != hash)
+				continue;
+			return (IO_Data)((u8*)arc + file->pos);
+		}
 	}
 	
 	//Failed to find the requested file
-	sprintf(error_msg, "[Archive_Find] Failed to find %s in %p", path, (void*)arc);
+	sprintf(error_msg, "[Archive_FindHash] Failed to find %08X in %p", (unsigned int)hash, (void*)arc);
 	ErrorLock();
 	return NULL;
 }
@@ -9,7 +9,25 @@
 
 #include "io.h"
 
+//Archive name hash (FNV-1a over the 12 byte, zero padded name, must match funkinarcpak)
+#define ARCHIVE_HASH_BASIS 0x811C9DC5
+#define ARCHIVE_HASH_PRIME 0x01000193
+
+#define ARCHIVE_HASH_C(s, i) ((u32)(u8)((i) < sizeof(s) ? (s)[(i) < sizeof(s) ? (i) : 0] : '\0'))
+#define ARCHIVE_HASH_S(h, s, i) (((h) ^ ARCHIVE_HASH_C(s, i)) * ARCHIVE_HASH_PRIME)
+
+//Hashes a string literal at compile time, use with Archive_FindHash
+#define ARCHIVE_HASH(s) \
+	ARCHIVE_HASH_S(ARCHIVE_HASH_S(ARCHIVE_HASH_S(ARCHIVE_HASH_S( \
+	ARCHIVE_HASH_S(ARCHIVE_HASH_S(ARCHIVE_HASH_S(ARCHIVE_HASH_S( \
+	ARCHIVE_HASH_S(ARCHIVE_HASH_S(ARCHIVE_HASH_S(ARCHIVE_HASH_S( \
+	(u32)ARCHIVE_HASH_BASIS, \
+	s, 0), s, 1), s, 2), s, 3), \
+	s, 4), s, 5), s, 6), s, 7), \
+	s, 8), s, 9), s, 10), s, 11)
+
 //Archive functions
-IO_Data Archive_Find(IO_Data arc, const char *path);
+u32 Archive_Hash(const char *path);
+IO_Data Archive_FindHash(IO_Data arc, u32 hash);
 
 #endif
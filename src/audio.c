@@ -7,6 +7,7 @@
 #include "audio.h"
 
 #include "io.h"
+#include "mem.h"
 #include "main.h"
 
 //XA state
@@ -16,6 +17,7 @@
 #define XA_STATE_SEEKING (1 << 3)
 static u8 xa_state, xa_resync, xa_volume, xa_channel;
 static u32 xa_pos, xa_start, xa_end;
+static u32 xa_first; //Sectors from the start of the XA file to the playing track's first sector
 
 //audio stuff
 #define BUFFER_SIZE (13 << 11) //13 sectors
@@ -53,12 +55,66 @@ static volatile u32 audio_alloc_ptr = 0;
 
 //XA files and tracks
 static CdlFILE xa_files[XA_Max];
+static u32 xa_lengths[XA_TrackMax]; //In sectors, from the start of the XA file to the end of the track
+static u32 xa_firsts[XA_TrackMax];  //In sectors, from the start of the XA file to the track's first sector
 
 #include "audio_def.h"
 
+//XA index, written by xainterleave next to each XA file
+typedef struct
+{
+	u8 channel, file, pad[2];
+	u32 start, end; //Sectors, relative to the start of the XA file
+	u32 sectors, samples;
+} XA_IndexChannel;
+
+typedef struct
+{
+	u32 magic;
+	u32 channels;
+	XA_IndexChannel channel[0];
+} XA_Index;
+
+static void Audio_LoadXAIndex(XA_File file, const char *path)
+{
+	//Read index
+	IO_Data data = IO_Read(path);
+	const XA_Index *index = (const XA_Index*)data;
+	if (index->magic != XA_INDEX_MAGIC)
+	{
+		sprintf(error_msg, "[Audio_LoadXAIndex] %s isn't an XA index", path);
+		ErrorLock();
+		return;
+	}
+	
+	//Tracks start with the first sector of their first channel and end with the last sector of their last channel
+	for (int i = 0; i < XA_TrackMax; i++)
+	{
+		if (xa_tracks[i].file != file)
+			continue;
+		u8 channel_end = (i + 1 < XA_TrackMax && xa_tracks[i + 1].file == file) ? xa_tracks[i + 1].channel : 32;
+		
+		u32 first = 0xFFFFFFFF, length = 0;
+		for (u32 j = 0; j < index->channels; j++)
+		{
+			const XA_IndexChannel *channel = &index->channel[j];
+			if (channel->channel < xa_tracks[i].channel || channel->channel >= channel_end)
+				continue;
+			if (channel->start < first)
+				first = channel->start;
+			if (channel->end > length)
+				length = channel->end;
+		}
+		xa_firsts[i] = (first != 0xFFFFFFFF) ? first : 0;
+		xa_lengths[i] = length;
+	}
+	
+	Mem_Free(data);
+}
+
 u32 Audio_GetLength(XA_Track lengthtrack)
 {
-	return (xa_tracks[lengthtrack].length / 75) / IO_SECT_SIZE;
+	return xa_lengths[lengthtrack] / 75;
 }
 
 //Internal XA functions
@@ -185,6 +241,10 @@ void Audio_Init(void)
 	CdlFILE *filep = xa_files;
 	for (const char **pathp = xa_paths; *pathp != NULL; pathp++)
 		IO_FindFile(filep++, *pathp);
+	
+	//Get track lengths
+	for (int i = 0; xa_index_paths[i] != NULL; i++)
+		Audio_LoadXAIndex((XA_File)i, xa_index_paths[i]);
 }
 
 void Audio_Quit(void)
@@ -196,7 +256,7 @@ static void Audio_GetXAFile(CdlFILE *file, XA_Track track)
 {
 	const XA_TrackDef *track_def = &xa_tracks[track];
 	file->pos = xa_files[track_def->file].pos;
-	file->size = track_def->length;
+	file->size = xa_lengths[track] * IO_SECT_SIZE;
 }
 
 static void Audio_PlayXA_File(CdlFILE *file, u8 volume, u8 channel, boolean loop)
@@ -227,6 +287,7 @@ void Audio_PlayXA_Track(XA_Track track, u8 volume, u8 channel, boolean loop)
 
 	//Play track
 	Audio_PlayXA_File(&file, volume, channel, loop);
+	xa_first = xa_firsts[track];
 }
 
 void Audio_SeekXA_Track(XA_Track track)
@@ -237,6 +298,23 @@ void Audio_SeekXA_Track(XA_Track track)
 	IO_SeekFile(&file);
 }
 
+void Audio_SeekXA_Milli(u32 milli)
+{
+	//Get the sector being read at the given time into the track, at 75 sectors a second
+	xa_pos = xa_start + xa_first + milli * 75 / 1000;
+	if (xa_pos > xa_end)
+		xa_pos = xa_end;
+	
+	//Seek there now if playing, otherwise Audio_ResumeXA plays from there
+	if (xa_state & XA_STATE_PLAYING)
+	{
+		CdlLOC cd_loc;
+		CdIntToPos(xa_pos, &cd_loc);
+		CdControlB(CdlSeekL, (u8*)&cd_loc, NULL);
+		xa_state |= XA_STATE_SEEKING;
+	}
+}
+
 void Audio_PauseXA(void)
 {
 	//Pause playing XA file
@@ -263,13 +341,13 @@ void Audio_ChannelXA(u8 channel)
 
 s32 Audio_TellXA_Sector(void)
 {
-	//Get CD position
-	return (s32)xa_pos - (s32)xa_start; //Meh casting
+	//Get CD position, from the track's first sector
+	return (s32)xa_pos - (s32)(xa_start + xa_first); //Meh casting
 }
 
 s32 Audio_TellXA_Milli(void)
 {
-	return ((s32)xa_pos - (s32)xa_start) * 1000 / 75; //1000 / (75 * speed (1x))
+	return Audio_TellXA_Sector() * 1000 / 75; //1000 / (75 * speed (1x))
 }
 
 boolean Audio_PlayingXA(void)
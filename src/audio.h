@@ -78,8 +78,10 @@ typedef enum
 //Audio functions
 void Audio_Init(void);
 void Audio_Quit(void);
+u32 Audio_GetLength(XA_Track lengthtrack);
 void Audio_PlayXA_Track(XA_Track track, u8 volume, u8 channel, boolean loop);
 void Audio_SeekXA_Track(XA_Track track);
+void Audio_SeekXA_Milli(u32 milli);
 void Audio_PauseXA(void);
 void Audio_ResumeXA(void);
 void Audio_StopXA(void);
@@ -1,48 +1,48 @@
-#define XA_LENGTH(x) (((u64)(x) * 75) / 100 * IO_SECT_SIZE) //Centiseconds to sectors in bytes (w)
+#define XA_INDEX_MAGIC 0x31494158 //"XAI1"
 
 typedef struct
 {
 	XA_File file;
-	u32 length;
+	u8 channel; //First XA channel, the track also uses the channels up to the next track's
 } XA_TrackDef;
 
 static const XA_TrackDef xa_tracks[] = {
 	//MENU.XA
-	{XA_Menu, XA_LENGTH(11295)}, //XA_GettinFreaky
-	{XA_Menu, XA_LENGTH(3840)},  //XA_GameOver
+	{XA_Menu, 0}, //XA_GettinFreaky
+	{XA_Menu, 1}, //XA_GameOver
 	//WEEK1A.XA
-	{XA_Week1A, XA_LENGTH(7700)}, //XA_Bopeebo
-	{XA_Week1A, XA_LENGTH(8000)}, //XA_Fresh
+	{XA_Week1A, 0}, //XA_Bopeebo
+	{XA_Week1A, 2}, //XA_Fresh
 	//WEEK1B.XA
-	{XA_Week1B, XA_LENGTH(8700)}, //XA_Dadbattle
-	{XA_Week1B, XA_LENGTH(6800)}, //XA_Tutorial
+	{XA_Week1B, 0}, //XA_Dadbattle
+	{XA_Week1B, 2}, //XA_Tutorial
 	//WEEK2A.XA
-	{XA_Week2A, XA_LENGTH(9900)}, //XA_Spookeez
-	{XA_Week2A, XA_LENGTH(8900)}, //XA_South
+	{XA_Week2A, 0}, //XA_Spookeez
+	{XA_Week2A, 2}, //XA_South
 	//WEEK2B.XA
-	{XA_Week2B, XA_LENGTH(17800)}, //XA_Monster
-	{XA_Week2B, XA_LENGTH(11000)}, //XA_Clucked
+	{XA_Week2B, 0}, //XA_Monster
+	{XA_Week2B, 2}, //XA_Clucked
 	//WEEK3A.XA
-	{XA_Week3A, XA_LENGTH(8400)},  //XA_Pico
-	{XA_Week3A, XA_LENGTH(10000)}, //XA_Philly
+	{XA_Week3A, 0}, //XA_Pico
+	{XA_Week3A, 2}, //XA_Philly
 	//WEEK3B.XA
-	{XA_Week3B, XA_LENGTH(10700)}, //XA_Blammed
+	{XA_Week3B, 0}, //XA_Blammed
 	//WEEK4A.XA
-	{XA_Week4A, XA_LENGTH(9300)},  //XA_SatinPanties
-	{XA_Week4A, XA_LENGTH(10300)}, //XA_High
+	{XA_Week4A, 0}, //XA_SatinPanties
+	{XA_Week4A, 2}, //XA_High
 	//WEEK4B.XA
-	{XA_Week4B, XA_LENGTH(12300)}, //XA_MILF
-	{XA_Week4B, XA_LENGTH(10300)}, //XA_Test
+	{XA_Week4B, 0}, //XA_MILF
+	{XA_Week4B, 2}, //XA_Test
 	//WEEK5A.XA
-	{XA_Week5A, XA_LENGTH(11500)}, //XA_Cocoa
-	{XA_Week5A, XA_LENGTH(9400)},  //XA_Eggnog
+	{XA_Week5A, 0}, //XA_Cocoa
+	{XA_Week5A, 2}, //XA_Eggnog
 	//WEEK5B.XA
-	{XA_Week5B, XA_LENGTH(13300)}, //XA_WinterHorrorland
+	{XA_Week5B, 0}, //XA_WinterHorrorland
 	//WEEK6A.XA
-	{XA_Week6A, XA_LENGTH(9800)}, //XA_Senpai
-	{XA_Week6A, XA_LENGTH(8900)}, //XA_Roses
+	{XA_Week6A, 0}, //XA_Senpai
+	{XA_Week6A, 2}, //XA_Roses
 	//WEEK6B.XA
-	{XA_Week6B, XA_LENGTH(10300)}, //XA_Thorns
+	{XA_Week6B, 0}, //XA_Thorns
 };
 
 static const char *xa_paths[] = {
@@ -61,3 +61,20 @@ static const char *xa_paths[] = {
 	"\\MUSIC\\WEEK6B.XA;1", //XA_Week6B
 	NULL,
 };
+
+static const char *xa_index_paths[] = {
+	"\\MUSIC\\MENU.IDX;1",   //XA_Menu
+	"\\MUSIC\\WEEK1A.IDX;1", //XA_Week1A
+	"\\MUSIC\\WEEK1B.IDX;1", //XA_Week1B
+	"\\MUSIC\\WEEK2A.IDX;1", //XA_Week2A
+	"\\MUSIC\\WEEK2B.IDX;1", //XA_Week2B
+	"\\MUSIC\\WEEK3A.IDX;1", //XA_Week3A
+	"\\MUSIC\\WEEK3B.IDX;1", //XA_Week3B
+	"\\MUSIC\\WEEK4A.IDX;1", //XA_Week4A
+	"\\MUSIC\\WEEK4B.IDX;1", //XA_Week4B
+	"\\MUSIC\\WEEK5A.IDX;1", //XA_Week5A
+	"\\MUSIC\\WEEK5B.IDX;1", //XA_Week5B
+	"\\MUSIC\\WEEK6A.IDX;1", //XA_Week6A
+	"\\MUSIC\\WEEK6B.IDX;1", //XA_Week6B
+	NULL,
+};
@@ -9,6 +9,54 @@
 #include "mem.h"
 #include "stage.h"
 
+//Character texture cache pages
+//These are the TPages the default .png.txt layout leaves free (see FORMATS.md),
+//a page is skipped if anything else was loaded into it during the stage
+static const struct
+{
+	u16 x, y; //TPage position
+	u16 cy;   //Palette row
+} char_texpage[] = {
+	{832,   0, 496},
+	{768, 256, 497}, //mom hair
+	{384,   0, 498}, //hud0weeb.tim
+};
+
+static u8 char_texpage_own; //Pages claimed by a character
+
+#ifdef CHAR_TEXSTAT
+	static u32 char_texstat_hit, char_texstat_miss, char_texstat_bytes;
+#endif
+
+static u8 Character_ClaimTexPage(IO_Data data)
+{
+	//Spare pages only fit a single TPage 4bpp sheet
+	#ifdef PSXF_PC
+		//No TIM reader on PC, sheets always go to their own position
+		(void)data;
+		return 0xFF;
+	#else
+		TIM_IMAGE tparam;
+		OpenTIM(data);
+		ReadTIM(&tparam);
+		if ((tparam.mode & 0x3) != 0 || tparam.prect->w > 64 || tparam.prect->h > 256)
+			return 0xFF;
+	#endif
+	
+	//Find a page that's neither claimed nor used by something else
+	u32 tpage_use = Gfx_GetTPageUse();
+	for (u8 i = 0; i < COUNT_OF(char_texpage); i++)
+	{
+		if (char_texpage_own & (1 << i))
+			continue;
+		if (tpage_use & (1 << (((char_texpage[i].y >> 8) << 4) | (char_texpage[i].x >> 6))))
+			continue;
+		char_texpage_own |= 1 << i;
+		return i;
+	}
+	return 0xFF;
+}
+
 //Character functions
 void Character_Free(Character *this)
 {
@@ -16,7 +64,14 @@ void Character_Free(Character *this)
 	if (this == NULL)
 		return;
 	
-	//Free character
+	//Release claimed texture pages
+	CharTexSlot *slot = this->texcache.slot;
+	for (u8 i = 0; i < this->texcache.slots; i++, slot++)
+		if (slot->page != 0xFF)
+			char_texpage_own &= ~(1 << slot->page);
+	
+	//Free character once its queued uploads are done
+	Gfx_FlushTex();
 	this->free(this);
 	Mem_Free(this);
 }
@@ -31,8 +86,100 @@ void Character_Init(Character *this, fixed_t x, fixed_t y)
 	this->pad_held = 0;
 	
 	this->sing_end = 0;
+	
+	this->texcache.stamp = 0;
+	this->texcache.clut = 0;
+	this->texcache.slots = 0;
+}
+
+void Character_LoadTex(Character *this, Gfx_Tex *tex, IO_Data data)
+{
+	CharTexCache *cache = &this->texcache;
+	cache->stamp++;
+	
+	//Use resident sheet if present
+	CharTexSlot *slot = cache->slot;
+	for (u8 i = 0; i < cache->slots; i++, slot++)
+	{
+		if (slot->data == data)
+		{
+			slot->stamp = cache->stamp;
+			*tex = slot->tex;
+			#ifdef CHAR_TEXSTAT
+				char_texstat_hit++;
+			#endif
+			return;
+		}
+	}
+	
+	//Get slot to upload to, first is the sheet's own position, then spare pages, then least recently used
+	u8 page;
+	if (cache->slots == 0)
+	{
+		slot = &cache->slot[cache->slots++];
+		slot->page = 0xFF;
+	}
+	else if (cache->slots < CHAR_TEXCACHE_SLOTS && (page = Character_ClaimTexPage(data)) != 0xFF)
+	{
+		slot = &cache->slot[cache->slots++];
+		slot->page = page;
+	}
+	else
+	{
+		slot = cache->slot;
+		for (u8 i = 1; i < cache->slots; i++)
+			if (cache->slot[i].stamp < slot->stamp)
+				slot = &cache->slot[i];
+	}
+	
+	//Upload sheet
+	if (slot->page == 0xFF)
+	{
+		Gfx_LoadTex(&slot->tex, data, GFX_LOADTEX_ASYNC);
+	}
+	else
+	{
+		POINT tpos = {char_texpage[slot->page].x, char_texpage[slot->page].y};
+		POINT cpos = {0, char_texpage[slot->page].cy};
+		Gfx_LoadTexAt(&slot->tex, data, &tpos, &cpos, GFX_LOADTEX_ASYNC);
+	}
+	
+	//Sheets in a palette bank don't have a CLUT to upload, they use the one Character_LoadPalette uploaded
+	if (!(slot->tex.tim_mode & 0x8))
+		slot->tex.clut = cache->clut;
+	slot->data = data;
+	slot->stamp = cache->stamp;
+	*tex = slot->tex;
+	
+	#ifdef CHAR_TEXSTAT
+		char_texstat_miss++;
+		char_texstat_bytes += slot->tex.tim_prect.w * slot->tex.tim_prect.h * 2;
+		if (slot->tex.tim_mode & 0x8)
+			char_texstat_bytes += slot->tex.tim_crect.w * slot->tex.tim_crect.h * 2;
+	#endif
+}
+
+void Character_LoadPalette(Character *this, IO_Data data)
+{
+	//Upload a palette bank (funkintimconv -P) once, instead of a CLUT with every sheet
+	Gfx_Tex pal;
+	Gfx_LoadTex(&pal, data, GFX_LOADTEX_NOTEX | GFX_LOADTEX_ASYNC);
+	this->texcache.clut = pal.clut;
+	
+	#ifdef CHAR_TEXSTAT
+		char_texstat_bytes += pal.tim_crect.w * pal.tim_crect.h * 2;
+	#endif
 }
 
+#ifdef CHAR_TEXSTAT
+	void Character_GetTexStat(u32 *hit, u32 *miss, u32 *bytes)
+	{
+		*hit = char_texstat_hit;
+		*miss = char_texstat_miss;
+		*bytes = char_texstat_bytes;
+	}
+#endif
+
 void Character_DrawParallax(Character *this, Gfx_Tex *tex, const CharFrame *cframe, fixed_t parallax)
 {
 	//Draw character
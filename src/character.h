@@ -13,6 +13,11 @@
 #include "fixed.h"
 #include "animation.h"
 
+//Character texture cache
+//#define CHAR_TEXSTAT //This will enable the Character_GetTexStat function which returns sheet cache hits, misses, and uploaded bytes
+
+#define CHAR_TEXCACHE_SLOTS 3 //Sheet's own position plus up to 2 spare TPages
+
 //Character specs
 typedef u8 CharSpec;
 #define CHAR_SPEC_MISSANIM (1 << 0) //Has miss animations
@@ -37,6 +42,22 @@ typedef struct
 	s16 off[2];
 } CharFrame;
 
+typedef struct
+{
+	Gfx_Tex tex;
+	IO_Data data; //Sheet resident in this slot
+	u32 stamp;    //Last use, least recently used slot gets replaced
+	u8 page;      //Spare TPage index, 0xFF for the sheet's own position
+} CharTexSlot;
+
+typedef struct
+{
+	CharTexSlot slot[CHAR_TEXCACHE_SLOTS];
+	u32 stamp;
+	u16 clut; //Palette bank for sheets without a CLUT
+	u8 slots;
+} CharTexCache;
+
 typedef struct Character
 {
 	//Character functions
@@ -60,11 +81,19 @@ typedef struct Character
 	Animatable animatable;
 	fixed_t sing_end;
 	u16 pad_held;
+	
+	//Texture cache
+	CharTexCache texcache;
 } Character;
 
 //Character functions
 void Character_Free(Character *this);
 void Character_Init(Character *this, fixed_t x, fixed_t y);
+void Character_LoadTex(Character *this, Gfx_Tex *tex, IO_Data data);
+void Character_LoadPalette(Character *this, IO_Data data);
+#ifdef CHAR_TEXSTAT
+	void Character_GetTexStat(u32 *hit, u32 *miss, u32 *bytes);
+#endif
 void Character_DrawParallax(Character *this, Gfx_Tex *tex, const CharFrame *cframe, fixed_t parallax);
 void Character_Draw(Character *this, Gfx_Tex *tex, const CharFrame *cframe);
 
@@ -177,7 +177,7 @@ void Char_BF_SetFrame(void *user, u8 frame)
 		//Check if new art shall be loaded
 		const CharFrame *cframe = &char_bf_frame[this->frame = frame];
 		if (cframe->tex != this->tex_id)
-			Gfx_LoadTex(&this->tex, this->arc_ptr[this->tex_id = cframe->tex], 0);
+			Character_LoadTex(&this->character, &this->tex, this->arc_ptr[this->tex_id = cframe->tex]);
 	}
 }
 
@@ -355,24 +355,25 @@ void Char_BF_SetAnim(Character *character, u8 anim)
 			character->focus_zoom = FIXED_DEC(125,100);
 			break;
 		case PlayerAnim_Dead2:
-			//Unload main.arc
+			//Unload main.arc once queued uploads from it are done
+			Gfx_FlushTex();
 			Mem_Free(this->arc_main);
 			this->arc_main = this->arc_dead;
 			this->arc_dead = NULL;
 			
 			//Find dead.arc files
-			const char **pathp = (const char *[]){
-				"dead1.tim", //BF_ArcDead_Dead1
-				"dead2.tim", //BF_ArcDead_Dead2
-				"retry.tim", //BF_ArcDead_Retry
-				NULL
+			const u32 *hashp = (const u32[]){
+				ARCHIVE_HASH("dead1.tim"), //BF_ArcDead_Dead1
+				ARCHIVE_HASH("dead2.tim"), //BF_ArcDead_Dead2
+				ARCHIVE_HASH("retry.tim"), //BF_ArcDead_Retry
+				0
 			};
 			IO_Data *arc_ptr = this->arc_ptr;
-			for (; *pathp != NULL; pathp++)
-				*arc_ptr++ = Archive_Find(this->arc_main, *pathp);
+			for (; *hashp != 0; hashp++)
+				*arc_ptr++ = Archive_FindHash(this->arc_main, *hashp);
 			
 			//Load retry art
-			Gfx_LoadTex(&this->tex_retry, this->arc_ptr[BF_ArcDead_Retry], 0);
+			Gfx_LoadTex(&this->tex_retry, this->arc_ptr[BF_ArcDead_Retry], GFX_LOADTEX_ASYNC);
 			break;
 	}
 	
@@ -430,20 +431,20 @@ Character *Char_BF_New(fixed_t x, fixed_t y)
 	this->arc_dead = NULL;
 	IO_FindFile(&this->file_dead_arc, "\\CHAR\\BFDEAD.ARC;1");
 	
-	const char **pathp = (const char *[]){
-		"bf0.tim",   //BF_ArcMain_BF0
-		"bf1.tim",   //BF_ArcMain_BF1
-		"bf2.tim",   //BF_ArcMain_BF2
-		"bf3.tim",   //BF_ArcMain_BF3
-		"bf4.tim",   //BF_ArcMain_BF4
-		"bf5.tim",   //BF_ArcMain_BF5
-		"bf6.tim",   //BF_ArcMain_BF6
-		"dead0.tim", //BF_ArcMain_Dead0
-		NULL
+	const u32 *hashp = (const u32[]){
+		ARCHIVE_HASH("bf0.tim"),   //BF_ArcMain_BF0
+		ARCHIVE_HASH("bf1.tim"),   //BF_ArcMain_BF1
+		ARCHIVE_HASH("bf2.tim"),   //BF_ArcMain_BF2
+		ARCHIVE_HASH("bf3.tim"),   //BF_ArcMain_BF3
+		ARCHIVE_HASH("bf4.tim"),   //BF_ArcMain_BF4
+		ARCHIVE_HASH("bf5.tim"),   //BF_ArcMain_BF5
+		ARCHIVE_HASH("bf6.tim"),   //BF_ArcMain_BF6
+		ARCHIVE_HASH("dead0.tim"), //BF_ArcMain_Dead0
+		0
 	};
 	IO_Data *arc_ptr = this->arc_ptr;
-	for (; *pathp != NULL; pathp++)
-		*arc_ptr++ = Archive_Find(this->arc_main, *pathp);
+	for (; *hashp != 0; hashp++)
+		*arc_ptr++ = Archive_FindHash(this->arc_main, *hashp);
 	
 	//Initialize render state
 	this->tex_id = this->frame = 0xFF;
@@ -143,7 +143,7 @@ void Char_BFWeeb_SetFrame(void *user, u8 frame)
 		//Check if new art shall be loaded
 		const CharFrame *cframe = &char_bfweeb_frame[this->frame = frame];
 		if (cframe->tex != this->tex_id)
-			Gfx_LoadTex(&this->tex, this->arc_ptr[this->tex_id = cframe->tex], 0);
+			Character_LoadTex(&this->character, &this->tex, this->arc_ptr[this->tex_id = cframe->tex]);
 	}
 }
 
@@ -303,19 +303,20 @@ void Char_BFWeeb_SetAnim(Character *character, u8 anim)
 			character->focus_zoom = FIXED_DEC(125,100);
 			break;
 		case PlayerAnim_Dead2:
-			//Unload main.arc
+			//Unload main.arc once queued uploads from it are done
+			Gfx_FlushTex();
 			Mem_Free(this->arc_main);
 			this->arc_main = this->arc_dead;
 			this->arc_dead = NULL;
 			
 			//Find dead.arc files
-			const char **pathp = (const char *[]){
-				"deadw0.tim", //BFWeeb_ArcDead_DeadW0
-				NULL
+			const u32 *hashp = (const u32[]){
+				ARCHIVE_HASH("deadw0.tim"), //BFWeeb_ArcDead_DeadW0
+				0
 			};
 			IO_Data *arc_ptr = this->arc_ptr;
-			for (; *pathp != NULL; pathp++)
-				*arc_ptr++ = Archive_Find(this->arc_main, *pathp);
+			for (; *hashp != 0; hashp++)
+				*arc_ptr++ = Archive_FindHash(this->arc_main, *hashp);
 			
 			//Load retry art
 			//Gfx_LoadTex(&this->tex_retry, this->arc_ptr[BFWeeb_ArcDead_Retry], 0);
@@ -376,14 +377,14 @@ Character *Char_BFWeeb_New(fixed_t x, fixed_t y)
 	this->arc_dead = NULL;
 	IO_FindFile(&this->file_dead_arc, "\\CHAR\\BFDEAD.ARC;1");
 	
-	const char **pathp = (const char *[]){
-		"weeb0.tim",  //BFWeeb_ArcMain_Weeb0
-		"weeb1.tim",  //BFWeeb_ArcMain_Weeb1
-		NULL
+	const u32 *hashp = (const u32[]){
+		ARCHIVE_HASH("weeb0.tim"),  //BFWeeb_ArcMain_Weeb0
+		ARCHIVE_HASH("weeb1.tim"),  //BFWeeb_ArcMain_Weeb1
+		0
 	};
 	IO_Data *arc_ptr = this->arc_ptr;
-	for (; *pathp != NULL; pathp++)
-		*arc_ptr++ = Archive_Find(this->arc_main, *pathp);
+	for (; *hashp != 0; hashp++)
+		*arc_ptr++ = Archive_FindHash(this->arc_main, *hashp);
 	
 	//Initialize render state
 	this->tex_id = this->frame = 0xFF;
@@ -110,7 +110,7 @@ void Char_GF_SetFrame(void *user, u8 frame)
 		//Check if new art shall be loaded
 		const CharFrame *cframe = &char_gf_frame[this->frame = frame];
 		if (cframe->tex != this->tex_id)
-			Gfx_LoadTex(&this->tex, this->arc_ptr[this->tex_id = cframe->tex], 0);
+			Character_LoadTex(&this->character, &this->tex, this->arc_ptr[this->tex_id = cframe->tex]);
 	}
 }
 
@@ -222,16 +222,16 @@ Character *Char_GF_New(fixed_t x, fixed_t y)
 	//Load art
 	this->arc_main = IO_Read("\\CHAR\\GF.ARC;1");
 	
-	const char **pathp = (const char *[]){
-		"gf0.tim", //GF_ArcMain_GF0
-		"gf1.tim", //GF_ArcMain_GF1
-		"gf2.tim", //GF_ArcMain_GF2
-		"gf3.tim", //GF_ArcMain_GF3
-		NULL
+	const u32 *hashp = (const u32[]){
+		ARCHIVE_HASH("gf0.tim"), //GF_ArcMain_GF0
+		ARCHIVE_HASH("gf1.tim"), //GF_ArcMain_GF1
+		ARCHIVE_HASH("gf2.tim"), //GF_ArcMain_GF2
+		ARCHIVE_HASH("gf3.tim"), //GF_ArcMain_GF3
+		0
 	};
 	IO_Data *arc_ptr = this->arc_ptr;
-	for (; *pathp != NULL; pathp++)
-		*arc_ptr++ = Archive_Find(this->arc_main, *pathp);
+	for (; *hashp != 0; hashp++)
+		*arc_ptr++ = Archive_FindHash(this->arc_main, *hashp);
 	
 	//Load scene specific art
 	switch (stage.stage_id)
@@ -240,14 +240,14 @@ Character *Char_GF_New(fixed_t x, fixed_t y)
 		{
 			this->arc_scene = IO_Read("\\CHAR\\GFTUT.ARC;1");
 			
-			const char **pathp = (const char *[]){
-				"tut0.tim", //GF_ArcScene_0
-				"tut1.tim", //GF_ArcScene_1
-				NULL
+			const u32 *hashp = (const u32[]){
+				ARCHIVE_HASH("tut0.tim"), //GF_ArcScene_0
+				ARCHIVE_HASH("tut1.tim"), //GF_ArcScene_1
+				0
 			};
 			IO_Data *arc_ptr = &this->arc_ptr[GF_ArcScene_0];
-			for (; *pathp != NULL; pathp++)
-				*arc_ptr++ = Archive_Find(this->arc_scene, *pathp);
+			for (; *hashp != 0; hashp++)
+				*arc_ptr++ = Archive_FindHash(this->arc_scene, *hashp);
 			break;
 		}
 		default:
@@ -71,7 +71,7 @@ void Char_GFWeeb_SetFrame(void *user, u8 frame)
 		//Check if new art shall be loaded
 		const CharFrame *cframe = &char_gfweeb_frame[this->frame = frame];
 		if (cframe->tex != this->tex_id)
-			Gfx_LoadTex(&this->tex, this->arc_ptr[this->tex_id = cframe->tex], 0);
+			Character_LoadTex(&this->character, &this->tex, this->arc_ptr[this->tex_id = cframe->tex]);
 	}
 }
 
@@ -154,14 +154,14 @@ Character *Char_GFWeeb_New(fixed_t x, fixed_t y)
 	//Load art
 	this->arc_main = IO_Read("\\CHAR\\GFWEEB.ARC;1");
 	
-	const char **pathp = (const char *[]){
-		"weeb0.tim",  //GFWeeb_ArcMain_Weeb0
-		"weeb1.tim",  //GFWeeb_ArcMain_Weeb1
-		NULL
+	const u32 *hashp = (const u32[]){
+		ARCHIVE_HASH("weeb0.tim"),  //GFWeeb_ArcMain_Weeb0
+		ARCHIVE_HASH("weeb1.tim"),  //GFWeeb_ArcMain_Weeb1
+		0
 	};
 	IO_Data *arc_ptr = this->arc_ptr;
-	for (; *pathp != NULL; pathp++)
-		*arc_ptr++ = Archive_Find(this->arc_main, *pathp);
+	for (; *hashp != 0; hashp++)
+		*arc_ptr++ = Archive_FindHash(this->arc_main, *hashp);
 	
 	//Initialize render state
 	this->tex_id = this->frame = 0xFF;
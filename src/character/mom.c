@@ -84,7 +84,7 @@ void Char_Mom_SetFrame(void *user, u8 frame)
 		//Check if new art shall be loaded
 		const CharFrame *cframe = &char_mom_frame[this->frame = frame];
 		if (cframe->tex != this->tex_id)
-			Gfx_LoadTex(&this->tex, this->arc_ptr[this->tex_id = cframe->tex], 0);
+			Character_LoadTex(&this->character, &this->tex, this->arc_ptr[this->tex_id = cframe->tex]);
 	}
 }
 
@@ -203,23 +203,24 @@ Character *Char_Mom_New(fixed_t x, fixed_t y)
 	this->character.scale = FIXED_DEC(100,100);
 	
 	//Load hair art
-	Gfx_LoadTex(&this->tex_hair, IO_Read("\\CHAR\\MOMHAIR.TIM;1"), GFX_LOADTEX_FREE);
+	Gfx_LoadTex(&this->tex_hair, IO_Read("\\CHAR\\MOMHAIR.TIM;1"), GFX_LOADTEX_FREE | GFX_LOADTEX_ASYNC);
 	
 	//Load art
 	this->arc_main = IO_Read("\\CHAR\\MOM.ARC;1");
 	
-	const char **pathp = (const char *[]){
-		"idle0.tim", //Mom_ArcMain_Idle0
-		"idle1.tim", //Mom_ArcMain_Idle1
-		"left.tim",  //Mom_ArcMain_Left
-		"down.tim",  //Mom_ArcMain_Down
-		"up.tim",    //Mom_ArcMain_Up
-		"right.tim", //Mom_ArcMain_Right
-		NULL
+	const u32 *hashp = (const u32[]){
+		ARCHIVE_HASH("idle0.tim"), //Mom_ArcMain_Idle0
+		ARCHIVE_HASH("idle1.tim"), //Mom_ArcMain_Idle1
+		ARCHIVE_HASH("left.tim"),  //Mom_ArcMain_Left
+		ARCHIVE_HASH("down.tim"),  //Mom_ArcMain_Down
+		ARCHIVE_HASH("up.tim"),    //Mom_ArcMain_Up
+		ARCHIVE_HASH("right.tim"), //Mom_ArcMain_Right
+		0
 	};
 	IO_Data *arc_ptr = this->arc_ptr;
-	for (; *pathp != NULL; pathp++)
-		*arc_ptr++ = Archive_Find(this->arc_main, *pathp);
+	for (; *hashp != 0; hashp++)
+		*arc_ptr++ = Archive_FindHash(this->arc_main, *hashp);
+	Character_LoadPalette(&this->character, Archive_FindHash(this->arc_main, ARCHIVE_HASH("pal.tim")));
 	
 	//Initialize render state
 	this->tex_id = this->frame = 0xFF;
@@ -80,7 +80,7 @@ void Char_MonsterX_SetFrame(void *user, u8 frame)
 		//Check if new art shall be loaded
 		const CharFrame *cframe = &char_monster_frame[this->frame = frame];
 		if (cframe->tex != this->tex_id)
-			Gfx_LoadTex(&this->tex, this->arc_ptr[this->tex_id = cframe->tex], 0);
+			Character_LoadTex(&this->character, &this->tex, this->arc_ptr[this->tex_id = cframe->tex]);
 	}
 }
 
@@ -150,18 +150,18 @@ Character *Char_MonsterX_New(fixed_t x, fixed_t y)
 		//Load art
 		this->arc_main = IO_Read("\\CHAR\\MONSTERX.ARC;1");
 		
-		const char **pathp = (const char *[]){
-			"idle0.tim", //Monster_ArcMain_Idle0
-			"idle1.tim", //Monster_ArcMain_Idle1
-			"left.tim",  //Monster_ArcMain_Left
-			"down.tim",  //Monster_ArcMain_Down
-			"up.tim",    //Monster_ArcMain_Up
-			"right.tim", //Monster_ArcMain_Right
-			NULL
+		const u32 *hashp = (const u32[]){
+			ARCHIVE_HASH("idle0.tim"), //Monster_ArcMain_Idle0
+			ARCHIVE_HASH("idle1.tim"), //Monster_ArcMain_Idle1
+			ARCHIVE_HASH("left.tim"),  //Monster_ArcMain_Left
+			ARCHIVE_HASH("down.tim"),  //Monster_ArcMain_Down
+			ARCHIVE_HASH("up.tim"),    //Monster_ArcMain_Up
+			ARCHIVE_HASH("right.tim"), //Monster_ArcMain_Right
+			0
 		};
 		IO_Data *arc_ptr = this->arc_ptr;
-		for (; *pathp != NULL; pathp++)
-			*arc_ptr++ = Archive_Find(this->arc_main, *pathp);
+		for (; *hashp != 0; hashp++)
+			*arc_ptr++ = Archive_FindHash(this->arc_main, *hashp);
 			
 	//Initialize render state
 	this->tex_id = this->frame = 0xFF;
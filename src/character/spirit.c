@@ -86,7 +86,7 @@ void Char_Spirit_SetFrame(void *user, u8 frame)
 		//Check if new art shall be loaded
 		const CharFrame *cframe = &char_spirit_frame[this->frame = frame];
 		if (cframe->tex != this->tex_id)
-			Gfx_LoadTex(&this->tex, this->arc_ptr[this->tex_id = cframe->tex], 0);
+			Character_LoadTex(&this->character, &this->tex, this->arc_ptr[this->tex_id = cframe->tex]);
 	}
 	
 	//Process distortion
@@ -223,14 +223,15 @@ Character *Char_Spirit_New(fixed_t x, fixed_t y)
 	//Load art
 	this->arc_main = IO_Read("\\CHAR\\SPIRIT.ARC;1");
 	
-	const char **pathp = (const char *[]){
-		"spirit0.tim", //Spirit_ArcMain_Spirit0
-		"spirit1.tim", //Spirit_ArcMain_Spirit1
-		NULL
+	const u32 *hashp = (const u32[]){
+		ARCHIVE_HASH("spirit0.tim"), //Spirit_ArcMain_Spirit0
+		ARCHIVE_HASH("spirit1.tim"), //Spirit_ArcMain_Spirit1
+		0
 	};
 	IO_Data *arc_ptr = this->arc_ptr;
-	for (; *pathp != NULL; pathp++)
-		*arc_ptr++ = Archive_Find(this->arc_main, *pathp);
+	for (; *hashp != 0; hashp++)
+		*arc_ptr++ = Archive_FindHash(this->arc_main, *hashp);
+	Character_LoadPalette(&this->character, Archive_FindHash(this->arc_main, ARCHIVE_HASH("pal.tim")));
 	
 	//Initialize render state
 	this->tex_id = this->frame = 0xFF;
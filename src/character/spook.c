@@ -83,7 +83,7 @@ void Char_Spook_SetFrame(void *user, u8 frame)
 		//Check if new art shall be loaded
 		const CharFrame *cframe = &char_spook_frame[this->frame = frame];
 		if (cframe->tex != this->tex_id)
-			Gfx_LoadTex(&this->tex, this->arc_ptr[this->tex_id = cframe->tex], 0);
+			Character_LoadTex(&this->character, &this->tex, this->arc_ptr[this->tex_id = cframe->tex]);
 	}
 }
 
@@ -176,19 +176,19 @@ Character *Char_Spook_New(fixed_t x, fixed_t y)
 	//Load art
 	this->arc_main = IO_Read("\\CHAR\\SPOOK.ARC;1");
 	
-	const char **pathp = (const char *[]){
-		"idle0.tim", //Spook_ArcMain_Idle0
-		"idle1.tim", //Spook_ArcMain_Idle1
-		"idle2.tim", //Spook_ArcMain_Idle2
-		"left.tim",  //Spook_ArcMain_Left
-		"down.tim",  //Spook_ArcMain_Down
-		"up.tim",    //Spook_ArcMain_Up
-		"right.tim", //Spook_ArcMain_Right
-		NULL
+	const u32 *hashp = (const u32[]){
+		ARCHIVE_HASH("idle0.tim"), //Spook_ArcMain_Idle0
+		ARCHIVE_HASH("idle1.tim"), //Spook_ArcMain_Idle1
+		ARCHIVE_HASH("idle2.tim"), //Spook_ArcMain_Idle2
+		ARCHIVE_HASH("left.tim"),  //Spook_ArcMain_Left
+		ARCHIVE_HASH("down.tim"),  //Spook_ArcMain_Down
+		ARCHIVE_HASH("up.tim"),    //Spook_ArcMain_Up
+		ARCHIVE_HASH("right.tim"), //Spook_ArcMain_Right
+		0
 	};
 	IO_Data *arc_ptr = this->arc_ptr;
-	for (; *pathp != NULL; pathp++)
-		*arc_ptr++ = Archive_Find(this->arc_main, *pathp);
+	for (; *hashp != 0; hashp++)
+		*arc_ptr++ = Archive_FindHash(this->arc_main, *hashp);
 	
 	//Initialize render state
 	this->tex_id = this->frame = 0xFF;
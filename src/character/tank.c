@@ -104,7 +104,7 @@ void Char_Tank_SetFrame(void *user, u8 frame)
 		//Check if new art shall be loaded
 		const CharFrame *cframe = &char_tank_frame[this->frame = frame];
 		if (cframe->tex != this->tex_id)
-			Gfx_LoadTex(&this->tex, this->arc_ptr[this->tex_id = cframe->tex], 0);
+			Character_LoadTex(&this->character, &this->tex, this->arc_ptr[this->tex_id = cframe->tex]);
 	}
 }
 
@@ -223,18 +223,18 @@ Character *Char_Tank_New(fixed_t x, fixed_t y)
 	//Load art
 	this->arc_main = IO_Read("\\CHAR\\TANK.ARC;1");
 	
-	const char **pathp = (const char *[]){
-		"idle0.tim", //Tank_ArcMain_Idle0
-		"idle1.tim", //Tank_ArcMain_Idle1
-		"left.tim",  //Tank_ArcMain_Left
-		"down.tim",  //Tank_ArcMain_Down
-		"up.tim",    //Tank_ArcMain_Up
-		"right.tim", //Tank_ArcMain_Right
-		NULL
+	const u32 *hashp = (const u32[]){
+		ARCHIVE_HASH("idle0.tim"), //Tank_ArcMain_Idle0
+		ARCHIVE_HASH("idle1.tim"), //Tank_ArcMain_Idle1
+		ARCHIVE_HASH("left.tim"),  //Tank_ArcMain_Left
+		ARCHIVE_HASH("down.tim"),  //Tank_ArcMain_Down
+		ARCHIVE_HASH("up.tim"),    //Tank_ArcMain_Up
+		ARCHIVE_HASH("right.tim"), //Tank_ArcMain_Right
+		0
 	};
 	IO_Data *arc_ptr = this->arc_ptr;
-	for (; *pathp != NULL; pathp++)
-		*arc_ptr++ = Archive_Find(this->arc_main, *pathp);
+	for (; *hashp != 0; hashp++)
+		*arc_ptr++ = Archive_FindHash(this->arc_main, *hashp);
 	
 	//Load scene art
 	switch (stage.stage_id)
@@ -244,14 +244,14 @@ Character *Char_Tank_New(fixed_t x, fixed_t y)
 			//Load "Ugh" art
 			this->arc_scene = IO_Read("\\CHAR\\TANKUGH.ARC;1");
 			
-			const char **pathp = (const char *[]){
-				"ugh0.tim", //Tank_ArcScene_0
-				"ugh1.tim", //Tank_ArcScene_1
-				NULL
+			const u32 *hashp = (const u32[]){
+				ARCHIVE_HASH("ugh0.tim"), //Tank_ArcScene_0
+				ARCHIVE_HASH("ugh1.tim"), //Tank_ArcScene_1
+				0
 			};
 			IO_Data *arc_ptr = &this->arc_ptr[Tank_ArcScene_0];
-			for (; *pathp != NULL; pathp++)
-				*arc_ptr++ = Archive_Find(this->arc_scene, *pathp);
+			for (; *hashp != 0; hashp++)
+				*arc_ptr++ = Archive_FindHash(this->arc_scene, *hashp);
 			break;
 		}
 		case StageId_7_3: //Stress
@@ -259,16 +259,16 @@ Character *Char_Tank_New(fixed_t x, fixed_t y)
 			//Load "Heh, pretty good!" art
 			this->arc_scene = IO_Read("\\CHAR\\TANKGOOD.ARC;1");
 			
-			const char **pathp = (const char *[]){
-				"good0.tim", //Tank_ArcScene_0
-				"good1.tim", //Tank_ArcScene_1
-				"good2.tim", //Tank_ArcScene_2
-				"good3.tim", //Tank_ArcScene_3
-				NULL
+			const u32 *hashp = (const u32[]){
+				ARCHIVE_HASH("good0.tim"), //Tank_ArcScene_0
+				ARCHIVE_HASH("good1.tim"), //Tank_ArcScene_1
+				ARCHIVE_HASH("good2.tim"), //Tank_ArcScene_2
+				ARCHIVE_HASH("good3.tim"), //Tank_ArcScene_3
+				0
 			};
 			IO_Data *arc_ptr = &this->arc_ptr[Tank_ArcScene_0];
-			for (; *pathp != NULL; pathp++)
-				*arc_ptr++ = Archive_Find(this->arc_scene, *pathp);
+			for (; *hashp != 0; hashp++)
+				*arc_ptr++ = Archive_FindHash(this->arc_scene, *hashp);
 			
 			this->mouth_i = 0;
 			break;
@@ -177,7 +177,7 @@ void Char_XmasBF_SetFrame(void *user, u8 frame)
 		//Check if new art shall be loaded
 		const CharFrame *cframe = &char_xmasbf_frame[this->frame = frame];
 		if (cframe->tex != this->tex_id)
-			Gfx_LoadTex(&this->tex, this->arc_ptr[this->tex_id = cframe->tex], 0);
+			Character_LoadTex(&this->character, &this->tex, this->arc_ptr[this->tex_id = cframe->tex]);
 	}
 }
 
@@ -355,24 +355,25 @@ void Char_XmasBF_SetAnim(Character *character, u8 anim)
 			character->focus_zoom = FIXED_DEC(125,100);
 			break;
 		case PlayerAnim_Dead2:
-			//Unload main.arc
+			//Unload main.arc once queued uploads from it are done
+			Gfx_FlushTex();
 			Mem_Free(this->arc_main);
 			this->arc_main = this->arc_dead;
 			this->arc_dead = NULL;
 			
 			//Find dead.arc files
-			const char **pathp = (const char *[]){
-				"dead1.tim", //XmasBF_ArcDead_Dead1
-				"dead2.tim", //XmasBF_ArcDead_Dead2
-				"retry.tim", //XmasBF_ArcDead_Retry
-				NULL
+			const u32 *hashp = (const u32[]){
+				ARCHIVE_HASH("dead1.tim"), //XmasBF_ArcDead_Dead1
+				ARCHIVE_HASH("dead2.tim"), //XmasBF_ArcDead_Dead2
+				ARCHIVE_HASH("retry.tim"), //XmasBF_ArcDead_Retry
+				0
 			};
 			IO_Data *arc_ptr = this->arc_ptr;
-			for (; *pathp != NULL; pathp++)
-				*arc_ptr++ = Archive_Find(this->arc_main, *pathp);
+			for (; *hashp != 0; hashp++)
+				*arc_ptr++ = Archive_FindHash(this->arc_main, *hashp);
 			
 			//Load retry art
-			Gfx_LoadTex(&this->tex_retry, this->arc_ptr[XmasBF_ArcDead_Retry], 0);
+			Gfx_LoadTex(&this->tex_retry, this->arc_ptr[XmasBF_ArcDead_Retry], GFX_LOADTEX_ASYNC);
 			break;
 	}
 	
@@ -430,20 +431,20 @@ Character *Char_XmasBF_New(fixed_t x, fixed_t y)
 		this->arc_dead = NULL;
 		IO_FindFile(&this->file_dead_arc, "\\CHAR\\BFDEAD.ARC;1");
 		
-		const char **pathp = (const char *[]){
-			"xmasbf0.tim",   //XmasBF_ArcMain_XmasBF0
-			"xmasbf1.tim",   //XmasBF_ArcMain_XmasBF1
-			"xmasbf2.tim",   //XmasBF_ArcMain_XmasBF2
-			"xmasbf3.tim",   //XmasBF_ArcMain_XmasBF3
-			"xmasbf3.tim",   //BF_ArcMain_BF4
-			"xmasbf4.tim",   //XmasBF_ArcMain_XmasBF5
-			"xmasbf5.tim",   //XmasBF_ArcMain_XmasBF6
-			"dead0.tim", //XmasBF_ArcMain_Dead0
-			NULL
+		const u32 *hashp = (const u32[]){
+			ARCHIVE_HASH("xmasbf0.tim"),   //XmasBF_ArcMain_XmasBF0
+			ARCHIVE_HASH("xmasbf1.tim"),   //XmasBF_ArcMain_XmasBF1
+			ARCHIVE_HASH("xmasbf2.tim"),   //XmasBF_ArcMain_XmasBF2
+			ARCHIVE_HASH("xmasbf3.tim"),   //XmasBF_ArcMain_XmasBF3
+			ARCHIVE_HASH("xmasbf3.tim"),   //BF_ArcMain_BF4
+			ARCHIVE_HASH("xmasbf4.tim"),   //XmasBF_ArcMain_XmasBF5
+			ARCHIVE_HASH("xmasbf5.tim"),   //XmasBF_ArcMain_XmasBF6
+			ARCHIVE_HASH("dead0.tim"), //XmasBF_ArcMain_Dead0
+			0
 		};
 		IO_Data *arc_ptr = this->arc_ptr;
-		for (; *pathp != NULL; pathp++)
-			*arc_ptr++ = Archive_Find(this->arc_main, *pathp);
+		for (; *hashp != 0; hashp++)
+			*arc_ptr++ = Archive_FindHash(this->arc_main, *hashp);
 
 	//Initialize render state
 	this->tex_id = this->frame = 0xFF;
@@ -85,7 +85,7 @@ void Char_XmasGF_SetFrame(void *user, u8 frame)
 		//Check if new art shall be loaded
 		const CharFrame *cframe = &char_xmasgf_frame[this->frame = frame];
 		if (cframe->tex != this->tex_id)
-			Gfx_LoadTex(&this->tex, this->arc_ptr[this->tex_id = cframe->tex], 0);
+			Character_LoadTex(&this->character, &this->tex, this->arc_ptr[this->tex_id = cframe->tex]);
 	}
 }
 
@@ -190,15 +190,15 @@ Character *Char_XmasGF_New(fixed_t x, fixed_t y)
 	//Load art
 	this->arc_main = IO_Read("\\CHAR\\XMASGF.ARC;1");
 	
-	const char **pathp = (const char *[]){
-		"xmasgf0.tim", //XmasGF_ArcMain_XmasGF0
-		"xmasgf1.tim", //XmasGF_ArcMain_XmasGF1
-		"xmasgf2.tim", //XmasGF_ArcMain_XmasGF2
-		NULL
+	const u32 *hashp = (const u32[]){
+		ARCHIVE_HASH("xmasgf0.tim"), //XmasGF_ArcMain_XmasGF0
+		ARCHIVE_HASH("xmasgf1.tim"), //XmasGF_ArcMain_XmasGF1
+		ARCHIVE_HASH("xmasgf2.tim"), //XmasGF_ArcMain_XmasGF2
+		0
 	};
 	IO_Data *arc_ptr = this->arc_ptr;
-	for (; *pathp != NULL; pathp++)
-		*arc_ptr++ = Archive_Find(this->arc_main, *pathp);
+	for (; *hashp != 0; hashp++)
+		*arc_ptr++ = Archive_FindHash(this->arc_main, *hashp);
 	
 	//Initialize render state
 	this->tex_id = this->frame = 0xFF;
@@ -102,7 +102,7 @@ void Char_XmasP_SetFrame(void *user, u8 frame)
 		//Check if new art shall be loaded
 		const CharFrame *cframe = &char_xmasp_frame[this->frame = frame];
 		if (cframe->tex != this->tex_id)
-			Gfx_LoadTex(&this->tex, this->arc_ptr[this->tex_id = cframe->tex], 0);
+			Character_LoadTex(&this->character, &this->tex, this->arc_ptr[this->tex_id = cframe->tex]);
 	}
 }
 
@@ -172,32 +172,33 @@ Character *Char_XmasP_New(fixed_t x, fixed_t y)
 	//Load art
 	this->arc_main = IO_Read("\\CHAR\\XMASP.ARC;1");
 	
-	const char **pathp = (const char *[]){
-		"idle0.tim",   //XmasP_ArcMain_Idle0
-		"idle1.tim",   //XmasP_ArcMain_Idle1
-		"idle2.tim",   //XmasP_ArcMain_Idle2
-		"idle3.tim",   //XmasP_ArcMain_Idle3
-		"lefta0.tim",  //XmasP_ArcMain_LeftA0
-		"lefta1.tim",  //XmasP_ArcMain_LeftA1
-		"leftb0.tim",  //XmasP_ArcMain_LeftB0
-		"leftb1.tim",  //XmasP_ArcMain_LeftB1
-		"downa0.tim",  //XmasP_ArcMain_DownA0
-		"downa1.tim",  //XmasP_ArcMain_DownA1
-		"downb0.tim",  //XmasP_ArcMain_DownB0
-		"downb1.tim",  //XmasP_ArcMain_DownB1
-		"upa0.tim",    //XmasP_ArcMain_UpA0
-		"upa1.tim",    //XmasP_ArcMain_UpA1
-		"upb0.tim",    //XmasP_ArcMain_UpB0
-		"upb1.tim",    //XmasP_ArcMain_UpB1
-		"righta0.tim", //XmasP_ArcMain_RightA0
-		"righta1.tim", //XmasP_ArcMain_RightA1
-		"rightb0.tim", //XmasP_ArcMain_RightB0
-		"rightb1.tim", //XmasP_ArcMain_RightB1
-		NULL
+	const u32 *hashp = (const u32[]){
+		ARCHIVE_HASH("idle0.tim"),   //XmasP_ArcMain_Idle0
+		ARCHIVE_HASH("idle1.tim"),   //XmasP_ArcMain_Idle1
+		ARCHIVE_HASH("idle2.tim"),   //XmasP_ArcMain_Idle2
+		ARCHIVE_HASH("idle3.tim"),   //XmasP_ArcMain_Idle3
+		ARCHIVE_HASH("lefta0.tim"),  //XmasP_ArcMain_LeftA0
+		ARCHIVE_HASH("lefta1.tim"),  //XmasP_ArcMain_LeftA1
+		ARCHIVE_HASH("leftb0.tim"),  //XmasP_ArcMain_LeftB0
+		ARCHIVE_HASH("leftb1.tim"),  //XmasP_ArcMain_LeftB1
+		ARCHIVE_HASH("downa0.tim"),  //XmasP_ArcMain_DownA0
+		ARCHIVE_HASH("downa1.tim"),  //XmasP_ArcMain_DownA1
+		ARCHIVE_HASH("downb0.tim"),  //XmasP_ArcMain_DownB0
+		ARCHIVE_HASH("downb1.tim"),  //XmasP_ArcMain_DownB1
+		ARCHIVE_HASH("upa0.tim"),    //XmasP_ArcMain_UpA0
+		ARCHIVE_HASH("upa1.tim"),    //XmasP_ArcMain_UpA1
+		ARCHIVE_HASH("upb0.tim"),    //XmasP_ArcMain_UpB0
+		ARCHIVE_HASH("upb1.tim"),    //XmasP_ArcMain_UpB1
+		ARCHIVE_HASH("righta0.tim"), //XmasP_ArcMain_RightA0
+		ARCHIVE_HASH("righta1.tim"), //XmasP_ArcMain_RightA1
+		ARCHIVE_HASH("rightb0.tim"), //XmasP_ArcMain_RightB0
+		ARCHIVE_HASH("rightb1.tim"), //XmasP_ArcMain_RightB1
+		0
 	};
 	IO_Data *arc_ptr = this->arc_ptr;
-	for (; *pathp != NULL; pathp++)
-		*arc_ptr++ = Archive_Find(this->arc_main, *pathp);
+	for (; *hashp != 0; hashp++)
+		*arc_ptr++ = Archive_FindHash(this->arc_main, *hashp);
+	Character_LoadPalette(&this->character, Archive_FindHash(this->arc_main, ARCHIVE_HASH("pal.tim")));
 	
 	//Initialize render state
 	this->tex_id = this->frame = 0xFF;
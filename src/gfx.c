@@ -21,7 +21,41 @@ static u32 ot[2][OTLEN];    //Ordering table length
 static u8 pribuff[2][32768]; //Primitive buffer
 static u8 *nextpri;          //Next primitive pointer
 
+static u32 tpage_use; //TPages written to by Gfx_LoadTex, one bit per 64x256 TPage
+
+//Texture uploads in flight
+#define TEXQUEUE_LEN 16
+
+typedef struct
+{
+	RECT prect, crect;
+	u32 *paddr, *caddr; //NULL if not uploaded
+	IO_Data free;       //Freed once uploaded
+} Gfx_TexUpload;
+
+static IO_Data texqueue[TEXQUEUE_LEN]; //GFX_LOADTEX_FREE data of uploads that haven't been waited on
+static u8 texqueue_len;
+static Gfx_TexFence texfence, texfence_done; //Last upload started, and last one known to be done
+
+//Last tpage change added by Gfx_BlitTexCol, sprites using the same tpage are linked behind it
+static DR_TPAGE *blit_tpage;
+static u16 blit_tpage_mode;
+static u8 *blit_end; //nextpri after the last blit, if it moved something else was added since
+
+#ifdef GFX_TPAGESTAT
+	static u32 tpage_saved, tpage_saved_frame;
+#endif
+
 //Gfx functions
+static void Gfx_RetireTex(void)
+{
+	//Every upload started so far is done, free the data that was waiting on them
+	texfence_done = texfence;
+	for (u8 i = 0; i < texqueue_len; i++)
+		Mem_Free(texqueue[i]);
+	texqueue_len = 0;
+}
+
 void Gfx_Init(void)
 {
 	//Reset GPU
@@ -76,8 +110,10 @@ void Gfx_Quit(void)
 
 void Gfx_Flip(void)
 {
-	//Sync
+	//Sync, this also finishes every upload started this frame
 	DrawSync(0);
+	Gfx_RetireTex();
+	
 	VSync(0);
 	
 	//Apply environments
@@ -95,6 +131,12 @@ void Gfx_Flip(void)
 	db ^= 1;
 	nextpri = pribuff[db];
 	ClearOTagR(ot[db], OTLEN);
+	blit_tpage = NULL;
+	
+	#ifdef GFX_TPAGESTAT
+		tpage_saved_frame = tpage_saved;
+		tpage_saved = 0;
+	#endif
 }
 
 void Gfx_SetClear(u8 r, u8 g, u8 b)
@@ -113,7 +155,45 @@ void Gfx_DisableClear(void)
 	draw[0].isbg = draw[1].isbg = 0;
 }
 
-void Gfx_LoadTex(Gfx_Tex *tex, IO_Data data, Gfx_LoadTex_Flag flag)
+boolean Gfx_TexDone(Gfx_TexFence fence)
+{
+	if ((s32)(fence - texfence_done) <= 0)
+		return true;
+	
+	//DrawSync(1) doesn't block, it gives how much the GPU has left to do
+	if (DrawSync(1) != 0)
+		return false;
+	Gfx_RetireTex();
+	return true;
+}
+
+void Gfx_WaitTex(Gfx_TexFence fence)
+{
+	if ((s32)(fence - texfence_done) <= 0)
+		return;
+	DrawSync(0);
+	Gfx_RetireTex();
+}
+
+void Gfx_FlushTex(void)
+{
+	//Wait for every upload, use before freeing data that might still be uploading
+	Gfx_WaitTex(texfence);
+}
+
+static void Gfx_UseTex(Gfx_Tex *tex)
+{
+	//Wait for the texture's upload the first time it's drawn, if it hasn't finished already
+	if ((s32)(tex->fence - texfence_done) > 0 && !Gfx_TexDone(tex->fence))
+		Gfx_WaitTex(tex->fence);
+}
+
+Gfx_TexFence Gfx_LoadTex(Gfx_Tex *tex, IO_Data data, Gfx_LoadTex_Flag flag)
+{
+	return Gfx_LoadTexAt(tex, data, NULL, NULL, flag);
+}
+
+Gfx_TexFence Gfx_LoadTexAt(Gfx_Tex *tex, IO_Data data, const POINT *tpos, const POINT *cpos, Gfx_LoadTex_Flag flag)
 {
 	//Catch NULL data
 	if (data == NULL)
@@ -133,35 +213,100 @@ void Gfx_LoadTex(Gfx_Tex *tex, IO_Data data, Gfx_LoadTex_Flag flag)
 		tex->pxshift = (2 - (tparam.mode & 0x3));
 	}
 	
-	//Upload pixel data to framebuffer
+	//Pixel data and CLUT are uploaded together
+	Gfx_TexUpload upload;
+	upload.paddr = NULL;
+	upload.caddr = NULL;
+	upload.free = (flag & GFX_LOADTEX_FREE) ? data : NULL;
+	
+	//Get pixel data destination
 	if (!(flag & GFX_LOADTEX_NOTEX))
 	{
+		//The TIM rects point into data so they're copied instead of modified
+		upload.prect = *tparam.prect;
+		upload.paddr = (u32*)tparam.paddr;
+		if (tpos != NULL)
+		{
+			upload.prect.x = tpos->x;
+			upload.prect.y = tpos->y;
+		}
+		else
+		{
+			//Remember which TPages were written to at their authored position
+			for (s32 x = upload.prect.x >> 6; x <= ((upload.prect.x + upload.prect.w - 1) >> 6); x++)
+				tpage_use |= 1 << (((upload.prect.y >> 8) << 4) | (x & 0xF));
+		}
+		
 		if (tex != NULL)
 		{
-			tex->tim_prect = *tparam.prect;
-			tex->tpage = getTPage(tparam.mode & 0x3, 0, tparam.prect->x, tparam.prect->y);
+			tex->tim_prect = upload.prect;
+			tex->tpage = getTPage(tparam.mode & 0x3, 0, upload.prect.x, upload.prect.y);
 		}
-		LoadImage(tparam.prect, (u32*)tparam.paddr);
-		DrawSync(0);
 	}
 	
-	//Upload CLUT to framebuffer if present
+	//Get CLUT destination if present, TIMs in a palette bank have none and leave tex->clut to the caller
 	if ((tparam.mode & 0x8) && !(flag & GFX_LOADTEX_NOCLUT))
 	{
+		upload.crect = *tparam.crect;
+		upload.caddr = (u32*)tparam.caddr;
+		if (cpos != NULL)
+		{
+			upload.crect.x = cpos->x;
+			upload.crect.y = cpos->y;
+		}
+		
 		if (tex != NULL)
 		{
-			tex->tim_crect = *tparam.crect;
-			tex->clut = getClut(tparam.crect->x, tparam.crect->y);
+			tex->tim_crect = upload.crect;
+			tex->clut = getClut(upload.crect.x, upload.crect.y);
+		}
+	}
+	
+	//Start pixel and CLUT transfers together without waiting, the GPU runs them after anything it's still drawing
+	if (upload.paddr != NULL)
+		LoadImage(&upload.prect, upload.paddr);
+	if (upload.caddr != NULL)
+		LoadImage(&upload.crect, upload.caddr);
+	Gfx_TexFence fence = ++texfence;
+	if (tex != NULL)
+		tex->fence = fence;
+	
+	//Free data once the upload is done
+	if (flag & GFX_LOADTEX_ASYNC)
+	{
+		if (upload.free != NULL)
+		{
+			if (texqueue_len >= TEXQUEUE_LEN)
+				Gfx_FlushTex();
+			texqueue[texqueue_len++] = upload.free;
 		}
-		LoadImage(tparam.crect, (u32*)tparam.caddr);
-		DrawSync(0);
+		return fence;
 	}
 	
-	//Free data
-	if (flag & GFX_LOADTEX_FREE)
-		Mem_Free(data);
+	//Wait for it now
+	Gfx_WaitTex(fence);
+	Mem_Free(upload.free);
+	return fence;
 }
 
+void Gfx_ClearTPageUse(void)
+{
+	tpage_use = 0;
+}
+
+u32 Gfx_GetTPageUse(void)
+{
+	return tpage_use;
+}
+
+#ifdef GFX_TPAGESTAT
+	void Gfx_GetTPageStat(u32 *packets, u32 *bytes)
+	{
+		*packets = tpage_saved_frame;
+		*bytes = tpage_saved_frame * sizeof(DR_TPAGE);
+	}
+#endif
+
 void Gfx_DrawRect(const RECT *rect, u8 r, u8 g, u8 b)
 {
 	//Add quad
@@ -196,6 +341,8 @@ void Gfx_BlendRect(const RECT *rect, u8 r, u8 g, u8 b, u8 mode)
 
 void Gfx_BlitTexCol(Gfx_Tex *tex, const RECT *src, s32 x, s32 y, u8 r, u8 g, u8 b)
 {
+	Gfx_UseTex(tex);
+	
 	//Add sprite
 	SPRT *sprt = (SPRT*)nextpri;
 	setSprt(sprt);
@@ -204,16 +351,30 @@ void Gfx_BlitTexCol(Gfx_Tex *tex, const RECT *src, s32 x, s32 y, u8 r, u8 g, u8
 	setUV0(sprt, src->x, src->y);
 	setRGB0(sprt, r, g, b);
 	sprt->clut = tex->clut;
+	nextpri += sizeof(SPRT);
 	
+	//Link behind the last tpage change if nothing else was added since and it's the same tpage
+	if (blit_tpage != NULL && blit_end == (u8*)sprt && blit_tpage_mode == tex->tpage)
+	{
+		addPrim(blit_tpage, sprt);
+		blit_end = nextpri;
+		#ifdef GFX_TPAGESTAT
+			tpage_saved++;
+		#endif
+		return;
+	}
 	addPrim(ot[db], sprt);
-	nextpri += sizeof(SPRT);
 	
-	//Add tpage change (TODO: reduce tpage changes)
+	//Add tpage change
 	DR_TPAGE *tpage = (DR_TPAGE*)nextpri;
 	setDrawTPage(tpage, 0, 1, tex->tpage);
 	
 	addPrim(ot[db], tpage);
 	nextpri += sizeof(DR_TPAGE);
+	
+	blit_tpage = tpage;
+	blit_tpage_mode = tex->tpage;
+	blit_end = nextpri;
 }
 
 void Gfx_BlitTex(Gfx_Tex *tex, const RECT *src, s32 x, s32 y)
@@ -223,6 +384,8 @@ void Gfx_BlitTex(Gfx_Tex *tex, const RECT *src, s32 x, s32 y)
 
 void Gfx_DrawTexCol(Gfx_Tex *tex, const RECT *src, const RECT *dst, u8 r, u8 g, u8 b)
 {
+	Gfx_UseTex(tex);
+	
 	//Add quad
 	POLY_FT4 *quad = (POLY_FT4*)nextpri;
 	setPolyFT4(quad);
@@ -243,6 +406,8 @@ void Gfx_DrawTex(Gfx_Tex *tex, const RECT *src, const RECT *dst)
 
 void Gfx_BlendTex(Gfx_Tex *tex, const RECT *src, const RECT *dst, u8 opacity, u8 mode)
 {
+	Gfx_UseTex(tex);
+	
 	//some math to make color be in some scale between 0 - 100
 	u8 scaleop = (255 * opacity) / 100;
 
@@ -262,6 +427,8 @@ void Gfx_BlendTex(Gfx_Tex *tex, const RECT *src, const RECT *dst, u8 opacity, u8
 
 void Gfx_DrawTexArbCol(Gfx_Tex *tex, const RECT *src, const POINT *p0, const POINT *p1, const POINT *p2, const POINT *p3, u8 r, u8 g, u8 b)
 {
+	Gfx_UseTex(tex);
+	
 	//Add quad
 	POLY_FT4 *quad = (POLY_FT4*)nextpri;
 	setPolyFT4(quad);
@@ -282,6 +449,8 @@ void Gfx_DrawTexArb(Gfx_Tex *tex, const RECT *src, const POINT *p0, const POINT
 
 void Gfx_BlendTexArbCol(Gfx_Tex *tex, const RECT *src, const POINT *p0, const POINT *p1, const POINT *p2, const POINT *p3, u8 r, u8 g, u8 b, u8 mode)
 {
+	Gfx_UseTex(tex);
+	
 	//Add quad
 	POLY_FT4 *quad = (POLY_FT4*)nextpri;
 	setPolyFT4(quad);
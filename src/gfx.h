@@ -10,6 +10,9 @@
 #include "psx.h"
 #include "io.h"
 
+//Gfx stats
+//#define GFX_TPAGESTAT //This will enable the Gfx_GetTPageStat function which returns how many tpage changes Gfx_BlitTexCol saved last frame
+
 //Gfx constants
 #define SCREEN_WIDTH   320
 #define SCREEN_HEIGHT  240
@@ -27,17 +30,15 @@
 #define SCREEN_TALLOADD2 (SCREEN_TALLOADD >> 1)
 
 //Gfx structures
+typedef u32 Gfx_TexFence; //Handle to a texture upload, see Gfx_LoadTex
+
 typedef struct
 {
-#ifdef PSXF_PC
-	u16 tpage_x;
-	u16 tpage_y;
-#else
 	u32 tim_mode;
 	RECT tim_prect, tim_crect;
 	u16 tpage, clut;
 	u8 pxshift;
-#endif
+	Gfx_TexFence fence; //Upload that's waited on the first time the texture is drawn
 } Gfx_Tex;
 
 //Gfx functions
@@ -52,7 +53,18 @@ typedef u8 Gfx_LoadTex_Flag;
 #define GFX_LOADTEX_FREE   (1 << 0)
 #define GFX_LOADTEX_NOTEX  (1 << 1)
 #define GFX_LOADTEX_NOCLUT (1 << 2)
-void Gfx_LoadTex(Gfx_Tex *tex, IO_Data data, Gfx_LoadTex_Flag flag);
+#define GFX_LOADTEX_ASYNC  (1 << 3) //Don't wait for the upload, data must stay valid until its fence is done
+
+Gfx_TexFence Gfx_LoadTex(Gfx_Tex *tex, IO_Data data, Gfx_LoadTex_Flag flag);
+Gfx_TexFence Gfx_LoadTexAt(Gfx_Tex *tex, IO_Data data, const POINT *tpos, const POINT *cpos, Gfx_LoadTex_Flag flag);
+boolean Gfx_TexDone(Gfx_TexFence fence);
+void Gfx_WaitTex(Gfx_TexFence fence);
+void Gfx_FlushTex(void);
+void Gfx_ClearTPageUse(void);
+u32 Gfx_GetTPageUse(void);
+#ifdef GFX_TPAGESTAT
+	void Gfx_GetTPageStat(u32 *packets, u32 *bytes);
+#endif
 
 void Gfx_DrawRect(const RECT *rect, u8 r, u8 g, u8 b);
 void Gfx_BlendRect(const RECT *rect, u8 r, u8 g, u8 b, u8 mode);
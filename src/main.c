@@ -94,6 +94,25 @@ int main(int argc, char **argv)
 			#ifndef MEM_BAR
 				FntPrint("mem: %08X/%08X (max %08X)\n", mem_used, mem_size, mem_max);
 			#endif
+			
+			//Heap fragmentation
+			size_t mem_free, mem_largest;
+			Mem_GetFrag(&mem_free, &mem_largest);
+			FntPrint("frag: largest %08X of %08X free\n", mem_largest, mem_free);
+		#endif
+		
+		#ifdef CHAR_TEXSTAT
+			//Character texture cache stats
+			u32 tex_hit, tex_miss, tex_bytes;
+			Character_GetTexStat(&tex_hit, &tex_miss, &tex_bytes);
+			FntPrint("tex: hit %d miss %d (%d bytes)\n", tex_hit, tex_miss, tex_bytes);
+		#endif
+		
+		#ifdef GFX_TPAGESTAT
+			//Tpage changes saved last frame
+			u32 tpage_packets, tpage_bytes;
+			Gfx_GetTPageStat(&tpage_packets, &tpage_bytes);
+			FntPrint("tpage: saved %d (%d bytes)\n", tpage_packets, tpage_bytes);
 		#endif
 		
 		//Tick and draw game
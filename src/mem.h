@@ -7,6 +7,15 @@
 	
 	Additional control defines:
 	MEM_STAT - This will enable the Mem_GetStat function which returns information about available memory in the heap.
+	MEM_QUICKMAX - Largest block size (including header) that's kept on a size class free list when freed, 0 to disable.
+	MEM_QUICKDEPTH - Maximum number of blocks kept on each size class free list.
+	
+	Arena:
+	Between Mem_ArenaBegin and Mem_ArenaEnd, allocations are made from an arena at the end of the heap instead of going through the heap,
+	into the first freed arena gap that fits, else bumped down below the lowest arena block.
+	Arena blocks stay in the arena after Mem_ArenaEnd and can still be freed one by one, freeing the lowest one pops it (and any freed blocks above it).
+	Mem_ArenaReset drops every arena block at once, freeing a dropped block is ignored until the next Mem_Alloc or Mem_ArenaBegin.
+	If the arena runs into the heap, allocations fall back to the heap.
 */
 
 #ifndef MEM_GUARD_MEM_H
@@ -18,6 +27,13 @@
 #define MEM_ALIGNSIZE 0x10
 #define MEM_ALIGN(x) (((size_t)(x) + 0xF) & ~0xF)
 
+#ifndef MEM_QUICKMAX
+	#define MEM_QUICKMAX 0x200
+#endif
+#ifndef MEM_QUICKDEPTH
+	#define MEM_QUICKDEPTH 32
+#endif
+
 #ifdef PSXF_STDMEM
 
 #include <stdlib.h>
@@ -27,6 +43,9 @@
 #define Mem_Init(x,y)
 #define Mem_Alloc malloc
 #define Mem_Free free
+#define Mem_ArenaBegin()
+#define Mem_ArenaEnd()
+#define Mem_ArenaReset()
 
 #else
 
@@ -34,8 +53,12 @@
 int Mem_Init(void *ptr, size_t size);
 void *Mem_Alloc(size_t size);
 void Mem_Free(void *ptr);
+void Mem_ArenaBegin(void);
+void Mem_ArenaEnd(void);
+void Mem_ArenaReset(void);
 #ifdef MEM_STAT
 	void Mem_GetStat(size_t *used, size_t *size, size_t *max);
+	void Mem_GetFrag(size_t *free, size_t *largest);
 #endif
 
 /* Implementation */
@@ -47,10 +70,36 @@ typedef struct Mem_Header
 	size_t size;
 } Mem_Header;
 #define MEM_HEDSIZE (MEM_ALIGN(sizeof(Mem_Header)))
+#define MEM_QUICKBIT 1 /* Set in the size of a block that's on a size class free list */
 
 static Mem_Header *mem = NULL;
+static Mem_Header *mem_last; /* Last block in the heap, mem if empty */
+static char *mem_arena; /* Lowest arena block, the end of the heap if empty */
+static char *mem_dropped; /* Lowest block dropped by Mem_ArenaReset, the end of the heap once allocating again */
+static int mem_arena_on;
 #ifdef MEM_STAT
-	static size_t mem_used, mem_max;
+	static size_t mem_used, mem_max, mem_arena_used;
+#endif
+#define MEM_END ((char*)mem + mem->size)
+
+/*
+	Size class free lists
+	Freed small blocks stay linked in the heap, marked with MEM_QUICKBIT in their size, and are pushed onto the free list for their size,
+	allocations of the same size class pop them in O(1) instead of walking the heap.
+	Mem_Find gives back any cached block it walks past, so each one is walked over at most once and a miss never walks them again.
+	The list links are stored in the block's data, so blocks without room for them aren't cached.
+*/
+#if MEM_QUICKMAX > 0
+	#define MEM_QUICKCLASSES (MEM_QUICKMAX / MEM_ALIGNSIZE)
+	
+	typedef struct Mem_Quick
+	{
+		struct Mem_Quick *prev, *next;
+	} Mem_Quick;
+	#define MEM_QUICKMIN (MEM_HEDSIZE + sizeof(Mem_Quick))
+	
+	static Mem_Quick *mem_quick[MEM_QUICKCLASSES];
+	static unsigned char mem_quick_len[MEM_QUICKCLASSES];
 #endif
 
 int Mem_Init(void *ptr, size_t size)
@@ -66,10 +115,28 @@ int Mem_Init(void *ptr, size_t size)
 	mem->prev = NULL;
 	mem->next = NULL;
 	mem->size = ((char*)ptr + size) - (char*)mem;
+	mem_last = mem;
+	
+	/* Initial arena */
+	mem_dropped = mem_arena = MEM_END;
+	mem_arena_on = 0;
+	
+	/* Initial free lists */
+	#if MEM_QUICKMAX > 0
+	{
+		size_t i;
+		for (i = 0; i < MEM_QUICKCLASSES; i++)
+		{
+			mem_quick[i] = NULL;
+			mem_quick_len[i] = 0;
+		}
+	}
+	#endif
 	
 	/* Initial mem state */
 	#ifdef MEM_STAT
 		mem_max = mem_used = MEM_HEDSIZE;
+		mem_arena_used = 0;
 	#endif
 	
 	return 0;
@@ -82,15 +149,63 @@ static Mem_Header *Mem_GetHeader(void *ptr)
 	return (Mem_Header*)((char*)ptr - MEM_HEDSIZE);
 }
 
-void *Mem_Alloc(size_t size)
+static void Mem_Unlink(Mem_Header *head)
 {
-	/* Ensure we have a heap */
-	if (mem == NULL)
-		return NULL;
+	/* Unlink header */
+	if ((head->prev->next = head->next) != NULL)
+		head->next->prev = head->prev;
+	else
+		mem_last = head->prev;
+}
+
+#if MEM_QUICKMAX > 0
+	static void Mem_QuickPush(Mem_Header *head)
+	{
+		/* Push block onto its size class free list and mark it as cached */
+		Mem_Quick *quick = (Mem_Quick*)((char*)head + MEM_HEDSIZE);
+		size_t i = head->size / MEM_ALIGNSIZE - 1;
+		quick->prev = NULL;
+		if ((quick->next = mem_quick[i]) != NULL)
+			quick->next->prev = quick;
+		mem_quick[i] = quick;
+		mem_quick_len[i]++;
+		head->size |= MEM_QUICKBIT;
+	}
 	
-	/* Get true size we have to fit */
-	size = MEM_ALIGN(size + MEM_HEDSIZE);
+	static void Mem_QuickRemove(Mem_Header *head)
+	{
+		/* Remove block from its size class free list */
+		Mem_Quick *quick = (Mem_Quick*)((char*)head + MEM_HEDSIZE);
+		size_t i;
+		head->size &= ~(size_t)MEM_QUICKBIT;
+		i = head->size / MEM_ALIGNSIZE - 1;
+		if (quick->prev != NULL)
+			quick->prev->next = quick->next;
+		else
+			mem_quick[i] = quick->next;
+		if (quick->next != NULL)
+			quick->next->prev = quick->prev;
+		mem_quick_len[i]--;
+	}
 	
+	static void Mem_FlushQuick(void)
+	{
+		/* Give all blocks on free lists back to the heap */
+		size_t i;
+		for (i = 0; i < MEM_QUICKCLASSES; i++)
+		{
+			while (mem_quick[i] != NULL)
+			{
+				Mem_Header *head = Mem_GetHeader(mem_quick[i]);
+				Mem_QuickRemove(head);
+				Mem_Unlink(head);
+			}
+		}
+	}
+#endif
+
+static void *Mem_Find(size_t size)
+{
 	/* Get header pointer */
 	Mem_Header *head, *prev, *next;
 	char *hpos = (char*)mem + MEM_HEDSIZE;
@@ -100,6 +215,17 @@ void *Mem_Alloc(size_t size)
 	
 	while (1)
 	{
+		#if MEM_QUICKMAX > 0
+			if (next != NULL && (next->size & MEM_QUICKBIT))
+			{
+				/* Give cached blocks back to the heap as they're walked past */
+				Mem_QuickRemove(next);
+				Mem_Unlink(next);
+				next = prev->next;
+				continue;
+			}
+		#endif
+		
 		if (next != NULL)
 		{
 			/* Check against the next block */
@@ -118,8 +244,8 @@ void *Mem_Alloc(size_t size)
 		}
 		else
 		{
-			/* Check against end of heap */
-			size_t cleft = ((char*)mem + mem->size) - hpos;
+			/* Check against arena */
+			size_t cleft = mem_arena - hpos;
 			if (cleft < size)
 				return NULL;
 			
@@ -134,15 +260,99 @@ void *Mem_Alloc(size_t size)
 	head->prev = prev;
 	if ((head->next = prev->next) != NULL)
 		head->next->prev = head;
+	else
+		mem_last = head;
 	prev->next = head;
 	
+	return (void*)(hpos + MEM_HEDSIZE);
+}
+
+static void *Mem_ArenaAlloc(size_t size)
+{
+	Mem_Header *head, *next;
+	char *hend;
+	
+	/* Use the first freed arena gap that fits, merging freed blocks as they're walked */
+	for (head = (Mem_Header*)mem_arena; (char*)head != MEM_END; head = (Mem_Header*)((char*)head + head->size))
+	{
+		if (head->prev != head)
+			continue;
+		while ((char*)head + head->size != MEM_END)
+		{
+			next = (Mem_Header*)((char*)head + head->size);
+			if (next->prev != next)
+				break;
+			head->size += next->size;
+		}
+		if (head->size < size)
+			continue;
+		
+		/* Split the rest of the gap off as a freed block if there's room for its header */
+		if (head->size - size >= MEM_HEDSIZE)
+		{
+			next = (Mem_Header*)((char*)head + size);
+			next->size = head->size - size;
+			next->prev = next;
+			head->size = size;
+		}
+		head->prev = NULL;
+		return (void*)((char*)head + MEM_HEDSIZE);
+	}
+	
+	/* Get end of the last heap block */
+	hend = (mem_last == mem) ? ((char*)mem + MEM_HEDSIZE) : ((char*)mem_last + (mem_last->size & ~(size_t)MEM_QUICKBIT));
+	
+	/* Bump arena down */
+	if ((size_t)(mem_arena - hend) < size)
+		return NULL;
+	mem_arena -= size;
+	
+	head = (Mem_Header*)mem_arena;
+	head->size = size;
+	head->prev = NULL; /* Points to itself once freed */
+	return (void*)(mem_arena + MEM_HEDSIZE);
+}
+
+void *Mem_Alloc(size_t size)
+{
+	void *ptr;
+	
+	/* Ensure we have a heap */
+	if (mem == NULL)
+		return NULL;
+	
+	/* Get true size we have to fit */
+	size = MEM_ALIGN(size + MEM_HEDSIZE);
+	
+	/* Blocks dropped by Mem_ArenaReset can be reused from here on */
+	mem_dropped = MEM_END;
+	
+	if (mem_arena_on && (ptr = Mem_ArenaAlloc(size)) != NULL)
+	{
+		/* Allocated from arena, a reused gap can be a little bigger */
+		#ifdef MEM_STAT
+			mem_arena_used += (size = Mem_GetHeader(ptr)->size);
+		#endif
+	}
+	#if MEM_QUICKMAX > 0
+		else if (size <= MEM_QUICKMAX && (ptr = mem_quick[size / MEM_ALIGNSIZE - 1]) != NULL)
+		{
+			/* Pop block from its size class free list */
+			Mem_QuickRemove(Mem_GetHeader(ptr));
+		}
+	#endif
+	else if ((ptr = Mem_Find(size)) == NULL)
+	{
+		return NULL;
+	}
+	
 	#ifdef MEM_STAT
 		/* Update stats */
 		if ((mem_used += size) >= mem_max)
 			mem_max = mem_used;
 	#endif
 	
-	return (void*)(hpos + MEM_HEDSIZE);
+	return ptr;
 }
 
 void Mem_Free(void *ptr)
@@ -152,14 +362,66 @@ void Mem_Free(void *ptr)
 		return;
 	Mem_Header *head = Mem_GetHeader(ptr);
 	
-	/* Unlink header */
-	if ((head->prev->next = head->next) != NULL)
-		head->next->prev = head->prev;
+	if ((char*)head >= mem_dropped)
+	{
+		/* Already dropped by Mem_ArenaReset */
+		return;
+	}
+	if ((char*)head >= mem_arena)
+	{
+		/* Mark arena block as freed, then pop freed blocks off the bottom */
+		#ifdef MEM_STAT
+			mem_used -= head->size;
+			mem_arena_used -= head->size;
+		#endif
+		head->prev = head;
+		while (mem_arena != MEM_END && ((Mem_Header*)mem_arena)->prev == (Mem_Header*)mem_arena)
+			mem_arena += ((Mem_Header*)mem_arena)->size;
+		return;
+	}
 	
 	#ifdef MEM_STAT
 		/* Update stats */
 		mem_used -= head->size;
 	#endif
+	
+	#if MEM_QUICKMAX > 0
+		if (head->size <= MEM_QUICKMAX && head->size >= MEM_QUICKMIN && mem_quick_len[head->size / MEM_ALIGNSIZE - 1] < MEM_QUICKDEPTH)
+		{
+			/* Keep block linked in the heap for the next allocation of its size class */
+			Mem_QuickPush(head);
+			return;
+		}
+	#endif
+	
+	Mem_Unlink(head);
+}
+
+void Mem_ArenaBegin(void)
+{
+	/* Give cached blocks back to the heap so they don't end up between what's loaded, then start allocating from the arena */
+	#if MEM_QUICKMAX > 0
+		Mem_FlushQuick();
+	#endif
+	mem_dropped = MEM_END;
+	mem_arena_on = 1;
+}
+
+void Mem_ArenaEnd(void)
+{
+	/* Stop allocating from the arena, its blocks stay where they are */
+	mem_arena_on = 0;
+}
+
+void Mem_ArenaReset(void)
+{
+	/* Drop every arena block in one go, remembering where they were so freeing them is ignored */
+	#ifdef MEM_STAT
+		mem_used -= mem_arena_used;
+		mem_arena_used = 0;
+	#endif
+	mem_dropped = mem_arena;
+	mem_arena = MEM_END;
 }
 
 #ifdef MEM_STAT
@@ -172,6 +434,42 @@ void Mem_Free(void *ptr)
 		if (max != NULL)
 			*max = mem_max;
 	}
+	
+	void Mem_GetFrag(size_t *free, size_t *largest)
+	{
+		/* Walk the gaps between heap blocks, up to the arena, cached blocks count as free space */
+		Mem_Header *head;
+		char *hpos = (char*)mem + MEM_HEDSIZE, *bottom;
+		size_t gap;
+		
+		*free = *largest = 0;
+		for (head = mem->next;; head = head->next)
+		{
+			#if MEM_QUICKMAX > 0
+				if (head != NULL && (head->size & MEM_QUICKBIT))
+					continue;
+			#endif
+			gap = ((head != NULL) ? (char*)head : mem_arena) - hpos;
+			*free += gap;
+			if (gap > *largest)
+				*largest = gap;
+			if (head == NULL)
+				break;
+			hpos = (char*)head + head->size;
+		}
+		
+		/* Then runs of freed arena blocks */
+		for (bottom = mem_arena; bottom != MEM_END;)
+		{
+			for (gap = 0; bottom != MEM_END && ((Mem_Header*)bottom)->prev == (Mem_Header*)bottom; bottom += ((Mem_Header*)bottom)->size)
+				gap += ((Mem_Header*)bottom)->size;
+			*free += gap;
+			if (gap > *largest)
+				*largest = gap;
+			if (bottom != MEM_END)
+				bottom += ((Mem_Header*)bottom)->size;
+		}
+	}
 #endif
 
 #endif /* MEM_IMPLEMENTATION */
@@ -265,10 +265,11 @@ void Menu_Load(MenuPage page)
 	
 	//Load menu assets
 	IO_Data menu_arc = IO_Read("\\MENU\\MENU.ARC;1");
-	Gfx_LoadTex(&menu.tex_back,  Archive_Find(menu_arc, "back.tim"),  0);
-	Gfx_LoadTex(&menu.tex_story, Archive_Find(menu_arc, "story.tim"), 0);
-	Gfx_LoadTex(&menu.tex_title, Archive_Find(menu_arc, "title.tim"), 0);
-	Gfx_LoadTex(&menu.tex_hud1, Archive_Find(menu_arc, "hud1.tim"), 0);
+	Gfx_LoadTex(&menu.tex_back,  Archive_FindHash(menu_arc, ARCHIVE_HASH("back.tim")),  GFX_LOADTEX_ASYNC);
+	Gfx_LoadTex(&menu.tex_story, Archive_FindHash(menu_arc, ARCHIVE_HASH("story.tim")), GFX_LOADTEX_ASYNC);
+	Gfx_LoadTex(&menu.tex_title, Archive_FindHash(menu_arc, ARCHIVE_HASH("title.tim")), GFX_LOADTEX_ASYNC);
+	Gfx_LoadTex(&menu.tex_hud1, Archive_FindHash(menu_arc, ARCHIVE_HASH("hud1.tim")), GFX_LOADTEX_ASYNC);
+	Gfx_FlushTex();
 	Mem_Free(menu_arc);
 	
 	FontData_Load(&menu.font_bold, Font_Bold);
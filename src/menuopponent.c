@@ -96,7 +96,7 @@ void Char_MenuOpponent_SetFrame(void *user, u8 frame)
 		//Check if new art shall be loaded
 		const CharFrame *cframe = &char_menuopponent_frame[this->frame = frame];
 		if (cframe->tex != this->tex_id)
-			Gfx_LoadTex(&this->tex, this->arc_ptr[this->tex_id = cframe->tex], 0);
+			Gfx_LoadTex(&this->tex, this->arc_ptr[this->tex_id = cframe->tex], GFX_LOADTEX_ASYNC);
 	}
 }
 
@@ -132,7 +132,8 @@ void Char_MenuOpponent_Free(Character *character)
 {
 	Char_MenuOpponent *this = (Char_MenuOpponent*)character;
 	
-	//Free art
+	//Free art once queued uploads from it are done
+	Gfx_FlushTex();
 	Mem_Free(this->arc_main);
 }
 
@@ -174,19 +175,19 @@ Character *Char_MenuOpponent_New(fixed_t x, fixed_t y)
 	//Load art
 	this->arc_main = IO_Read("\\MENU\\OPPO.ARC;1");
 	
-	const char **pathp = (const char *[]){
-		"dad.tim",   //MenuOpponent_ArcMain_Dad
-		"spooky.tim",  //MenuOpponent_ArcMain_Spooky
-		"pico.tim", //MenuOpponent_ArcMain_Pico
-		"mom.tim",  //MenuOpponent_ArcMain_Mom
-		"xmasp0.tim",  //MenuOpponent_ArcMain_Xmasp0
-		"xmasp1.tim",  //MenuOpponent_ArcMain_Xmasp1
-		"senpai.tim",  //MenuOpponent_ArcMain_Senpai
-		NULL
+	const u32 *hashp = (const u32[]){
+		ARCHIVE_HASH("dad.tim"),   //MenuOpponent_ArcMain_Dad
+		ARCHIVE_HASH("spooky.tim"),  //MenuOpponent_ArcMain_Spooky
+		ARCHIVE_HASH("pico.tim"), //MenuOpponent_ArcMain_Pico
+		ARCHIVE_HASH("mom.tim"),  //MenuOpponent_ArcMain_Mom
+		ARCHIVE_HASH("xmasp0.tim"),  //MenuOpponent_ArcMain_Xmasp0
+		ARCHIVE_HASH("xmasp1.tim"),  //MenuOpponent_ArcMain_Xmasp1
+		ARCHIVE_HASH("senpai.tim"),  //MenuOpponent_ArcMain_Senpai
+		0
 	};
 	IO_Data *arc_ptr = this->arc_ptr;
-	for (; *pathp != NULL; pathp++)
-		*arc_ptr++ = Archive_Find(this->arc_main, *pathp);
+	for (; *hashp != 0; hashp++)
+		*arc_ptr++ = Archive_FindHash(this->arc_main, *hashp);
 	
 	//Initialize render state
 	this->tex_id = this->frame = 0xFF;
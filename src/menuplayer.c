@@ -63,7 +63,7 @@ void Char_MenuPlayer_SetFrame(void *user, u8 frame)
 		//Check if new art shall be loaded
 		const CharFrame *cframe = &char_menuplayer_frame[this->frame = frame];
 		if (cframe->tex != this->tex_id)
-			Gfx_LoadTex(&this->tex, this->arc_ptr[this->tex_id = cframe->tex], 0);
+			Gfx_LoadTex(&this->tex, this->arc_ptr[this->tex_id = cframe->tex], GFX_LOADTEX_ASYNC);
 	}
 }
 
@@ -98,7 +98,8 @@ void Char_MenuPlayer_Free(Character *character)
 {
 	Char_MenuPlayer *this = (Char_MenuPlayer*)character;
 	
-	//Free art
+	//Free art once queued uploads from it are done
+	Gfx_FlushTex();
 	Mem_Free(this->arc_main);
 }
 
@@ -140,14 +141,14 @@ Character *Char_MenuPlayer_New(fixed_t x, fixed_t y)
 	//Load art
 	this->arc_main = IO_Read("\\MENU\\PLAYER.ARC;1");
 	
-	const char **pathp = (const char *[]){
-		"bf0.tim",   //MenuPlayer_ArcMain_BF0
-		"bf1.tim",   //MenuPlayer_ArcMain_BF1
-		NULL
+	const u32 *hashp = (const u32[]){
+		ARCHIVE_HASH("bf0.tim"),   //MenuPlayer_ArcMain_BF0
+		ARCHIVE_HASH("bf1.tim"),   //MenuPlayer_ArcMain_BF1
+		0
 	};
 	IO_Data *arc_ptr = this->arc_ptr;
-	for (; *pathp != NULL; pathp++)
-		*arc_ptr++ = Archive_Find(this->arc_main, *pathp);
+	for (; *hashp != 0; hashp++)
+		*arc_ptr++ = Archive_FindHash(this->arc_main, *hashp);
 	
 	//Initialize render state
 	this->tex_id = this->frame = 0xFF;
@@ -6,7 +6,6 @@
 
 #include "combo.h"
 
-#include "../mem.h"
 #include "../timer.h"
 #include "../random.h"
 
@@ -224,14 +223,12 @@ void Obj_Combo_Free(Object *obj)
 	(void)obj;
 }
 
-Obj_Combo *Obj_Combo_New(fixed_t x, fixed_t y, u8 hit_type, u16 combo)
+Obj_Combo *Obj_Combo_New(ObjectPool *pool, fixed_t x, fixed_t y, u8 hit_type, u16 combo)
 {
 	(void)x;
 	
-	//Allocate new object
-	Obj_Combo *this = (Obj_Combo*)Mem_Alloc(sizeof(Obj_Combo));
-	if (this == NULL)
-		return NULL;
+	//Take object from pool
+	Obj_Combo *this = (Obj_Combo*)ObjectPool_Alloc(pool);
 	
 	//Set object functions and position
 	if (stage.stage_id >= StageId_6_1 && stage.stage_id <= StageId_6_3)
@@ -7,6 +7,7 @@
 #include "object.h"
 
 #include "../mem.h"
+#include "../main.h"
 
 //Object functions
 void ObjectList_Add(ObjectList *list, Object *obj)
@@ -65,3 +66,92 @@ void ObjectList_Free(ObjectList *list)
 	//Clear list pointer
 	*list = NULL;
 }
+
+void ObjectPool_Init(ObjectPool *pool, size_t size, u8 cap)
+{
+	//Allocate object storage and index stacks together
+	pool->size = (size + 3) & ~3;
+	pool->cap = cap;
+	pool->data = Mem_Alloc(pool->size * cap + (cap << 1));
+	if (pool->data == NULL)
+	{
+		sprintf(error_msg, "[ObjectPool_Init] Failed to allocate object pool");
+		ErrorLock();
+		return;
+	}
+	pool->free_i = pool->data + pool->size * cap;
+	pool->live_i = pool->free_i + cap;
+	
+	//Initialize with all objects free
+	pool->live_len = 0;
+	for (pool->free_len = 0; pool->free_len < cap; pool->free_len++)
+		pool->free_i[pool->free_len] = cap - 1 - pool->free_len;
+}
+
+Object *ObjectPool_Alloc(ObjectPool *pool)
+{
+	//Drop oldest object if full
+	if (pool->free_len == 0)
+	{
+		u8 i = pool->live_i[0];
+		Object *obj = (Object*)(pool->data + pool->size * i);
+		obj->free(obj);
+		
+		pool->live_len--;
+		for (u8 j = 0; j < pool->live_len; j++)
+			pool->live_i[j] = pool->live_i[j + 1];
+		pool->free_i[pool->free_len++] = i;
+	}
+	
+	//Take free object and push it as the newest
+	u8 i = pool->free_i[--pool->free_len];
+	pool->live_i[pool->live_len++] = i;
+	return (Object*)(pool->data + pool->size * i);
+}
+
+void ObjectPool_Tick(ObjectPool *pool)
+{
+	//Tick newest to oldest, same draw order as object lists
+	for (u8 j = pool->live_len; j-- > 0;)
+	{
+		u8 i = pool->live_i[j];
+		Object *obj = (Object*)(pool->data + pool->size * i);
+		if (obj->tick(obj))
+		{
+			obj->free(obj);
+			pool->free_i[pool->free_len++] = i;
+			pool->live_i[j] = 0xFF;
+		}
+	}
+	
+	//Remove finished objects, keeping the rest in order
+	u8 live_len = 0;
+	for (u8 j = 0; j < pool->live_len; j++)
+		if (pool->live_i[j] != 0xFF)
+			pool->live_i[live_len++] = pool->live_i[j];
+	pool->live_len = live_len;
+}
+
+void ObjectPool_Clear(ObjectPool *pool)
+{
+	//Free all live objects
+	while (pool->live_len != 0)
+	{
+		u8 i = pool->live_i[--pool->live_len];
+		Object *obj = (Object*)(pool->data + pool->size * i);
+		obj->free(obj);
+		pool->free_i[pool->free_len++] = i;
+	}
+}
+
+void ObjectPool_Free(ObjectPool *pool)
+{
+	//Check if pool is already free'd
+	if (pool->data == NULL)
+		return;
+	
+	//Free objects and storage
+	ObjectPool_Clear(pool);
+	Mem_Free(pool->data);
+	pool->data = NULL;
+}
@@ -22,10 +22,28 @@ typedef struct Object
 
 typedef Object* ObjectList;
 
+typedef struct
+{
+	//Object storage, allocated once
+	u8 *data;
+	size_t size;
+	u8 cap;
+	
+	//Free indices and live indices (oldest first)
+	u8 *free_i, *live_i;
+	u8 free_len, live_len;
+} ObjectPool;
+
 //Object functions
 void ObjectList_Add(ObjectList *list, Object *obj);
 void ObjectList_Remove(ObjectList *list, Object *obj);
 void ObjectList_Tick(ObjectList *list);
 void ObjectList_Free(ObjectList *list);
 
+void ObjectPool_Init(ObjectPool *pool, size_t size, u8 cap);
+Object *ObjectPool_Alloc(ObjectPool *pool);
+void ObjectPool_Tick(ObjectPool *pool);
+void ObjectPool_Clear(ObjectPool *pool);
+void ObjectPool_Free(ObjectPool *pool);
+
 #endif
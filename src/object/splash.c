@@ -6,7 +6,6 @@
 
 #include "splash.h"
 
-#include "../mem.h"
 #include "../timer.h"
 #include "../random.h"
 #include "../mutil.h"
@@ -59,12 +58,10 @@ void Obj_Splash_Free(Object *obj)
 	(void)obj;
 }
 
-Obj_Splash *Obj_Splash_New(fixed_t x, fixed_t y, u8 colour)
+Obj_Splash *Obj_Splash_New(ObjectPool *pool, fixed_t x, fixed_t y, u8 colour)
 {
-	//Allocate new object
-	Obj_Splash *this = (Obj_Splash*)Mem_Alloc(sizeof(Obj_Splash));
-	if (this == NULL)
-		return NULL;
+	//Take object from pool
+	Obj_Splash *this = (Obj_Splash*)ObjectPool_Alloc(pool);
 	
 	//Set object functions
 	this->obj.tick = Obj_Splash_Tick;
@@ -23,6 +23,6 @@ typedef struct
 } Obj_Splash;
 
 //Splash object functions
-Obj_Splash *Obj_Splash_New(fixed_t x, fixed_t y, u8 colour);
+Obj_Splash *Obj_Splash_New(ObjectPool *pool, fixed_t x, fixed_t y, u8 colour);
 
 #endif
@@ -38,6 +38,7 @@ extern char **my_argv;
 	
 	typedef struct {
 		char path[32];
+		u32 size;
 	} CdlFILE;
 	
 	//Misc. functions
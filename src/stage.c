@@ -154,18 +154,26 @@ static void Stage_ScrollCamera(void)
 }
 
 //Stage section functions
-static void Stage_ChangeBPM(u16 bpm, u16 step)
+static fixed_t Stage_GetStepCrochet(u16 bpm)
 {
+	return ((fixed_t)bpm << FIXED_SHIFT) * 8 / 240; //15/12/24
+}
+
+static void Stage_SetSection(Section *section)
+{
+	const SectionStart *start = &stage.section_start[section - stage.sections];
+	u16 bpm = stage.bpm_changes[start->bpm_change].bpm;
+	stage.cur_section = stage.section_base = section;
+	
 	//Update last BPM
 	stage.last_bpm = bpm;
 	
 	//Update timing base
-	if (stage.step_crochet)
-		stage.time_base += FIXED_DIV(((fixed_t)step - stage.step_base) << FIXED_SHIFT, stage.step_crochet);
-	stage.step_base = step;
+	stage.time_base = start->time;
+	stage.step_base = start->step;
 	
 	//Get new crochet and times
-	stage.step_crochet = ((fixed_t)bpm << FIXED_SHIFT) * 8 / 240; //15/12/24
+	stage.step_crochet = Stage_GetStepCrochet(bpm);
 	stage.step_time = FIXED_DIV(FIXED_DEC(12,1), stage.step_crochet);
 	
 	//Get new crochet based values
@@ -174,19 +182,24 @@ static void Stage_ChangeBPM(u16 bpm, u16 step)
 	stage.early_sus_safe = stage.early_safe >> 1;
 }
 
-static Section *Stage_GetPrevSection(Section *section)
+static u16 Stage_GetSectionStart(Section *section)
 {
-	if (section > stage.sections)
-		return section - 1;
-	return NULL;
+	return stage.section_start[section - stage.sections].step;
 }
 
-static u16 Stage_GetSectionStart(Section *section)
+//Returns the last section up to and including max that starts at or before step
+static Section *Stage_FindSectionStep(u16 step, Section *max)
 {
-	Section *prev = Stage_GetPrevSection(section);
-	if (prev == NULL)
-		return 0;
-	return prev->end;
+	u16 lo = 0, hi = max - stage.sections;
+	while (lo < hi)
+	{
+		u16 mid = (lo + hi + 1) >> 1;
+		if (stage.section_start[mid].step <= step)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	return &stage.sections[lo];
 }
 
 //Section scroll structure
@@ -209,6 +222,14 @@ static void Stage_GetSectionScroll(SectionScroll *scroll, Section *section)
 	scroll->start_step = Stage_GetSectionStart(section);
 	scroll->length_step = section->end - scroll->start_step;
 	
+	//Empty sections have no length
+	if (scroll->length_step == 0)
+	{
+		scroll->length = 0;
+		scroll->size = FIXED_UNIT;
+		return;
+	}
+	
 	//Get section time length
 	scroll->length = (scroll->length_step * FIXED_DEC(15,1) / 12) * 24 / bpm;
 	
@@ -255,14 +276,13 @@ static u8 Stage_HitNote(PlayerState *this, u8 type, fixed_t offset)
 	this->health += 230;
 	
 	//Create combo object telling of our combo
-	Obj_Combo *combo = Obj_Combo_New(
+	Obj_Combo_New(
+		&stage.objpool_combo,
 		this->character->focus_x,
 		this->character->focus_y,
 		hit_type,
 		this->combo >= 10 ? this->combo : 0xFFFF
 	);
-	if (combo != NULL)
-		ObjectList_Add(&stage.objlist_fg, (Object*)combo);
 	
 	//Create note splashes if SICK
 	if (hit_type == 0)
@@ -270,13 +290,12 @@ static u8 Stage_HitNote(PlayerState *this, u8 type, fixed_t offset)
 		for (int i = 0; i < 3; i++)
 		{
 			//Create splash object
-			Obj_Splash *splash = Obj_Splash_New(
+			Obj_Splash_New(
+				&stage.objpool_splash,
 				stage.note_x[type],
 				stage.note_y[type] * (stage.prefs.downscroll ? -1 : 1),
 				type & 0x3
 			);
-			if (splash != NULL)
-				ObjectList_Add(&stage.objlist_splash, (Object*)splash);
 		}
 	}
 	
@@ -293,22 +312,33 @@ static void Stage_MissNote(PlayerState *this)
 		this->combo = 0;
 		
 		//Create combo object telling of our lost combo
-		Obj_Combo *combo = Obj_Combo_New(
+		Obj_Combo_New(
+			&stage.objpool_combo,
 			this->character->focus_x,
 			this->character->focus_y,
 			0xFF,
 			0
 		);
-		if (combo != NULL)
-			ObjectList_Add(&stage.objlist_fg, (Object*)combo);
 	}
 }
 
+static NoteLane *Stage_GetLane(u8 type)
+{
+	//Move lane cursor up to cur_note
+	NoteLane *lane = &stage.note_lane[type];
+	u16 cur_i = stage.cur_note - stage.notes;
+	while (lane->cur < lane->len && lane->note[lane->cur] < cur_i)
+		lane->cur++;
+	return lane;
+}
+
 static void Stage_NoteCheck(PlayerState *this, u8 type)
 {
 	//Perform note check
-	for (Note *note = stage.cur_note;; note++)
+	NoteLane *lane = Stage_GetLane(type);
+	for (u16 j = lane->cur; j < lane->len; j++)
 	{
+		Note *note = &stage.notes[lane->note[j]];
 		if (!(note->type & NOTE_FLAG_MINE))
 		{
 			//Check if note can be hit
@@ -317,7 +347,7 @@ static void Stage_NoteCheck(PlayerState *this, u8 type)
 				break;
 			if (note_fp + stage.late_safe < stage.note_scroll)
 				continue;
-			if ((note->type & NOTE_FLAG_HIT) || (note->type & (NOTE_FLAG_OPPONENT | 0x3)) != type || (note->type & NOTE_FLAG_SUSTAIN))
+			if ((note->type & NOTE_FLAG_HIT) || (note->type & NOTE_FLAG_SUSTAIN))
 				continue;
 			
 			//Hit the note
@@ -338,7 +368,7 @@ static void Stage_NoteCheck(PlayerState *this, u8 type)
 				break;
 			if (note_fp + (stage.late_safe * 2 / 5) < stage.note_scroll)
 				continue;
-			if ((note->type & NOTE_FLAG_HIT) || (note->type & (NOTE_FLAG_OPPONENT | 0x3)) != type || (note->type & NOTE_FLAG_SUSTAIN))
+			if ((note->type & NOTE_FLAG_HIT) || (note->type & NOTE_FLAG_SUSTAIN))
 				continue;
 			
 			//Hit the mine
@@ -378,15 +408,17 @@ static void Stage_NoteCheck(PlayerState *this, u8 type)
 static void Stage_SustainCheck(PlayerState *this, u8 type)
 {
 	//Perform note check
-	for (Note *note = stage.cur_note;; note++)
+	NoteLane *lane = Stage_GetLane(type);
+	for (u16 j = lane->cur; j < lane->len; j++)
 	{
 		//Check if note can be hit
+		Note *note = &stage.notes[lane->note[j]];
 		fixed_t note_fp = (fixed_t)note->pos << FIXED_SHIFT;
 		if (note_fp - stage.early_sus_safe > stage.note_scroll)
 			break;
 		if (note_fp + stage.late_sus_safe < stage.note_scroll)
 			continue;
-		if ((note->type & NOTE_FLAG_HIT) || (note->type & (NOTE_FLAG_OPPONENT | 0x3)) != type || !(note->type & NOTE_FLAG_SUSTAIN))
+		if ((note->type & NOTE_FLAG_HIT) || !(note->type & NOTE_FLAG_SUSTAIN))
 			continue;
 		
 		//Hit the note
@@ -444,32 +476,37 @@ static void Stage_ProcessPlayer(PlayerState *this, Pad *pad, boolean playing)
 			u8 i = (this->character == stage.opponent) ? NOTE_FLAG_OPPONENT : 0;
 			
 			u8 hit[4] = {0, 0, 0, 0};
-			for (Note *note = stage.cur_note;; note++)
+			for (u8 j = 0; j < 4; j++)
 			{
-				//Check if note can be hit
-				fixed_t note_fp = (fixed_t)note->pos << FIXED_SHIFT;
-				if (note_fp - stage.early_safe - FIXED_DEC(12,1) > stage.note_scroll)
-					break;
-				if (note_fp + stage.late_safe < stage.note_scroll)
-					continue;
-				if ((note->type & NOTE_FLAG_MINE) || (note->type & NOTE_FLAG_OPPONENT) != i)
-					continue;
-				
-				//Handle note hit
-				if (!(note->type & NOTE_FLAG_SUSTAIN))
+				NoteLane *lane = Stage_GetLane(j | i);
+				for (u16 k = lane->cur; k < lane->len; k++)
 				{
-					if (note->type & NOTE_FLAG_HIT)
+					//Check if note can be hit
+					Note *note = &stage.notes[lane->note[k]];
+					fixed_t note_fp = (fixed_t)note->pos << FIXED_SHIFT;
+					if (note_fp - stage.early_safe - FIXED_DEC(12,1) > stage.note_scroll)
+						break;
+					if (note_fp + stage.late_safe < stage.note_scroll)
 						continue;
-					if (stage.note_scroll >= note_fp)
-						hit[note->type & 0x3] |= 1;
-					else if (!(hit[note->type & 0x3] & 8))
-						hit[note->type & 0x3] |= 2;
-				}
-				else if (!(hit[note->type & 0x3] & 2))
-				{
-					if (stage.note_scroll <= note_fp)
-						hit[note->type & 0x3] |= 4;
-					hit[note->type & 0x3] |= 8;
+					if (note->type & NOTE_FLAG_MINE)
+						continue;
+					
+					//Handle note hit
+					if (!(note->type & NOTE_FLAG_SUSTAIN))
+					{
+						if (note->type & NOTE_FLAG_HIT)
+							continue;
+						if (stage.note_scroll >= note_fp)
+							hit[j] |= 1;
+						else if (!(hit[j] & 8))
+							hit[j] |= 2;
+					}
+					else if (!(hit[j] & 2))
+					{
+						if (stage.note_scroll <= note_fp)
+							hit[j] |= 4;
+						hit[j] |= 8;
+					}
 				}
 			}
 			
@@ -611,14 +648,9 @@ void Stage_BlendTexArb(Gfx_Tex *tex, const RECT *src, const POINT_FIXED *p0, con
 }
 
 //Timer Code
-#include "audio_def.h"
-
 static void Stage_TimerGetLength(void)
 {
-	const XA_TrackDef *track_def = &xa_tracks[stage.stage_def->music_track]; //get length of the music
-	stage.timerlength = (track_def->length / 75 / IO_SECT_SIZE) - 1; //convert in seconds
-
-	(void)xa_paths; //just for remove boring warning
+	stage.timerlength = Audio_GetLength(stage.stage_def->music_track) - 1; //get length of the music in seconds
 
 	//minutes stuff
 	stage.timermin = stage.timerlength / 60;
@@ -894,50 +926,50 @@ static void Stage_DrawStrum(u8 i, RECT *note_src, RECT_FIXED *note_dst)
 	}
 }
 
+static boolean Stage_SustainClipped(PlayerState *this, Note *note, u8 bot)
+{
+	//Sustains are clipped at the arrows once hit or while held
+	fixed_t note_fp = (fixed_t)note->pos << FIXED_SHIFT;
+	return ((note->type ^ stage.note_swap) & (bot | NOTE_FLAG_HIT)) || ((this->pad_held & note_key[note->type & 0x3]) && (note_fp + stage.late_sus_safe >= stage.note_scroll));
+}
+
 static void Stage_DrawNotes(void)
 {
 	//Check if opponent should draw as bot
 	u8 bot = (stage.mode >= StageMode_2P) ? 0 : NOTE_FLAG_OPPONENT;
 	
 	//Initialize scroll state
-	SectionScroll scroll;
-	scroll.start = stage.time_base;
+	fixed_t scroll_y = FIXED_MUL(stage.speed, stage.song_time * 150);
+	
+	//Initialize sustain merging state
+	s32 run_end[8]; //Last sub-step drawn by a merged sustain
+	u16 lane_j[8];
+	for (u8 i = 0; i < 8; i++)
+	{
+		run_end[i] = -1;
+		lane_j[i] = Stage_GetLane(i)->cur;
+	}
 	
 	Section *scroll_section = stage.section_base;
-	Stage_GetSectionScroll(&scroll, scroll_section);
 	
 	//Push scroll back until cur_note is properly contained
-	while (scroll.start_step > stage.cur_note->pos)
-	{
-		//Look for previous section
-		Section *prev_section = Stage_GetPrevSection(scroll_section);
-		if (prev_section == NULL)
-			break;
-		
-		//Push scroll back
-		scroll_section = prev_section;
-		Stage_GetSectionScroll(&scroll, scroll_section);
-		scroll.start -= scroll.length;
-	}
+	if (Stage_GetSectionStart(scroll_section) > stage.cur_note->pos)
+		scroll_section = Stage_FindSectionStep(stage.cur_note->pos, scroll_section);
 	
 	//Draw notes
 	for (Note *note = stage.cur_note; note->pos != 0xFFFF; note++)
 	{
 		//Update scroll
 		while (note->pos >= scroll_section->end)
-		{
-			//Push scroll forward
-			scroll.start += scroll.length;
-			Stage_GetSectionScroll(&scroll, ++scroll_section);
-		}
+			scroll_section++;
+		const SectionDraw *scroll = &stage.section_draw[scroll_section - stage.sections];
 		
 		//Get note information
 		u8 i = ((note->type ^ stage.note_swap) & NOTE_FLAG_OPPONENT) != 0;
 		PlayerState *this = &stage.player_state[i];
 		
 		fixed_t note_fp = (fixed_t)note->pos << FIXED_SHIFT;
-		fixed_t time = (scroll.start - stage.song_time) + (scroll.length * (note->pos - scroll.start_step) / scroll.length_step);
-		fixed_t y = stage.note_y[note->type & 0x7] + FIXED_MUL(stage.speed, time * 150);
+		fixed_t y = stage.note_y[note->type & 0x7] + stage.note_ybase[note - stage.notes] - scroll_y;
 		
 		//Check if went above screen
 		if (y < FIXED_DEC(-16 - SCREEN_HEIGHT2, 1))
@@ -967,16 +999,22 @@ static void Stage_DrawNotes(void)
 			//Don't draw if below screen
 			RECT note_src;
 			RECT_FIXED note_dst;
-			if (y > (FIXED_DEC(SCREEN_HEIGHT,2) + scroll.size) || note->pos == 0xFFFF)
+			if (y > (FIXED_DEC(SCREEN_HEIGHT,2) + scroll->size) || note->pos == 0xFFFF)
 				break;
 			
 			//Draw note
 			if (note->type & NOTE_FLAG_SUSTAIN)
 			{
+				//Skip sustain pieces already drawn as part of a merged sustain
+				u8 l = note->type & 0x7;
+				if ((s32)note->pos <= run_end[l])
+					continue;
+				
 				//Check for sustain clipping
 				fixed_t clip;
-				y -= scroll.size;
-				if (((note->type ^ stage.note_swap) & (bot | NOTE_FLAG_HIT)) || ((this->pad_held & note_key[note->type & 0x3]) && (note_fp + stage.late_sus_safe >= stage.note_scroll)))
+				boolean clipped = Stage_SustainClipped(this, note, bot);
+				y -= scroll->size;
+				if (clipped)
 				{
 					clip = FIXED_DEC(32 - SCREEN_HEIGHT2, 1) - y;
 					if (clip < 0)
@@ -1012,9 +1050,36 @@ static void Stage_DrawNotes(void)
 				}
 				else
 				{
-					//Get note height
-					fixed_t next_time = (scroll.start - stage.song_time) + (scroll.length * (note->pos + 12 - scroll.start_step) / scroll.length_step);
-					fixed_t next_y = stage.note_y[note->type & 0x7] + FIXED_MUL(stage.speed, next_time * 150) - scroll.size;
+					//Merge following pieces of the same sustain into this one until the clipping changes or they go below screen
+					NoteLane *lane = &stage.note_lane[l];
+					u16 note_i = note - stage.notes;
+					while (lane->note[lane_j[l]] != note_i)
+						lane_j[l]++;
+					
+					fixed_t next_y = y + scroll->step_y;
+					Section *run_section = scroll_section;
+					run_end[l] = note->pos;
+					
+					for (u16 j = lane_j[l] + 1; j < lane->len; j++)
+					{
+						Note *run_note = &stage.notes[lane->note[j]];
+						if (run_note->pos != run_end[l] + 12 || (run_note->type & (NOTE_FLAG_SUSTAIN | NOTE_FLAG_SUSTAIN_END)) != NOTE_FLAG_SUSTAIN)
+							break;
+						if (Stage_SustainClipped(this, run_note, bot) != clipped)
+							break;
+						
+						while (run_note->pos >= run_section->end)
+							run_section++;
+						const SectionDraw *run_scroll = &stage.section_draw[run_section - stage.sections];
+						fixed_t run_y = stage.note_y[l] + stage.note_ybase[lane->note[j]] - scroll_y - run_scroll->size;
+						if (run_y > FIXED_DEC(SCREEN_HEIGHT,2))
+							break;
+						
+						next_y = run_y + run_scroll->step_y;
+						run_end[l] = run_note->pos;
+					}
+					
+					//Get merged height
 					fixed_t next_size = next_y - y;
 					
 					if (clip < next_size)
@@ -1271,6 +1336,90 @@ static void Stage_LoadStage(void)
 	stage.back = stage.stage_def->back();
 }
 
+static u32 Stage_ReadVarint(const u8 **data)
+{
+	u32 value = 0;
+	u8 shift = 0, byte;
+	do
+	{
+		byte = *(*data)++;
+		value |= (u32)(byte & 0x7F) << shift;
+		shift += 7;
+	} while (byte & 0x80);
+	return value;
+}
+
+//Expands v3 packed notes, in the same order as funkinchartpak
+//Each note is a position delta and type, followed by a sustain length if it ends in a sustain
+//Sustain notes go after every note at their position, ties between sustains in the order they started
+static void Stage_UnpackNotes(const u8 *data, Note *note)
+{
+	struct
+	{
+		u16 pos, type, left;
+	} sustain[CHART_MAX_SUSTAINS];
+	u8 sustains = 0;
+	
+	u32 packed = Stage_ReadVarint(&data);
+	u16 pos = 0;
+	for (u32 i = 0; i <= packed; i++)
+	{
+		//Get next note position, everything's left at the end
+		u32 next_pos = 0x10000;
+		if (i != packed)
+			next_pos = pos += Stage_ReadVarint(&data);
+		
+		//Write sustain notes before it
+		while (1)
+		{
+			u8 next = sustains;
+			for (u8 j = 0; j < sustains; j++)
+				if (sustain[j].pos < next_pos && (next == sustains || sustain[j].pos < sustain[next].pos))
+					next = j;
+			if (next == sustains)
+				break;
+			
+			note->pos = sustain[next].pos;
+			note->type = sustain[next].type;
+			if (--sustain[next].left != 0)
+			{
+				note->type &= ~NOTE_FLAG_SUSTAIN_END;
+				sustain[next].pos += 12;
+			}
+			else
+			{
+				for (u8 j = next + 1; j < sustains; j++)
+					sustain[j - 1] = sustain[j];
+				sustains--;
+			}
+			note++;
+		}
+		if (i == packed)
+			break;
+		
+		//Write note
+		note->pos = pos;
+		note->type = *data++;
+		if (note->type & NOTE_FLAG_SUSTAIN_END)
+		{
+			if (sustains >= CHART_MAX_SUSTAINS)
+			{
+				sprintf(error_msg, "[Stage_UnpackNotes] More than %d sustains at once", CHART_MAX_SUSTAINS);
+				ErrorLock();
+			}
+			sustain[sustains].pos = pos + 12;
+			sustain[sustains].type = note->type | NOTE_FLAG_SUSTAIN;
+			sustain[sustains].left = Stage_ReadVarint(&data);
+			sustains++;
+		}
+		note++;
+	}
+	
+	//End note
+	note->pos = 0xFFFF;
+	note->type = NOTE_FLAG_HIT;
+}
+
 static void Stage_LoadChart(void)
 {
 	//Load stage data
@@ -1283,13 +1432,152 @@ static void Stage_LoadChart(void)
 		Mem_Free(stage.chart_data);
 	stage.chart_data = IO_Read(chart_path);
 	u8 *chart_byte = (u8*)stage.chart_data;
-
+	const ChartHeader *header = (const ChartHeader*)stage.chart_data;
+	
 	//Directly use section and notes pointers
-	stage.sections = (Section*)(chart_byte + 6);
-	stage.notes = (Note*)(chart_byte + ((u16*)stage.chart_data)[2]);
+	size_t num_sections;
+	boolean has_starts;
+	const u8 *packed_notes = NULL;
+	if (header->magic == CHART_MAGIC)
+	{
+		//v2 and up, with section starts and BPM timeline
+		if (header->version != 2 && header->version != CHART_VERSION)
+		{
+			sprintf(error_msg, "[Stage_LoadChart] %s is chart version %d, expected %d", chart_path, header->version, CHART_VERSION);
+			ErrorLock();
+		}
+		stage.speed = header->speed;
+		stage.sections = (Section*)(chart_byte + header->section_off);
+		stage.section_start = (SectionStart*)(chart_byte + header->start_off);
+		stage.bpm_changes = (BPMChange*)(chart_byte + header->bpm_off);
+		stage.num_bpm_changes = header->num_bpm_changes;
+		if (header->version >= 3)
+			packed_notes = chart_byte + header->note_off;
+		else
+			stage.notes = (Note*)(chart_byte + header->note_off);
+		num_sections = header->num_sections;
+		has_starts = true;
+	}
+	else
+	{
+		//v1, speed then note offset, section starts are built below
+		stage.speed = *((fixed_t*)stage.chart_data);
+		stage.sections = (Section*)(chart_byte + 6);
+		stage.notes = (Note*)(chart_byte + ((u16*)stage.chart_data)[2]);
+		num_sections = (((u16*)stage.chart_data)[2] - 6) / sizeof(Section);
+		has_starts = false;
+	}
+	stage.num_sections = num_sections;
+	
+	if (packed_notes != NULL)
+	{
+		stage.num_notes = header->num_notes;
+	}
+	else
+	{
+		stage.num_notes = 0;
+		for (Note *note = stage.notes; note->pos != 0xFFFF; note++)
+			stage.num_notes++;
+	}
+	
+	//Precompute note and section positions so drawing doesn't have to divide
+	//Tables v1 charts don't have and unpacked v3 notes go at the end
+	if (stage.note_ybase != NULL)
+		Mem_Free(stage.note_ybase);
+	size_t alloc_size = stage.num_notes * (sizeof(fixed_t) + sizeof(u16)) + num_sections * sizeof(SectionDraw);
+	if (!has_starts)
+		alloc_size += num_sections * (sizeof(SectionStart) + sizeof(BPMChange));
+	if (packed_notes != NULL)
+		alloc_size += (stage.num_notes + 1) * sizeof(Note);
+	stage.note_ybase = Mem_Alloc(alloc_size);
+	if (stage.note_ybase == NULL)
+	{
+		sprintf(error_msg, "[Stage_LoadChart] Failed to allocate note positions");
+		ErrorLock();
+	}
+	stage.section_draw = (SectionDraw*)(stage.note_ybase + stage.num_notes);
+	u16 *lane_note = (u16*)(stage.section_draw + num_sections);
+	
+	if (!has_starts)
+	{
+		//Accumulate start times the same way v1 playback did at each section change
+		stage.section_start = (SectionStart*)(stage.section_draw + num_sections);
+		stage.bpm_changes = (BPMChange*)(stage.section_start + num_sections);
+		stage.num_bpm_changes = 0;
+		lane_note = (u16*)(stage.bpm_changes + num_sections);
 		
+		fixed_t time = 0, crochet = 0;
+		u16 step = 0;
+		for (size_t i = 0; i < num_sections; i++)
+		{
+			u16 start_step = (i != 0) ? stage.sections[i - 1].end : 0;
+			if (crochet)
+				time += FIXED_DIV(((fixed_t)start_step - step) << FIXED_SHIFT, crochet);
+			step = start_step;
+			
+			u16 bpm = stage.sections[i].flag & SECTION_FLAG_BPM_MASK;
+			if (stage.num_bpm_changes == 0 || stage.bpm_changes[stage.num_bpm_changes - 1].bpm != bpm)
+			{
+				BPMChange *change = &stage.bpm_changes[stage.num_bpm_changes++];
+				change->time = time;
+				change->step = step;
+				change->bpm = bpm;
+			}
+			stage.section_start[i].time = time;
+			stage.section_start[i].step = step;
+			stage.section_start[i].bpm_change = stage.num_bpm_changes - 1;
+			crochet = Stage_GetStepCrochet(bpm);
+		}
+	}
+	
+	//Unpack notes after the lanes
+	if (packed_notes != NULL)
+	{
+		stage.notes = (Note*)(lane_note + stage.num_notes);
+		Stage_UnpackNotes(packed_notes, stage.notes);
+	}
+	
+	SectionScroll scroll;
+	for (size_t i = 0; i < num_sections; i++)
+	{
+		Stage_GetSectionScroll(&scroll, &stage.sections[i]);
+		stage.section_draw[i].size = scroll.size;
+		stage.section_draw[i].step_y = (scroll.length_step != 0) ? FIXED_MUL(stage.speed, (scroll.length * 12 / scroll.length_step) * 150) : 0;
+	}
+	
+	Section *scroll_section = stage.sections;
+	scroll.start = 0;
+	Stage_GetSectionScroll(&scroll, scroll_section);
+	
+	fixed_t *ybase = stage.note_ybase;
 	for (Note *note = stage.notes; note->pos != 0xFFFF; note++)
-		stage.num_notes++;
+	{
+		//Update scroll
+		while (note->pos >= scroll_section->end && scroll_section < &stage.sections[num_sections - 1])
+		{
+			//Push scroll forward
+			scroll.start += scroll.length;
+			Stage_GetSectionScroll(&scroll, ++scroll_section);
+		}
+		
+		//Get note time and position
+		fixed_t time = scroll.start;
+		if (scroll.length_step != 0)
+			time += scroll.length * (note->pos - scroll.start_step) / scroll.length_step;
+		*ybase++ = FIXED_MUL(stage.speed, time * 150);
+	}
+	
+	//Split notes into lanes
+	for (u8 i = 0; i < 8; i++)
+	{
+		NoteLane *lane = &stage.note_lane[i];
+		lane->note = lane_note;
+		lane->len = lane->cur = 0;
+		for (Note *note = stage.notes; note->pos != 0xFFFF; note++)
+			if ((note->type & (NOTE_FLAG_OPPONENT | 0x3)) == i)
+				lane->note[lane->len++] = note - stage.notes;
+		lane_note += lane->len;
+	}
 	
 	//Count max scores
 	stage.player_state[0].max_score = 0;
@@ -1308,16 +1596,75 @@ static void Stage_LoadChart(void)
 	else
 		stage.max_score = stage.player_state[0].max_score;
 	
-	stage.cur_section = stage.sections;
 	stage.cur_note = stage.notes;
+	Stage_SetSection(stage.sections);
+}
+
+u16 Stage_FindSection(fixed_t time)
+{
+	//Find the last section starting at or before the given time
+	u16 lo = 0, hi = stage.num_sections - 1;
+	while (lo < hi)
+	{
+		u16 mid = (lo + hi + 1) >> 1;
+		if (stage.section_start[mid].time <= time)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	return lo;
+}
+
+void Stage_JumpSection(u16 section)
+{
+	const SectionStart *start = &stage.section_start[section];
+	u16 old_step = stage.note_scroll >> FIXED_SHIFT;
+	Note *old_note = stage.cur_note;
 	
-	stage.speed = *((fixed_t*)stage.chart_data);
+	//Find the first note of the section
+	u16 lo = 0, hi = stage.num_notes;
+	while (lo < hi)
+	{
+		u16 mid = (lo + hi) >> 1;
+		if (stage.notes[mid].pos < start->step)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	stage.cur_note = &stage.notes[lo];
+	
+	//Notes being played again haven't been hit yet, early hits can't be more than a few steps ahead
+	if (stage.cur_note < old_note)
+		for (Note *note = stage.cur_note; note->pos != 0xFFFF && (note < old_note || note->pos <= old_step + 12 * 4); note++)
+			note->type &= ~NOTE_FLAG_HIT;
+	
+	//Move lane cursors back or forward to it
+	for (u8 i = 0; i < 8; i++)
+	{
+		NoteLane *lane = &stage.note_lane[i];
+		u16 llo = 0, lhi = lane->len;
+		while (llo < lhi)
+		{
+			u16 mid = (llo + lhi) >> 1;
+			if (lane->note[mid] < lo)
+				llo = mid + 1;
+			else
+				lhi = mid;
+		}
+		lane->cur = llo;
+	}
+	
+	//Start the music if it's still counting down, then seek it to where the section starts
+	if (stage.note_scroll < 0)
+		Audio_PlayXA_Track(stage.stage_def->music_track, 0x40, stage.stage_def->music_channel, 0);
+	Audio_SeekXA_Milli(((start->time * 1000) >> FIXED_SHIFT) + stage.offset);
 	
-	stage.step_crochet = 0;
-	stage.time_base = 0;
-	stage.step_base = 0;
-	stage.section_base = stage.cur_section;
-	Stage_ChangeBPM(stage.cur_section->flag & SECTION_FLAG_BPM_MASK, 0);
+	//Jump timing and scroll to the section start, the music's position is resynced from there
+	Stage_SetSection(&stage.sections[section]);
+	stage.song_time = stage.interp_ms = start->time;
+	stage.interp_time = 0;
+	stage.note_scroll = (fixed_t)start->step << FIXED_SHIFT;
+	stage.song_step = start->step / 12;
 }
 
 static void Stage_LoadMusic(void)
@@ -1396,7 +1743,8 @@ static void Stage_LoadState(void)
 		stage.player_state[i].pad_held = stage.player_state[i].pad_press = 0;
 	}
 	
-	ObjectList_Free(&stage.objlist_splash);
+	ObjectPool_Clear(&stage.objpool_splash);
+	ObjectPool_Clear(&stage.objpool_combo);
 	ObjectList_Free(&stage.objlist_fg);
 	ObjectList_Free(&stage.objlist_bg);
 }
@@ -1409,7 +1757,13 @@ void Stage_Load(StageId id, StageDiff difficulty, boolean story)
 	stage.stage_diff = difficulty;
 	stage.story = story;
 	
-	//Load HUD textures
+	//Allocate everything the stage loads from the arena, this packs it at the end of the heap away from gameplay allocations
+	Mem_ArenaBegin();
+	
+	//Forget previous VRAM usage, this lets character texture caches know which spare TPages this stage leaves free
+	Gfx_ClearTPageUse();
+	
+	//Load HUD textures, these are uploaded and freed right away so they don't leave holes under the stage's allocations
 	if (id >= StageId_6_1 && id <= StageId_6_3)
 		Gfx_LoadTex(&stage.tex_hud0, IO_Read("\\STAGE\\HUD0WEEB.TIM;1"), GFX_LOADTEX_FREE);
 	else
@@ -1425,6 +1779,10 @@ void Stage_Load(StageId id, StageDiff difficulty, boolean story)
 	Stage_LoadOpponent();
 	Stage_LoadGirlfriend();
 	
+	//Allocate object pools
+	ObjectPool_Init(&stage.objpool_splash, sizeof(Obj_Splash), STAGE_SPLASH_MAX);
+	ObjectPool_Init(&stage.objpool_combo, sizeof(Obj_Combo), STAGE_COMBO_MAX);
+	
 	//Load stage chart
 	Stage_LoadChart();
 
@@ -1461,10 +1819,18 @@ void Stage_Load(StageId id, StageDiff difficulty, boolean story)
 	
 	//Test offset
 	stage.offset = 0;
+	
+	//Stop allocating from the arena, gameplay goes through the heap
+	Mem_ArenaEnd();
 }
 
 void Stage_Unload(void)
 {
+	//Drop everything the stage loaded into the arena at once, once queued uploads from it are done
+	//Freeing those blocks below is ignored, only what fell back to the heap is freed
+	Gfx_FlushTex();
+	Mem_ArenaReset();
+	
 	//Unload stage background
 	if (stage.back != NULL)
 		stage.back->free(stage.back);
@@ -1473,9 +1839,12 @@ void Stage_Unload(void)
 	//Unload stage data
 	Mem_Free(stage.chart_data);
 	stage.chart_data = NULL;
+	Mem_Free(stage.note_ybase);
+	stage.note_ybase = NULL;
 	
 	//Free objects
-	ObjectList_Free(&stage.objlist_splash);
+	ObjectPool_Free(&stage.objpool_splash);
+	ObjectPool_Free(&stage.objpool_combo);
 	ObjectList_Free(&stage.objlist_fg);
 	ObjectList_Free(&stage.objlist_bg);
 	
@@ -1503,6 +1872,9 @@ static boolean Stage_NextLoad(void)
 		//Get stage definition
 		stage.stage_def = &stage_defs[stage.stage_id = stage.stage_def->next_stage];
 		
+		//Load into the arena too, reusing the gaps left by what this replaces
+		Mem_ArenaBegin();
+		
 		//Load stage background
 		if (load & STAGE_LOAD_STAGE)
 			Stage_LoadStage();
@@ -1547,6 +1919,7 @@ static boolean Stage_NextLoad(void)
 		
 		//Load music
 		Stage_LoadMusic();
+		Mem_ArenaEnd();
 		
 		//Reset timer
 		Timer_Reset();
@@ -1745,13 +2118,8 @@ void Stage_Tick(void)
 				u16 end = stage.cur_section->end;
 				if ((stage.note_scroll >> FIXED_SHIFT) >= end)
 				{
-					//Increment section pointer
-					stage.cur_section++;
-					
-					//Update BPM
-					u16 next_bpm = stage.cur_section->flag & SECTION_FLAG_BPM_MASK;
-					Stage_ChangeBPM(next_bpm, end);
-					stage.section_base = stage.cur_section;
+					//Move to the next section, taking its start time and BPM from the section start table
+					Stage_SetSection(stage.cur_section + 1);
 					
 					//Recalculate scroll based off new BPM
 					next_scroll = ((fixed_t)stage.step_base << FIXED_SHIFT) + FIXED_MUL(stage.song_time - stage.time_base, stage.step_crochet);
@@ -1856,7 +2224,7 @@ void Stage_Tick(void)
 			Stage_TimerTick();
 
 			//Tick note splashes
-			ObjectList_Tick(&stage.objlist_splash);
+			ObjectPool_Tick(&stage.objpool_splash);
 
 			//Draw skill issue mode (botplay)
 			RECT skill_issue_src = {129, 208, 67, 16};
@@ -1949,7 +2317,9 @@ void Stage_Tick(void)
 				else
 					fc = 2;
 
-				this->accuracy = (this->min_accuracy * 100) / (this->max_accuracy);
+				//Nothing to rate before the first note (the PS1 doesn't trap on division by zero, the host build does)
+				if (this->max_accuracy != 0)
+					this->accuracy = (this->min_accuracy * 100) / (this->max_accuracy);
 
 				if (this->refresh_info)
 				{
@@ -2023,6 +2393,7 @@ void Stage_Tick(void)
 				stage.back->draw_fg(stage.back);
 			
 			//Tick foreground objects
+			ObjectPool_Tick(&stage.objpool_combo);
 			ObjectList_Tick(&stage.objlist_fg);
 			
 			//Tick characters
@@ -2053,12 +2424,15 @@ void Stage_Tick(void)
 			//Unload stage data
 			Mem_Free(stage.chart_data);
 			stage.chart_data = NULL;
+			Mem_Free(stage.note_ybase);
+			stage.note_ybase = NULL;
 			
 			//Free background
 			stage.back->free(stage.back);
 			stage.back = NULL;
 			
 			//Free objects
+			ObjectPool_Clear(&stage.objpool_combo);
 			ObjectList_Free(&stage.objlist_fg);
 			ObjectList_Free(&stage.objlist_bg);
 			
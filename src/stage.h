@@ -35,6 +35,9 @@
 #define STAGE_LOAD_STAGE      (1 << 3) //Reload stage
 #define STAGE_LOAD_FLAG       (1 << 7)
 
+#define STAGE_SPLASH_MAX 24 //Note splashes alive at once, oldest is dropped when full
+#define STAGE_COMBO_MAX  8  //Combo popups alive at once, oldest is dropped when full
+
 //Stage enums
 typedef enum
 {
@@ -134,6 +137,36 @@ typedef struct
 	u16 flag;
 } Section;
 
+typedef struct
+{
+	fixed_t time;   //Seconds
+	u16 step;       //1/12 steps
+	u16 bpm_change; //Index into the BPM timeline
+} SectionStart;
+
+typedef struct
+{
+	fixed_t time;
+	u16 step;
+	u16 bpm; //1/24
+} BPMChange;
+
+//v2 chart header, v1 charts start with their speed instead of the magic
+#define CHART_MAGIC   0x54484346 //"FCHT"
+#define CHART_VERSION 3 //v2 stores notes as is, v3 packs them
+#define CHART_MAX_SUSTAINS 32 //Sustains a v3 chart can have going at once
+
+typedef struct
+{
+	u32 magic;
+	u16 version;
+	u16 num_sections; //Including the end section
+	fixed_t speed;
+	u32 section_off, start_off, bpm_off, note_off;
+	u16 num_bpm_changes;
+	u16 num_notes; //v3 only, excluding the end note
+} ChartHeader;
+
 #define NOTE_FLAG_OPPONENT    (1 << 2) //Note is opponent's
 #define NOTE_FLAG_SUSTAIN     (1 << 3) //Note is a sustain note
 #define NOTE_FLAG_SUSTAIN_END (1 << 4) //Is either end of sustain
@@ -147,6 +180,18 @@ typedef struct
 	u16 type;
 } Note;
 
+typedef struct
+{
+	fixed_t size;   //Note height
+	fixed_t step_y; //Height of a step (12 sub-steps), used by sustains
+} SectionDraw;
+
+typedef struct
+{
+	u16 *note;    //Indices of the lane's notes, in chart order
+	u16 len, cur; //cur is the first note at or after cur_note
+} NoteLane;
+
 typedef struct
 {
 	Character *character;
@@ -208,6 +253,14 @@ typedef struct
 	Note *notes;
 	size_t num_notes;
 	
+	SectionStart *section_start; //Start of each section, for seeking without replaying the song
+	BPMChange *bpm_changes;
+	u16 num_sections, num_bpm_changes;
+	
+	fixed_t *note_ybase; //Y of each note at song time 0, built by Stage_LoadChart
+	SectionDraw *section_draw;
+	NoteLane note_lane[8]; //Notes split by (type & (NOTE_FLAG_OPPONENT | 0x3)), for hit detection
+	
 	fixed_t speed;
 	fixed_t step_crochet, step_time;
 	fixed_t early_safe, late_safe, early_sus_safe, late_sus_safe;
@@ -266,7 +319,10 @@ typedef struct
 	u8 note_swap;
 	
 	//Object lists
-	ObjectList objlist_splash, objlist_fg, objlist_bg;
+	ObjectList objlist_fg, objlist_bg;
+	
+	//Object pools
+	ObjectPool objpool_splash, objpool_combo;
 } Stage;
 
 extern Stage stage;
@@ -282,5 +338,7 @@ void Stage_BlendTexArb(Gfx_Tex *tex, const RECT *src, const POINT_FIXED *p0, con
 void Stage_Load(StageId id, StageDiff difficulty, boolean story);
 void Stage_Unload();
 void Stage_Tick();
+u16 Stage_FindSection(fixed_t time);
+void Stage_JumpSection(u16 section);
 
 #endif
@@ -34,6 +34,7 @@ typedef struct
 	
 	//Henchmen state
 	Gfx_Tex tex_hench;
+	u16 hench_clut; //Palette bank both sheets share
 	u8 hench_frame, hench_tex_id;
 	
 	Animatable hench_animatable;
@@ -70,7 +71,10 @@ void Week4_Henchmen_SetFrame(void *user, u8 frame)
 		//Check if new art shall be loaded
 		const CharFrame *cframe = &henchmen_frame[this->hench_frame = frame];
 		if (cframe->tex != this->hench_tex_id)
-			Gfx_LoadTex(&this->tex_hench, this->arc_hench_ptr[this->hench_tex_id = cframe->tex], 0);
+		{
+			Gfx_LoadTex(&this->tex_hench, this->arc_hench_ptr[this->hench_tex_id = cframe->tex], GFX_LOADTEX_ASYNC);
+			this->tex_hench.clut = this->hench_clut;
+		}
 	}
 }
 
@@ -215,7 +219,8 @@ void Back_Week4_Free(StageBack *back)
 {
 	Back_Week4 *this = (Back_Week4*)back;
 	
-	//Free henchmen archive
+	//Free henchmen archive once queued uploads from it are done
+	Gfx_FlushTex();
 	Mem_Free(this->arc_hench);
 	
 	//Free structure
@@ -237,17 +242,23 @@ StageBack *Back_Week4_New(void)
 	
 	//Load background textures
 	IO_Data arc_back = IO_Read("\\WEEK4\\BACK.ARC;1");
-	Gfx_LoadTex(&this->tex_back0, Archive_Find(arc_back, "back0.tim"), 0);
-	Gfx_LoadTex(&this->tex_back1, Archive_Find(arc_back, "back1.tim"), 0);
-	Gfx_LoadTex(&this->tex_back2, Archive_Find(arc_back, "back2.tim"), 0);
-	Gfx_LoadTex(&this->tex_back3, Archive_Find(arc_back, "back3.tim"), 0);
-	Gfx_LoadTex(&this->tex_back4, Archive_Find(arc_back, "back4.tim"), 0);
+	Gfx_LoadTex(&this->tex_back0, Archive_FindHash(arc_back, ARCHIVE_HASH("back0.tim")), GFX_LOADTEX_ASYNC);
+	Gfx_LoadTex(&this->tex_back1, Archive_FindHash(arc_back, ARCHIVE_HASH("back1.tim")), GFX_LOADTEX_ASYNC);
+	Gfx_LoadTex(&this->tex_back2, Archive_FindHash(arc_back, ARCHIVE_HASH("back2.tim")), GFX_LOADTEX_ASYNC);
+	Gfx_LoadTex(&this->tex_back3, Archive_FindHash(arc_back, ARCHIVE_HASH("back3.tim")), GFX_LOADTEX_ASYNC);
+	Gfx_LoadTex(&this->tex_back4, Archive_FindHash(arc_back, ARCHIVE_HASH("back4.tim")), GFX_LOADTEX_ASYNC);
+	Gfx_FlushTex();
 	Mem_Free(arc_back);
 	
 	//Load henchmen textures
 	this->arc_hench = IO_Read("\\WEEK4\\HENCH.ARC;1");
-	this->arc_hench_ptr[0] = Archive_Find(this->arc_hench, "hench0.tim");
-	this->arc_hench_ptr[1] = Archive_Find(this->arc_hench, "hench1.tim");
+	this->arc_hench_ptr[0] = Archive_FindHash(this->arc_hench, ARCHIVE_HASH("hench0.tim"));
+	this->arc_hench_ptr[1] = Archive_FindHash(this->arc_hench, ARCHIVE_HASH("hench1.tim"));
+	
+	//Upload the henchmen's palette bank once instead of a CLUT with every sheet
+	Gfx_Tex hench_pal;
+	Gfx_LoadTex(&hench_pal, Archive_FindHash(this->arc_hench, ARCHIVE_HASH("pal.tim")), GFX_LOADTEX_NOTEX | GFX_LOADTEX_ASYNC);
+	this->hench_clut = hench_pal.clut;
 	
 	//Initialize car state
 	this->car_x = CAR_END_X;
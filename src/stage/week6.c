@@ -303,9 +303,10 @@ StageBack *Back_Week6_New(void)
 		
 		//Load background textures
 		IO_Data arc_back = IO_Read("\\WEEK6\\BACK.ARC;1");
-		Gfx_LoadTex(&this->tex_back0, Archive_Find(arc_back, "back0.tim"), 0);
-		Gfx_LoadTex(&this->tex_back1, Archive_Find(arc_back, "back1.tim"), 0);
-		Gfx_LoadTex(&this->tex_back2, Archive_Find(arc_back, "back2.tim"), 0);
+		Gfx_LoadTex(&this->tex_back0, Archive_FindHash(arc_back, ARCHIVE_HASH("back0.tim")), GFX_LOADTEX_ASYNC);
+		Gfx_LoadTex(&this->tex_back1, Archive_FindHash(arc_back, ARCHIVE_HASH("back1.tim")), GFX_LOADTEX_ASYNC);
+		Gfx_LoadTex(&this->tex_back2, Archive_FindHash(arc_back, ARCHIVE_HASH("back2.tim")), GFX_LOADTEX_ASYNC);
+		Gfx_FlushTex();
 		Mem_Free(arc_back);
 		
 		//Initialize freaks state
@@ -321,7 +322,7 @@ StageBack *Back_Week6_New(void)
 		this->back.free = Back_Week6_Free;
 		
 		//Load background texture
-		Gfx_LoadTex(&this->tex_back0, IO_Read("\\WEEK6\\BACK3.TIM;1"), GFX_LOADTEX_FREE);
+		Gfx_LoadTex(&this->tex_back0, IO_Read("\\WEEK6\\BACK3.TIM;1"), GFX_LOADTEX_FREE | GFX_LOADTEX_ASYNC);
 	}
 	
 	return (StageBack*)this;
@@ -0,0 +1,423 @@
+/*
+	Game allocation trace recorder
+	Runs the game's menu, stage, character, background and object code headless with botplay and writes every
+	Mem_Alloc, Mem_Free and arena call it makes to stdout, for test/membench and test/memfrag to replay.
+	It plays all 6 weeks in story mode on hard, then a few songs in freeplay, dying in some songs and
+	going back through the menu to play them again, like a player would.
+	Files are read from iso/ through funkin.xml, so the game's assets have to be built first.
+	Struct sizes are the host's, a bit larger than on the PS1 where pointers are 4 bytes, file sizes are the same.
+
+	Trace lines:
+	a <id> <size> - allocation
+	f <id>        - free
+	b, e, r       - Mem_ArenaBegin, Mem_ArenaEnd, Mem_ArenaReset
+	p             - sample point while playing (every 5 seconds)
+	m             - sample point at the menu
+*/
+
+#include "../src/main.h"
+#include "../src/mem.h"
+#include "../src/stage.h"
+#include "../src/menu.h"
+#include "../src/loadscr.h"
+#include "../src/audio.h"
+#include "../src/io.h"
+#include "../src/gfx.h"
+#include "../src/pad.h"
+#include "../src/timer.h"
+#include "../src/save.h"
+#include "../src/movie.h"
+
+#include <stdarg.h>
+#include <ctype.h>
+
+//Trace
+static FILE *trace;
+static u32 trace_id, trace_live;
+
+typedef struct
+{
+	u32 id;
+	u32 pad[3]; //Keeps the data 16 byte aligned like mem.h does
+} Trace_Header;
+
+int Mem_Init(void *ptr, size_t size)
+{
+	(void)ptr;
+	(void)size;
+	return 0;
+}
+
+void *Mem_Alloc(size_t size)
+{
+	//Zeroed so the run doesn't depend on what malloc hands back
+	Trace_Header *head = calloc(1, sizeof(Trace_Header) + size);
+	if (head == NULL)
+	{
+		fputs("Out of memory\n", stderr);
+		exit(1);
+	}
+	head->id = ++trace_id;
+	trace_live++;
+	fprintf(trace, "a %u %lu\n", head->id, (unsigned long)size);
+	return head + 1;
+}
+
+void Mem_Free(void *ptr)
+{
+	if (ptr == NULL)
+		return;
+	Trace_Header *head = (Trace_Header*)ptr - 1;
+	fprintf(trace, "f %u\n", head->id);
+	trace_live--;
+	free(head);
+}
+
+void Mem_ArenaBegin(void)
+{
+	fputs("b\n", trace);
+}
+
+void Mem_ArenaEnd(void)
+{
+	fputs("e\n", trace);
+}
+
+void Mem_ArenaReset(void)
+{
+	fputs("r\n", trace);
+}
+
+//Main
+int my_argc;
+char **my_argv;
+
+GameLoop gameloop;
+char error_msg[0x200];
+
+void ErrorLock(void)
+{
+	fprintf(stderr, "%s\n", error_msg);
+	exit(1);
+}
+
+void FntPrint(const char *format, ...)
+{
+	(void)format;
+}
+
+void MsgPrint(const char *format, ...)
+{
+	(void)format;
+}
+
+boolean ReadSave(void) { return false; }
+void WriteSave(void) {}
+void Movie_Play(const char *path, u32 length) { (void)path; (void)length; }
+
+//Timer and pad, a steady 60 frames per second
+u32 frame_count, animf_count;
+fixed_t timer_sec, timer_dt;
+Pad pad_state, pad_state_2;
+
+void Timer_Tick(void)
+{
+	frame_count++;
+	timer_dt = FIXED_DIV(FIXED_UNIT, FIXED_DEC(60,1));
+	timer_sec = FIXED_DIV((fixed_t)frame_count << FIXED_SHIFT, FIXED_DEC(60,1));
+	animf_count = (timer_sec * 24) >> FIXED_SHIFT;
+}
+
+void Timer_Reset(void)
+{
+	Timer_Tick();
+	timer_dt = 0;
+}
+
+//IO, ISO paths are looked up in funkin.xml
+typedef struct
+{
+	char iso[80];
+	char source[96];
+} IO_Map;
+
+static IO_Map io_map[0x100];
+static int io_maps;
+
+static void IO_LoadMap(void)
+{
+	FILE *fp = fopen("funkin.xml", "r");
+	if (fp == NULL)
+	{
+		fputs("Failed to open funkin.xml, run from the repo directory\n", stderr);
+		exit(1);
+	}
+
+	char line[0x200], dir[32] = "", name[32], source[96];
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		char *tag = line;
+		while (isspace(*tag))
+			tag++;
+		if (sscanf(tag, "<dir name = \"%31[^\"]\"", name) == 1)
+		{
+			snprintf(dir, sizeof(dir), "%s", name);
+		}
+		else if (strncmp(tag, "</dir>", 6) == 0)
+		{
+			dir[0] = '\0';
+		}
+		else if (sscanf(tag, "<file name = \"%31[^\"]\" type = \"data\" source = \"%95[^\"]\"", name, source) == 2 && io_maps < (int)COUNT_OF(io_map))
+		{
+			IO_Map *map = &io_map[io_maps++];
+			snprintf(map->iso, sizeof(map->iso), "\\%s%s%s;1", dir, dir[0] ? "\\" : "", name);
+			for (char *p = map->iso; *p != '\0'; p++)
+				*p = toupper(*p);
+			snprintf(map->source, sizeof(map->source), "%s", source);
+		}
+	}
+	fclose(fp);
+}
+
+static const char *IO_MapPath(const char *path)
+{
+	for (int i = 0; i < io_maps; i++)
+		if (strcmp(io_map[i].iso, path) == 0)
+			return io_map[i].source;
+	sprintf(error_msg, "[IO_FindFile] %s not found", path);
+	ErrorLock();
+	return NULL;
+}
+
+void IO_FindFile(CdlFILE *file, const char *path)
+{
+	FILE *fp = fopen(IO_MapPath(path), "rb");
+	if (fp == NULL)
+	{
+		sprintf(error_msg, "[IO_FindFile] %s (%s) not built", path, IO_MapPath(path));
+		ErrorLock();
+	}
+	fseek(fp, 0, SEEK_END);
+	file->size = ftell(fp);
+	fclose(fp);
+	snprintf(file->path, sizeof(file->path), "%s", path);
+}
+
+void IO_SeekFile(CdlFILE *file)
+{
+	(void)file;
+}
+
+IO_Data IO_AsyncReadFile(CdlFILE *file)
+{
+	//Buffers are whole sectors, like on the PS1
+	size_t sects = (file->size + IO_SECT_SIZE - 1) / IO_SECT_SIZE;
+	IO_Data buffer = (IO_Data)Mem_Alloc(IO_SECT_SIZE * sects);
+	FILE *fp = fopen(IO_MapPath(file->path), "rb");
+	if (fp == NULL || fread(buffer, 1, file->size, fp) != file->size)
+	{
+		sprintf(error_msg, "[IO_AsyncReadFile] Failed to read %s", file->path);
+		ErrorLock();
+	}
+	fclose(fp);
+	return buffer;
+}
+
+IO_Data IO_ReadFile(CdlFILE *file)
+{
+	return IO_AsyncReadFile(file);
+}
+
+IO_Data IO_Read(const char *path)
+{
+	CdlFILE file;
+	IO_FindFile(&file, path);
+	return IO_AsyncReadFile(&file);
+}
+
+IO_Data IO_AsyncRead(const char *path)
+{
+	return IO_Read(path);
+}
+
+boolean IO_IsSeeking(void)
+{
+	return false;
+}
+
+boolean IO_IsReading(void)
+{
+	return false;
+}
+
+//Audio, the song plays for as long as its chart and the clock moves with Gfx_Flip
+static boolean xa_playing, xa_paused;
+static u32 xa_frames, xa_length;
+
+static u32 Audio_ChartLength(void)
+{
+	const SectionStart *start = &stage.section_start[stage.num_sections - 1];
+	u16 length = stage.sections[stage.num_sections - 1].end - start->step;
+	fixed_t crochet = ((fixed_t)stage.bpm_changes[start->bpm_change].bpm << FIXED_SHIFT) * 8 / 240; //Stage_GetStepCrochet
+	fixed_t time = start->time + FIXED_DIV((fixed_t)length << FIXED_SHIFT, crochet);
+	return ((time * 1000) >> FIXED_SHIFT) + stage.offset;
+}
+
+void Audio_PlayXA_Track(XA_Track track, u8 volume, u8 channel, boolean loop)
+{
+	(void)volume;
+	(void)channel;
+	xa_playing = true;
+	xa_paused = false;
+	xa_frames = 0;
+	xa_length = (!loop && stage.chart_data != NULL && track == stage.stage_def->music_track) ? Audio_ChartLength() : 0xFFFFFFFF;
+}
+
+void Audio_SeekXA_Milli(u32 milli) { xa_frames = milli * 60 / 1000; }
+s32 Audio_TellXA_Milli(void) { return xa_frames * 1000 / 60; }
+boolean Audio_PlayingXA(void) { return xa_playing && (u32)Audio_TellXA_Milli() < xa_length; }
+void Audio_PauseXA(void) { xa_paused = true; }
+void Audio_ResumeXA(void) { xa_paused = false; }
+void Audio_StopXA(void) { xa_playing = false; }
+void Audio_SeekXA_Track(XA_Track track) { (void)track; }
+void Audio_WaitPlayXA(void) {}
+void Audio_ChannelXA(u8 channel) { (void)channel; }
+void Audio_ClearAlloc(void) {}
+u32 Audio_GetLength(XA_Track lengthtrack) { (void)lengthtrack; return 120; }
+u32 Audio_LoadVAGData(u32 *sound, u32 sound_size) { (void)sound; (void)sound_size; return 0; }
+void Audio_PlaySound(u32 addr, u8 volume) { (void)addr; (void)volume; }
+
+//Graphics, draws nothing but frees what it's told to
+static Gfx_TexFence Gfx_Upload(Gfx_Tex *tex, IO_Data data, Gfx_LoadTex_Flag flag)
+{
+	memset(tex, 0, sizeof(Gfx_Tex));
+	if (flag & GFX_LOADTEX_FREE)
+		Mem_Free(data);
+	return 0;
+}
+
+Gfx_TexFence Gfx_LoadTex(Gfx_Tex *tex, IO_Data data, Gfx_LoadTex_Flag flag) { return Gfx_Upload(tex, data, flag); }
+Gfx_TexFence Gfx_LoadTexAt(Gfx_Tex *tex, IO_Data data, const POINT *tpos, const POINT *cpos, Gfx_LoadTex_Flag flag) { (void)tpos; (void)cpos; return Gfx_Upload(tex, data, flag); }
+boolean Gfx_TexDone(Gfx_TexFence fence) { (void)fence; return true; }
+void Gfx_WaitTex(Gfx_TexFence fence) { (void)fence; }
+void Gfx_FlushTex(void) {}
+void Gfx_ClearTPageUse(void) {}
+u32 Gfx_GetTPageUse(void) { return 0; }
+
+void Gfx_Flip(void)
+{
+	if (xa_playing && !xa_paused)
+		xa_frames++;
+}
+
+void Gfx_SetClear(u8 r, u8 g, u8 b) { (void)r; (void)g; (void)b; }
+void Gfx_EnableClear(void) {}
+void Gfx_DisableClear(void) {}
+void Gfx_DrawRect(const RECT *rect, u8 r, u8 g, u8 b) { (void)rect; (void)r; (void)g; (void)b; }
+void Gfx_BlendRect(const RECT *rect, u8 r, u8 g, u8 b, u8 mode) { (void)rect; (void)r; (void)g; (void)b; (void)mode; }
+void Gfx_BlitTexCol(Gfx_Tex *tex, const RECT *src, s32 x, s32 y, u8 r, u8 g, u8 b) { (void)tex; (void)src; (void)x; (void)y; (void)r; (void)g; (void)b; }
+void Gfx_BlitTex(Gfx_Tex *tex, const RECT *src, s32 x, s32 y) { (void)tex; (void)src; (void)x; (void)y; }
+void Gfx_DrawTexCol(Gfx_Tex *tex, const RECT *src, const RECT *dst, u8 r, u8 g, u8 b) { (void)tex; (void)src; (void)dst; (void)r; (void)g; (void)b; }
+void Gfx_DrawTex(Gfx_Tex *tex, const RECT *src, const RECT *dst) { (void)tex; (void)src; (void)dst; }
+void Gfx_BlendTex(Gfx_Tex *tex, const RECT *src, const RECT *dst, u8 opacity, u8 mode) { (void)tex; (void)src; (void)dst; (void)opacity; (void)mode; }
+void Gfx_DrawTexArbCol(Gfx_Tex *tex, const RECT *src, const POINT *p0, const POINT *p1, const POINT *p2, const POINT *p3, u8 r, u8 g, u8 b) { (void)tex; (void)src; (void)p0; (void)p1; (void)p2; (void)p3; (void)r; (void)g; (void)b; }
+void Gfx_DrawTexArb(Gfx_Tex *tex, const RECT *src, const POINT *p0, const POINT *p1, const POINT *p2, const POINT *p3) { (void)tex; (void)src; (void)p0; (void)p1; (void)p2; (void)p3; }
+void Gfx_BlendTexArb(Gfx_Tex *tex, const RECT *src, const POINT *p0, const POINT *p1, const POINT *p2, const POINT *p3, u8 mode) { (void)tex; (void)src; (void)p0; (void)p1; (void)p2; (void)p3; (void)mode; }
+
+//Game
+typedef struct
+{
+	StageId id, die; //Song to start from and song to die in (StageId_Max for none)
+	boolean story;
+} Trace_Play;
+
+static const Trace_Play trace_plays[] = {
+	//Story mode
+	{StageId_1_1, StageId_1_2, true},
+	{StageId_2_1, StageId_Max, true},
+	{StageId_3_1, StageId_3_3, true},
+	{StageId_4_1, StageId_4_1, true},
+	{StageId_5_1, StageId_Max, true},
+	{StageId_6_1, StageId_Max, true}, //Week 6 Boyfriend has no death animation
+
+	//Freeplay
+	{StageId_1_4, StageId_Max, false},
+	{StageId_2_3, StageId_2_3, false},
+	{StageId_4_3, StageId_Max, false},
+	{StageId_5_3, StageId_5_3, false},
+	{StageId_6_3, StageId_Max, false},
+};
+
+static void Game_Frame(void)
+{
+	Timer_Tick();
+	Stage_Tick();
+	Gfx_Flip();
+}
+
+//Enters a stage from the menu like Menu_Tick's MenuPage_Stage, then plays until it goes back to the menu
+//Returns true if the player died
+static boolean Game_Play(const Trace_Play *play, boolean die)
+{
+	Menu_Unload();
+	LoadScr_Start();
+	stage.prefs.botplay = true;
+	Stage_Load(play->id, StageDiff_Hard, play->story);
+	gameloop = GameLoop_Stage;
+	LoadScr_End();
+
+	boolean died = false;
+	u32 frames = 0;
+	while (gameloop == GameLoop_Stage)
+	{
+		pad_state.press = 0;
+		switch (stage.state)
+		{
+			case StageState_Play:
+				//Die a third of the way through the song
+				if (die && stage.stage_id == play->die && stage.note_scroll > 0 && (u32)Audio_TellXA_Milli() > xa_length / 3)
+				{
+					stage.player_state[0].health = 0;
+					die = false;
+				}
+				if (++frames % 300 == 0)
+					fputs("p\n", trace);
+				break;
+			case StageState_DeadRetry:
+				//Back to the menu
+				if (!died)
+					pad_state.press = PAD_CIRCLE;
+				died = true;
+				break;
+			default:
+				break;
+		}
+		Game_Frame();
+	}
+
+	fputs("m\n", trace);
+	return died;
+}
+
+int main(void)
+{
+	trace = stdout;
+	IO_LoadMap();
+
+	//Start at the main menu, the opening reads the PS1's clock
+	fprintf(trace, "# Recorded by test/gametrace (%d plays)\n", (int)COUNT_OF(trace_plays));
+	gameloop = GameLoop_Menu;
+	Menu_Load(MenuPage_Main);
+	fputs("m\n", trace);
+
+	for (size_t i = 0; i < COUNT_OF(trace_plays); i++)
+	{
+		//Play again after dying
+		if (Game_Play(&trace_plays[i], true))
+			Game_Play(&trace_plays[i], false);
+	}
+
+	Menu_Unload();
+	fprintf(stderr, "%u allocations, %u left allocated\n", trace_id, trace_live);
+	return 0;
+}
@@ -0,0 +1,347 @@
+/*
+	Judgement replay test
+	Replays seeded inputs (and botplay) over every chart given, once through the game's per-lane note checks
+	and once through the linear scan over every note in the hit window that they replaced,
+	and fails if the judgements, animations, scores or hit notes differ.
+*/
+
+#include "stagehost.h"
+
+#define REPLAY_SEEDS 20
+
+//Linear scan note checks, as they were before notes were split into lanes
+static void Stage_NoteCheck_Scan(PlayerState *this, u8 type)
+{
+	//Perform note check
+	for (Note *note = stage.cur_note;; note++)
+	{
+		if (!(note->type & NOTE_FLAG_MINE))
+		{
+			//Check if note can be hit
+			fixed_t note_fp = (fixed_t)note->pos << FIXED_SHIFT;
+			if (note_fp - stage.early_safe > stage.note_scroll)
+				break;
+			if (note_fp + stage.late_safe < stage.note_scroll)
+				continue;
+			if ((note->type & NOTE_FLAG_HIT) || (note->type & (NOTE_FLAG_OPPONENT | 0x3)) != type || (note->type & NOTE_FLAG_SUSTAIN))
+				continue;
+			
+			//Hit the note
+			note->type |= NOTE_FLAG_HIT;
+			
+			this->character->set_anim(this->character, note_anims[type & 0x3][(note->type & NOTE_FLAG_ALT_ANIM) != 0]);
+			u8 hit_type = Stage_HitNote(this, type, stage.note_scroll - note_fp);
+			this->arrow_hitan[type & 0x3] = stage.step_time;	
+
+				(void)hit_type;
+			return;
+		}
+		else
+		{
+			//Check if mine can be hit
+			fixed_t note_fp = (fixed_t)note->pos << FIXED_SHIFT;
+			if (note_fp - (stage.late_safe * 3 / 5) > stage.note_scroll)
+				break;
+			if (note_fp + (stage.late_safe * 2 / 5) < stage.note_scroll)
+				continue;
+			if ((note->type & NOTE_FLAG_HIT) || (note->type & (NOTE_FLAG_OPPONENT | 0x3)) != type || (note->type & NOTE_FLAG_SUSTAIN))
+				continue;
+			
+			//Hit the mine
+			note->type |= NOTE_FLAG_HIT;
+			
+			if (stage.stage_id == StageId_2_4)
+				this->health = -0x7000;
+			else
+				this->health -= 2000;
+			if (this->character->spec & CHAR_SPEC_MISSANIM)
+				this->character->set_anim(this->character, note_anims[type & 0x3][2]);
+			else
+				this->character->set_anim(this->character, note_anims[type & 0x3][0]);
+			this->arrow_hitan[type & 0x3] = -1;
+			return;
+		}
+	}
+	
+	//Missed a note
+	this->arrow_hitan[type & 0x3] = -1;
+	
+	if (!stage.prefs.ghost)
+	{
+		if (this->character->spec & CHAR_SPEC_MISSANIM)
+			this->character->set_anim(this->character, note_anims[type & 0x3][2]);
+		else
+			this->character->set_anim(this->character, note_anims[type & 0x3][0]);
+		Stage_MissNote(this);
+		
+		this->health -= 1000;
+		this->score -= 5;
+		this->miss++;
+		this->refresh_info = true;
+	}
+}
+
+static void Stage_SustainCheck_Scan(PlayerState *this, u8 type)
+{
+	//Perform note check
+	for (Note *note = stage.cur_note;; note++)
+	{
+		//Check if note can be hit
+		fixed_t note_fp = (fixed_t)note->pos << FIXED_SHIFT;
+		if (note_fp - stage.early_sus_safe > stage.note_scroll)
+			break;
+		if (note_fp + stage.late_sus_safe < stage.note_scroll)
+			continue;
+		if ((note->type & NOTE_FLAG_HIT) || (note->type & (NOTE_FLAG_OPPONENT | 0x3)) != type || !(note->type & NOTE_FLAG_SUSTAIN))
+			continue;
+		
+		//Hit the note
+		note->type |= NOTE_FLAG_HIT;
+		
+		this->character->set_anim(this->character, note_anims[type & 0x3][(note->type & NOTE_FLAG_ALT_ANIM) != 0]);
+		
+		Stage_StartVocal();
+		this->health += 230;
+		this->arrow_hitan[type & 0x3] = stage.step_time;
+	}
+}
+
+static void Stage_ProcessPlayer_Scan(PlayerState *this, Pad *pad, boolean playing)
+{
+	//Handle player note presses
+	if (!stage.prefs.botplay)
+	{
+		if (playing)
+		{
+			u8 i = (this->character == stage.opponent) ? NOTE_FLAG_OPPONENT : 0;
+			
+			this->pad_held = this->character->pad_held = pad->held;
+			this->pad_press = pad->press;
+			
+			if (this->pad_held & INPUT_LEFT)
+				Stage_SustainCheck_Scan(this, 0 | i);
+			if (this->pad_held & INPUT_DOWN)
+				Stage_SustainCheck_Scan(this, 1 | i);
+			if (this->pad_held & INPUT_UP)
+				Stage_SustainCheck_Scan(this, 2 | i);
+			if (this->pad_held & INPUT_RIGHT)
+				Stage_SustainCheck_Scan(this, 3 | i);
+			
+			if (this->pad_press & INPUT_LEFT)
+				Stage_NoteCheck_Scan(this, 0 | i);
+			if (this->pad_press & INPUT_DOWN)
+				Stage_NoteCheck_Scan(this, 1 | i);
+			if (this->pad_press & INPUT_UP)
+				Stage_NoteCheck_Scan(this, 2 | i);
+			if (this->pad_press & INPUT_RIGHT)
+				Stage_NoteCheck_Scan(this, 3 | i);
+		}
+		else
+		{
+			this->pad_held = this->character->pad_held = 0;
+			this->pad_press = 0;
+		}
+}
+		//Do perfect note checks
+	if (stage.prefs.botplay)
+	{
+		if (playing)
+		{
+			u8 i = (this->character == stage.opponent) ? NOTE_FLAG_OPPONENT : 0;
+			
+			u8 hit[4] = {0, 0, 0, 0};
+			for (Note *note = stage.cur_note;; note++)
+			{
+				//Check if note can be hit
+				fixed_t note_fp = (fixed_t)note->pos << FIXED_SHIFT;
+				if (note_fp - stage.early_safe - FIXED_DEC(12,1) > stage.note_scroll)
+					break;
+				if (note_fp + stage.late_safe < stage.note_scroll)
+					continue;
+				if ((note->type & NOTE_FLAG_MINE) || (note->type & NOTE_FLAG_OPPONENT) != i)
+					continue;
+				
+				//Handle note hit
+				if (!(note->type & NOTE_FLAG_SUSTAIN))
+				{
+					if (note->type & NOTE_FLAG_HIT)
+						continue;
+					if (stage.note_scroll >= note_fp)
+						hit[note->type & 0x3] |= 1;
+					else if (!(hit[note->type & 0x3] & 8))
+						hit[note->type & 0x3] |= 2;
+				}
+				else if (!(hit[note->type & 0x3] & 2))
+				{
+					if (stage.note_scroll <= note_fp)
+						hit[note->type & 0x3] |= 4;
+					hit[note->type & 0x3] |= 8;
+				}
+			}
+			
+			//Handle input
+			this->pad_held = 0;
+			this->pad_press = 0;
+			
+			for (u8 j = 0; j < 4; j++)
+			{
+				if (hit[j] & 5)
+				{
+					this->pad_held |= note_key[j];
+					Stage_SustainCheck_Scan(this, j | i);
+				}
+				if (hit[j] & 1)
+				{
+					this->pad_press |= note_key[j];
+					Stage_NoteCheck_Scan(this, j | i);
+				}
+			}
+			
+			this->character->pad_held = this->pad_held;
+		}
+		else
+		{
+			this->pad_held = this->character->pad_held = 0;
+			this->pad_press = 0;
+		}
+	}
+}
+
+
+//Replay log, a hash of every animation and the player state after every frame
+static u32 judge_log;
+
+static void Judge_Log(u32 value)
+{
+	judge_log = (judge_log ^ value) * 0x01000193;
+}
+
+static void Judge_SetAnim(Character *this, u8 anim)
+{
+	(void)this;
+	Judge_Log(0x100 | anim);
+}
+
+static u32 judge_rng;
+static u32 Judge_Rand(void)
+{
+	judge_rng = judge_rng * 1103515245u + 12345u;
+	return judge_rng >> 8;
+}
+
+typedef struct
+{
+	u32 log;
+	s32 score;
+	s16 health;
+	u16 combo, miss;
+	u32 hits;
+} Judge_Result;
+
+static void Judge_Replay(Judge_Result *result, const u8 *types, boolean scan, boolean botplay, u32 seed, int frames)
+{
+	PlayerState *this = &stage.player_state[0];
+	
+	//Restart the song
+	for (u16 i = 0; i < stage.num_notes; i++)
+		stage.notes[i].type = types[i];
+	for (u8 i = 0; i < 8; i++)
+		stage.note_lane[i].cur = 0;
+	stage.cur_note = stage.notes;
+	stage.note_scroll = 0;
+	Stage_SetSection(stage.sections);
+	Stage_LoadState();
+	stage.player->set_anim = Judge_SetAnim;
+	stage.prefs.botplay = botplay;
+	stage.prefs.ghost = seed & 1;
+	judge_rng = seed;
+	judge_log = 0;
+	
+	Pad pad;
+	memset(&pad, 0, sizeof(pad));
+	for (int f = 0; f < frames; f++)
+	{
+		StageHost_SetTime(FIXED_DIV((fixed_t)f << FIXED_SHIFT, FIXED_DEC(60,1)));
+		
+		//Press the player's notes near their hit window, sometimes mash or let go
+		pad.press = 0;
+		for (Note *note = stage.cur_note; note->pos != 0xFFFF && note < stage.cur_note + 16; note++)
+		{
+			fixed_t diff = ((fixed_t)note->pos << FIXED_SHIFT) - stage.note_scroll;
+			if (!(note->type & NOTE_FLAG_OPPONENT) && diff < stage.early_safe && diff > -stage.late_safe && Judge_Rand() % 3 == 0)
+				pad.press |= note_key[note->type & 0x3];
+		}
+		if (Judge_Rand() % 20 == 0)
+			pad.press |= note_key[Judge_Rand() & 0x3];
+		if (Judge_Rand() % 6 == 0)
+			pad.held = pad.press | (pad.held & Judge_Rand());
+		else
+			pad.held |= pad.press;
+		
+		if (scan)
+			Stage_ProcessPlayer_Scan(this, &pad, true);
+		else
+			Stage_ProcessPlayer(this, &pad, true);
+		Stage_DrawNotes();
+		
+		Judge_Log(this->pad_held | (this->pad_press << 16));
+		Judge_Log(this->score);
+		Judge_Log(this->health);
+		for (u8 i = 0; i < 4; i++)
+			Judge_Log(this->arrow_hitan[i]);
+	}
+	
+	result->log = judge_log;
+	result->score = this->score;
+	result->health = this->health;
+	result->combo = this->combo;
+	result->miss = this->miss;
+	result->hits = 0;
+	for (u16 i = 0; i < stage.num_notes; i++)
+		if (stage.notes[i].type & NOTE_FLAG_HIT)
+			result->hits++;
+}
+
+int main(int argc, char *argv[])
+{
+	int failed = 0, replays = 0;
+	
+	for (int i = 1; i < argc; i++)
+	{
+		StageHost_LoadChart(StageId_1_1, argv[i]);
+		int frames = (StageHost_GetEndTime() * 60) >> FIXED_SHIFT;
+		
+		u8 *types = malloc(stage.num_notes);
+		for (u16 j = 0; j < stage.num_notes; j++)
+			types[j] = stage.notes[j].type;
+		
+		int matched = 0;
+		u32 hits = 0;
+		for (u8 botplay = 0; botplay < 2; botplay++)
+		{
+			for (u32 seed = 1; seed <= REPLAY_SEEDS; seed++)
+			{
+				Judge_Result scan, lane;
+				Judge_Replay(&scan, types, true, botplay, seed, frames);
+				Judge_Replay(&lane, types, false, botplay, seed, frames);
+				
+				if (memcmp(&scan, &lane, sizeof(Judge_Result)) == 0)
+				{
+					matched++;
+					hits += lane.hits;
+				}
+				else if (failed++ < 10)
+				{
+					printf("%s botplay %d seed %u: score %d vs %d, misses %u vs %u, hits %u vs %u, log %08X vs %08X\n", argv[i], botplay, seed,
+						scan.score, lane.score, scan.miss, lane.miss, scan.hits, lane.hits, scan.log, lane.log);
+				}
+				replays++;
+			}
+		}
+		printf("%-40s %4u notes: %d/%d replays match, %u hits\n", argv[i], (unsigned)stage.num_notes, matched, 2 * REPLAY_SEEDS, hits);
+		free(types);
+	}
+	
+	printf("%d/%d replays match\n", replays - failed, replays);
+	return failed != 0;
+}
@@ -0,0 +1,219 @@
+/*
+	Section jump test
+	Plays every chart given with botplay, then jumps to sections in the middle of the song from before, after
+	and during the countdown, and fails if playing on from the jump differs from playing through to it,
+	or if the music isn't started and sought to where the section starts.
+*/
+
+#include "stagehost.h"
+
+#define JUMP_SECTIONS 8
+
+typedef struct
+{
+	u32 hash;
+	fixed_t scroll;
+} Jump_Frame;
+
+static Jump_Frame *jump_frames;
+
+static u32 Jump_Hash(u32 hash, u32 x)
+{
+	return (hash ^ x) * 0x01000193;
+}
+
+static void Jump_Restart(const u8 *types)
+{
+	for (u16 i = 0; i < stage.num_notes; i++)
+		stage.notes[i].type = types[i];
+	for (u8 i = 0; i < 8; i++)
+		stage.note_lane[i].cur = 0;
+	stage.cur_note = stage.notes;
+	stage.note_scroll = 0;
+	stage.song_time = 0;
+	Stage_SetSection(stage.sections);
+	Stage_LoadState();
+	stage.prefs.botplay = true;
+}
+
+static fixed_t Jump_FrameTime(int f)
+{
+	return FIXED_DIV((fixed_t)f << FIXED_SHIFT, FIXED_DEC(60,1));
+}
+
+//Plays frames [from, to) with botplay, logging each one to jump_frames if given
+static void Jump_Play(int from, int to, Jump_Frame *log)
+{
+	PlayerState *this = &stage.player_state[0];
+	Pad pad;
+	memset(&pad, 0, sizeof(pad));
+	for (int f = from; f < to; f++)
+	{
+		s32 score = this->score;
+		u16 miss = this->miss;
+		StageHost_SetTime(Jump_FrameTime(f));
+		Stage_ProcessPlayer(this, &pad, true);
+		Stage_DrawNotes();
+
+		//Scores and misses from before the jump differ, what this frame adds to them doesn't
+		if (log != NULL)
+		{
+			u32 hash = Jump_Hash(0x811C9DC5, this->pad_held | (this->pad_press << 16));
+			hash = Jump_Hash(hash, this->score - score);
+			hash = Jump_Hash(hash, this->miss - miss);
+			hash = Jump_Hash(hash, stage.cur_section - stage.sections);
+			hash = Jump_Hash(hash, stage.step_crochet);
+			log[f].hash = Jump_Hash(hash, stage.note_scroll);
+			log[f].scroll = stage.note_scroll;
+		}
+	}
+}
+
+//First frame at or after the given time
+static int Jump_TimeFrame(fixed_t time)
+{
+	int f = (time * 60) >> FIXED_SHIFT;
+	while (Jump_FrameTime(f) < time)
+		f++;
+	return f;
+}
+
+//Checks a jump to the given section, returns the number of differences
+static int Jump_Check(const char *path, const char *how, u16 section, const u8 *hit, const Jump_Frame *ref, int frames)
+{
+	const SectionStart *start = &stage.section_start[section];
+	int failed = 0;
+
+	stub_xa_milli = 0xFFFFFFFF;
+	Stage_JumpSection(section);
+
+	u32 milli = ((start->time * 1000) >> FIXED_SHIFT) + stage.offset;
+	if (stub_xa_milli != milli)
+	{
+		printf("%s %s section %u: music sought to %u ms, expected %u ms\n", path, how, section, stub_xa_milli, milli);
+		failed++;
+	}
+	if (stage.note_scroll != ((fixed_t)start->step << FIXED_SHIFT) || stage.song_time != start->time || stage.cur_section != &stage.sections[section])
+	{
+		printf("%s %s section %u: landed at step %d time %d\n", path, how, section, stage.note_scroll >> FIXED_SHIFT, stage.song_time);
+		failed++;
+	}
+
+	u16 first = stage.cur_note - stage.notes;
+	for (u8 i = 0; i < 8; i++)
+	{
+		const NoteLane *lane = &stage.note_lane[i];
+		if ((lane->cur != 0 && lane->note[lane->cur - 1] >= first) || (lane->cur < lane->len && lane->note[lane->cur] < first))
+		{
+			printf("%s %s section %u: lane %u doesn't start at note %u\n", path, how, section, i, first);
+			failed++;
+			break;
+		}
+	}
+
+	//Play on to the end, frames are compared once notes from before the section can't be hit anymore
+	int from = Jump_TimeFrame(start->time);
+	Jump_Play(from, frames, jump_frames);
+
+	fixed_t settled = ((fixed_t)start->step << FIXED_SHIFT) + stage.late_safe + (12 << FIXED_SHIFT);
+	for (int f = from; f < frames; f++)
+	{
+		if (ref[f].scroll < settled)
+			continue;
+		if (jump_frames[f].hash != ref[f].hash)
+		{
+			printf("%s %s section %u: frame %d differs from playing through\n", path, how, section, f);
+			failed++;
+			break;
+		}
+	}
+
+	for (u16 i = 0; i < stage.num_notes; i++)
+	{
+		Note *note = &stage.notes[i];
+		if (((fixed_t)note->pos << FIXED_SHIFT) >= settled && (note->type & NOTE_FLAG_HIT) != (hit[i] & NOTE_FLAG_HIT))
+		{
+			printf("%s %s section %u: note %u at step %u %s\n", path, how, section, i, note->pos, (hit[i] & NOTE_FLAG_HIT) ? "wasn't hit" : "was hit");
+			failed++;
+			break;
+		}
+	}
+
+	return failed;
+}
+
+int main(int argc, char *argv[])
+{
+	int failed = 0, jumps = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		StageHost_LoadChart(StageId_1_1, argv[i]);
+		int frames = (StageHost_GetEndTime() * 60) >> FIXED_SHIFT;
+		int chart_failed = 0, chart_jumps = 0;
+
+		u8 *types = malloc(stage.num_notes);
+		for (u16 j = 0; j < stage.num_notes; j++)
+			types[j] = stage.notes[j].type;
+
+		//Play through once for reference
+		Jump_Frame *ref = malloc(frames * sizeof(Jump_Frame));
+		jump_frames = malloc(frames * sizeof(Jump_Frame));
+		Jump_Restart(types);
+		Jump_Play(0, frames, ref);
+		u8 *hit = malloc(stage.num_notes);
+		for (u16 j = 0; j < stage.num_notes; j++)
+			hit[j] = stage.notes[j].type;
+
+		//Every section starts where Stage_FindSection says
+		for (u16 j = 0; j < stage.num_sections; j++)
+		{
+			fixed_t time = stage.section_start[j].time;
+			u16 found = Stage_FindSection(time);
+			if (stage.section_start[found].time != time || (found + 1 < stage.num_sections && stage.section_start[found + 1].time <= time))
+			{
+				printf("%s: Stage_FindSection found section %u for section %u\n", argv[i], found, j);
+				failed++;
+				break;
+			}
+		}
+
+		for (u16 k = 1; k <= JUMP_SECTIONS; k++)
+		{
+			u16 section = (u32)stage.num_sections * k / (JUMP_SECTIONS + 1);
+			if (section == 0 || stage.section_start[section].time >= StageHost_GetEndTime())
+				continue;
+			int at = Jump_TimeFrame(stage.section_start[section].time);
+
+			//Forward, from halfway to the section
+			Jump_Restart(types);
+			Jump_Play(0, at / 2, NULL);
+			chart_failed += Jump_Check(argv[i], "forward", section, hit, ref, frames) != 0;
+
+			//Back, from the end of the song
+			chart_failed += Jump_Check(argv[i], "back", section, hit, ref, frames) != 0;
+
+			//During the countdown, which starts the music
+			Jump_Restart(types);
+			stage.note_scroll = -(48 << FIXED_SHIFT);
+			stub_xa_track = -1;
+			chart_failed += (Jump_Check(argv[i], "countdown", section, hit, ref, frames) != 0 || stub_xa_track != (s32)stage.stage_def->music_track);
+			if (stub_xa_track != (s32)stage.stage_def->music_track)
+				printf("%s countdown section %u: music wasn't started\n", argv[i], section);
+
+			chart_jumps += 3;
+		}
+
+		printf("%-40s %4u sections: %d/%d jumps match\n", argv[i], stage.num_sections, chart_jumps - chart_failed, chart_jumps);
+		failed += chart_failed;
+		jumps += chart_jumps;
+
+		free(hit);
+		free(jump_frames);
+		free(ref);
+		free(types);
+	}
+
+	printf("%d/%d jumps match\n", jumps - failed, jumps);
+	return failed != 0;
+}
@@ -0,0 +1,18 @@
+/*
+	The allocator without its size class free lists (MEM_QUICKMAX 0), which is the first fit list walk it used to be.
+	Its functions are renamed so membench can replay the same trace against both in one run.
+*/
+
+#define MEM_QUICKMAX 0
+#define Mem_Init MemWalk_Init
+#define Mem_Alloc MemWalk_Alloc
+#define Mem_Free MemWalk_Free
+#define Mem_ArenaBegin MemWalk_ArenaBegin
+#define Mem_ArenaEnd MemWalk_ArenaEnd
+#define Mem_ArenaReset MemWalk_ArenaReset
+#define Mem_GetStat MemWalk_GetStat
+#define Mem_GetFrag MemWalk_GetFrag
+
+#define MEM_IMPLEMENTATION
+#define MEM_STAT
+#include "../src/mem.h"
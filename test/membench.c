@@ -0,0 +1,193 @@
+/*
+	Allocator trace benchmark
+	Replays the allocations recorded from the game by test/gametrace (test/gametrace.txt, or the trace given)
+	against src/mem.h with and without its size class free lists,
+	and prints the time per allocation or free and the peak heap use of each.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MEM_IMPLEMENTATION
+#define MEM_STAT
+#include "../src/mem.h"
+
+//Allocator without free lists (mem_walk.c)
+int MemWalk_Init(void *ptr, size_t size);
+void *MemWalk_Alloc(size_t size);
+void MemWalk_Free(void *ptr);
+void MemWalk_ArenaBegin(void);
+void MemWalk_ArenaEnd(void);
+void MemWalk_ArenaReset(void);
+void MemWalk_GetStat(size_t *used, size_t *size, size_t *max);
+
+typedef struct
+{
+	const char *name;
+	int (*init)(void *ptr, size_t size);
+	void *(*alloc)(size_t size);
+	void (*free)(void *ptr);
+	void (*arena_begin)(void);
+	void (*arena_end)(void);
+	void (*arena_reset)(void);
+	void (*stat)(size_t *used, size_t *size, size_t *max);
+} Allocator;
+
+static const Allocator allocators[] = {
+	{"list walk",  MemWalk_Init, MemWalk_Alloc, MemWalk_Free, MemWalk_ArenaBegin, MemWalk_ArenaEnd, MemWalk_ArenaReset, MemWalk_GetStat},
+	{"free lists", Mem_Init,     Mem_Alloc,     Mem_Free,     Mem_ArenaBegin,     Mem_ArenaEnd,     Mem_ArenaReset,     Mem_GetStat},
+};
+
+//Trace
+typedef enum
+{
+	TraceOp_Alloc,
+	TraceOp_Free,
+	TraceOp_ArenaBegin,
+	TraceOp_ArenaEnd,
+	TraceOp_ArenaReset,
+} TraceOp_Type;
+
+typedef struct
+{
+	TraceOp_Type type;
+	unsigned int id;   //Allocation the op is for
+	unsigned long size; //Size to allocate
+} TraceOp;
+
+static TraceOp *trace;
+static size_t trace_len, trace_cap;
+static unsigned int trace_ids;
+
+static void Trace_Push(TraceOp_Type type, unsigned int id, unsigned long size)
+{
+	if (trace_len == trace_cap)
+	{
+		trace_cap = trace_cap ? (trace_cap * 2) : 0x1000;
+		if ((trace = realloc(trace, trace_cap * sizeof(TraceOp))) == NULL)
+		{
+			fputs("Out of memory\n", stderr);
+			exit(1);
+		}
+	}
+	trace[trace_len].type = type;
+	trace[trace_len].id = id;
+	trace[trace_len].size = size;
+	trace_len++;
+	if (id >= trace_ids)
+		trace_ids = id + 1;
+}
+
+static int Trace_Load(const char *path)
+{
+	FILE *fp = fopen(path, "r");
+	if (fp == NULL)
+	{
+		printf("Failed to open %s\n", path);
+		return 1;
+	}
+	
+	//Sample points don't matter here
+	char line[0x80];
+	unsigned int id;
+	unsigned long size;
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		if (sscanf(line, "a %u %lu", &id, &size) == 2)
+			Trace_Push(TraceOp_Alloc, id, size);
+		else if (sscanf(line, "f %u", &id) == 1)
+			Trace_Push(TraceOp_Free, id, 0);
+		else if (line[0] == 'b')
+			Trace_Push(TraceOp_ArenaBegin, 0, 0);
+		else if (line[0] == 'e')
+			Trace_Push(TraceOp_ArenaEnd, 0, 0);
+		else if (line[0] == 'r')
+			Trace_Push(TraceOp_ArenaReset, 0, 0);
+	}
+	fclose(fp);
+	return 0;
+}
+
+//Replay
+static unsigned char heap[0x1A0000]; //Same size as the game's heap
+
+static double Now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int Replay(const Allocator *alloc, double *ns, size_t *peak)
+{
+	void **ptr = calloc(trace_ids, sizeof(void*));
+	size_t i;
+	int runs = 0;
+	double start = Now(), time;
+	
+	do
+	{
+		alloc->init(heap, sizeof(heap));
+		for (i = 0; i < trace_len; i++)
+		{
+			switch (trace[i].type)
+			{
+				case TraceOp_Alloc:
+					if ((ptr[trace[i].id] = alloc->alloc(trace[i].size)) == NULL)
+					{
+						printf("%s: out of memory at op %lu\n", alloc->name, (unsigned long)i);
+						return 1;
+					}
+					break;
+				case TraceOp_Free:
+					alloc->free(ptr[trace[i].id]);
+					break;
+				case TraceOp_ArenaBegin:
+					alloc->arena_begin();
+					break;
+				case TraceOp_ArenaEnd:
+					alloc->arena_end();
+					break;
+				case TraceOp_ArenaReset:
+					alloc->arena_reset();
+					break;
+			}
+		}
+		runs++;
+	} while ((time = Now() - start) < 1.0);
+	
+	*ns = time * 1e9 / ((double)trace_len * runs);
+	alloc->stat(NULL, NULL, peak);
+	free(ptr);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	double ns[2];
+	size_t peak[2], i, small = 0, large = 0;
+	
+	if (Trace_Load((argc > 1) ? argv[1] : "test/gametrace.txt"))
+		return 1;
+	for (i = 0; i < trace_len; i++)
+	{
+		if (trace[i].type != TraceOp_Alloc)
+			continue;
+		if (MEM_ALIGN(trace[i].size + MEM_HEDSIZE) <= MEM_QUICKMAX)
+			small++;
+		else
+			large++;
+	}
+	printf("%lu ops, %lu allocations small enough for the free lists, %lu bigger\n", (unsigned long)trace_len, (unsigned long)small, (unsigned long)large);
+	
+	for (i = 0; i < 2; i++)
+	{
+		if (Replay(&allocators[i], &ns[i], &peak[i]))
+			return 1;
+		printf("%-10s %6.1f ns/op, peak %lu bytes\n", allocators[i].name, ns[i], (unsigned long)peak[i]);
+	}
+	printf("free lists are %.2fx as fast\n", ns[0] / ns[1]);
+	return 0;
+}
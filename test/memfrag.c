@@ -0,0 +1,221 @@
+/*
+	Stage arena fragmentation report
+	Replays the allocations recorded from the game by test/gametrace (test/gametrace.txt, or the trace given) against src/mem.h,
+	once with Stage_Load allocating from the arena and once without,
+	and reports the largest free block (the biggest thing that could still be loaded) while playing and at the menu.
+	Fails if the arena leaves a smaller largest free block than the plain heap, on average or in the worst case,
+	or if anything is left allocated once the trace is done.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MEM_IMPLEMENTATION
+#define MEM_STAT
+#include "../src/mem.h"
+
+//Trace
+typedef enum
+{
+	TraceOp_Alloc,
+	TraceOp_Free,
+	TraceOp_ArenaBegin,
+	TraceOp_ArenaEnd,
+	TraceOp_ArenaReset,
+	TraceOp_SamplePlay,
+	TraceOp_SampleMenu,
+} TraceOp_Type;
+
+typedef struct
+{
+	TraceOp_Type type;
+	unsigned int id;   //Allocation the op is for
+	unsigned long size; //Size to allocate
+} TraceOp;
+
+static TraceOp *trace;
+static size_t trace_len, trace_cap;
+static unsigned int trace_ids;
+
+static void Trace_Push(TraceOp_Type type, unsigned int id, unsigned long size)
+{
+	if (trace_len == trace_cap)
+	{
+		trace_cap = trace_cap ? (trace_cap * 2) : 0x1000;
+		if ((trace = realloc(trace, trace_cap * sizeof(TraceOp))) == NULL)
+		{
+			fputs("Out of memory\n", stderr);
+			exit(1);
+		}
+	}
+	trace[trace_len].type = type;
+	trace[trace_len].id = id;
+	trace[trace_len].size = size;
+	trace_len++;
+	if (id >= trace_ids)
+		trace_ids = id + 1;
+}
+
+static int Trace_Load(const char *path)
+{
+	FILE *fp = fopen(path, "r");
+	if (fp == NULL)
+	{
+		printf("Failed to open %s\n", path);
+		return 1;
+	}
+
+	char line[0x80];
+	unsigned int id;
+	unsigned long size;
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		if (sscanf(line, "a %u %lu", &id, &size) == 2)
+			Trace_Push(TraceOp_Alloc, id, size);
+		else if (sscanf(line, "f %u", &id) == 1)
+			Trace_Push(TraceOp_Free, id, 0);
+		else if (line[0] == 'b')
+			Trace_Push(TraceOp_ArenaBegin, 0, 0);
+		else if (line[0] == 'e')
+			Trace_Push(TraceOp_ArenaEnd, 0, 0);
+		else if (line[0] == 'r')
+			Trace_Push(TraceOp_ArenaReset, 0, 0);
+		else if (line[0] == 'p')
+			Trace_Push(TraceOp_SamplePlay, 0, 0);
+		else if (line[0] == 'm')
+			Trace_Push(TraceOp_SampleMenu, 0, 0);
+	}
+	fclose(fp);
+	return 0;
+}
+
+//Report
+typedef struct
+{
+	double sum_free, sum_largest;
+	size_t worst_free, worst_largest;
+	int samples;
+} Frag;
+
+static void Frag_Sample(Frag *frag)
+{
+	size_t free, largest;
+	Mem_GetFrag(&free, &largest);
+	frag->sum_free += free;
+	frag->sum_largest += largest;
+	if (frag->samples++ == 0 || largest < frag->worst_largest)
+	{
+		frag->worst_free = free;
+		frag->worst_largest = largest;
+	}
+}
+
+static double Frag_Average(const Frag *frag)
+{
+	return frag->sum_largest / frag->samples;
+}
+
+static void Frag_Print(const char *name, const Frag *frag)
+{
+	double free = frag->sum_free / frag->samples, largest = Frag_Average(frag);
+	printf("  %-8s average %7.0f of %7.0f free (%4.1f%% fragmented), worst %7lu of %7lu free (%4.1f%% fragmented)\n", name,
+		largest, free, 100.0 * (free - largest) / free,
+		(unsigned long)frag->worst_largest, (unsigned long)frag->worst_free, 100.0 * (frag->worst_free - frag->worst_largest) / frag->worst_free
+	);
+}
+
+//Replay
+static unsigned char heap[0x1A0000]; //Same size as the game's heap
+
+static int Run(int arena, Frag *play, Frag *menu)
+{
+	void **ptr = calloc(trace_ids, sizeof(void*));
+	size_t i, used;
+
+	memset(play, 0, sizeof(Frag));
+	memset(menu, 0, sizeof(Frag));
+	Mem_Init(heap, sizeof(heap));
+
+	for (i = 0; i < trace_len; i++)
+	{
+		switch (trace[i].type)
+		{
+			case TraceOp_Alloc:
+				if ((ptr[trace[i].id] = Mem_Alloc(trace[i].size)) == NULL)
+				{
+					printf("out of memory at op %lu\n", (unsigned long)i);
+					return 1;
+				}
+				break;
+			case TraceOp_Free:
+				Mem_Free(ptr[trace[i].id]);
+				break;
+			case TraceOp_ArenaBegin:
+				if (arena)
+					Mem_ArenaBegin();
+				break;
+			case TraceOp_ArenaEnd:
+				if (arena)
+					Mem_ArenaEnd();
+				break;
+			case TraceOp_ArenaReset:
+				if (arena)
+					Mem_ArenaReset();
+				break;
+			case TraceOp_SamplePlay:
+				Frag_Sample(play);
+				break;
+			case TraceOp_SampleMenu:
+				Frag_Sample(menu);
+				break;
+		}
+	}
+	free(ptr);
+
+	//Everything should be freed once the game is done
+	Mem_GetStat(&used, NULL, NULL);
+	if (used != MEM_HEDSIZE)
+	{
+		printf("%lu bytes still allocated at the end of the trace\n", (unsigned long)(used - MEM_HEDSIZE));
+		return 1;
+	}
+	if (play->samples == 0 || menu->samples == 0)
+	{
+		puts("trace has no sample points");
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	static const char *name[2] = {"heap", "arena"};
+	Frag play[2], menu[2];
+	int i;
+
+	if (Trace_Load((argc > 1) ? argv[1] : "test/gametrace.txt"))
+		return 1;
+
+	puts("Recorded game trace, largest free block:");
+	for (i = 0; i < 2; i++)
+	{
+		if (Run(i, &play[i], &menu[i]))
+			return 1;
+		printf("%s\n", name[i]);
+		Frag_Print("playing", &play[i]);
+		Frag_Print("menu", &menu[i]);
+	}
+
+	if (Frag_Average(&play[1]) < Frag_Average(&play[0]) || Frag_Average(&menu[1]) < Frag_Average(&menu[0]))
+	{
+		puts("FAIL: the arena fragments the heap more than the plain heap on average");
+		return 1;
+	}
+	if (play[1].worst_largest < play[0].worst_largest || menu[1].worst_largest < menu[0].worst_largest)
+	{
+		puts("FAIL: the arena fragments the heap more than the plain heap in the worst case");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,227 @@
+/*
+	Note draw loop benchmark
+	Plays every frame of a chart (milf-hard by default, the densest shipped chart) at 60fps and times
+	- the note position walk as it was before note positions were precomputed (a section scroll and a divide per note)
+	- the same walk using the precomputed positions Stage_DrawNotes uses now
+	- Stage_DrawNotes itself, with drawing stubbed out
+	Also checks that both walks put every visible note at the same Y.
+*/
+
+#include "stagehost.h"
+
+#include <time.h>
+
+#define BENCH_REPS 20
+
+static fixed_t *time_base; //Start time of each section, summed from section lengths
+
+static double NoteBench_Now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//Walks the visible notes, returns a checksum of their Y
+static fixed_t NoteBench_WalkOld(Note **cur)
+{
+	SectionScroll scroll;
+	Section *scroll_section = stage.section_base;
+	scroll.start = time_base[scroll_section - stage.sections];
+	Stage_GetSectionScroll(&scroll, scroll_section);
+	
+	//Push scroll back until cur_note is properly contained
+	while (scroll.start_step > (*cur)->pos && scroll_section != stage.sections)
+	{
+		Stage_GetSectionScroll(&scroll, --scroll_section);
+		scroll.start -= scroll.length;
+	}
+	
+	fixed_t sum = 0;
+	for (Note *note = *cur; note->pos != 0xFFFF; note++)
+	{
+		//Update scroll
+		while (note->pos >= scroll_section->end)
+		{
+			scroll.start += scroll.length;
+			Stage_GetSectionScroll(&scroll, ++scroll_section);
+		}
+		
+		//Get note position
+		fixed_t time = scroll.start - stage.song_time;
+		if (scroll.length_step != 0)
+			time += scroll.length * (note->pos - scroll.start_step) / scroll.length_step;
+		fixed_t y = stage.note_y[note->type & 0x7] + FIXED_MUL(stage.speed, time * 150);
+		
+		if (y < FIXED_DEC(-16 - SCREEN_HEIGHT2, 1))
+		{
+			if (((fixed_t)note->pos << FIXED_SHIFT) + stage.late_safe < stage.note_scroll)
+				(*cur)++;
+			continue;
+		}
+		if (y > (FIXED_DEC(SCREEN_HEIGHT,2) + scroll.size))
+			break;
+		sum += y;
+	}
+	return sum;
+}
+
+static fixed_t NoteBench_WalkNew(Note **cur)
+{
+	fixed_t scroll_y = FIXED_MUL(stage.speed, stage.song_time * 150);
+	Section *scroll_section = stage.section_base;
+	if (Stage_GetSectionStart(scroll_section) > (*cur)->pos)
+		scroll_section = Stage_FindSectionStep((*cur)->pos, scroll_section);
+	
+	fixed_t sum = 0;
+	for (Note *note = *cur; note->pos != 0xFFFF; note++)
+	{
+		//Update scroll
+		while (note->pos >= scroll_section->end)
+			scroll_section++;
+		const SectionDraw *scroll = &stage.section_draw[scroll_section - stage.sections];
+		
+		//Get note position
+		fixed_t y = stage.note_y[note->type & 0x7] + stage.note_ybase[note - stage.notes] - scroll_y;
+		
+		if (y < FIXED_DEC(-16 - SCREEN_HEIGHT2, 1))
+		{
+			if (((fixed_t)note->pos << FIXED_SHIFT) + stage.late_safe < stage.note_scroll)
+				(*cur)++;
+			continue;
+		}
+		if (y > (FIXED_DEC(SCREEN_HEIGHT,2) + scroll->size))
+			break;
+		sum += y;
+	}
+	return sum;
+}
+
+//Checks every visible note's Y against the old walk, returns the largest difference
+static fixed_t NoteBench_Compare(Note *cur, u32 *visible)
+{
+	SectionScroll scroll;
+	Section *scroll_section = stage.sections;
+	scroll.start = 0;
+	Stage_GetSectionScroll(&scroll, scroll_section);
+	
+	fixed_t scroll_y = FIXED_MUL(stage.speed, stage.song_time * 150), max_diff = 0;
+	for (Note *note = stage.notes; note->pos != 0xFFFF; note++)
+	{
+		while (note->pos >= scroll_section->end)
+		{
+			scroll.start += scroll.length;
+			Stage_GetSectionScroll(&scroll, ++scroll_section);
+		}
+		if (note < cur)
+			continue;
+		
+		fixed_t time = scroll.start - stage.song_time;
+		if (scroll.length_step != 0)
+			time += scroll.length * (note->pos - scroll.start_step) / scroll.length_step;
+		fixed_t y_old = FIXED_MUL(stage.speed, time * 150);
+		fixed_t y_new = stage.note_ybase[note - stage.notes] - scroll_y;
+		if (y_old > (FIXED_DEC(SCREEN_HEIGHT,2) + scroll.size))
+			break;
+		if (y_old < FIXED_DEC(-16 - SCREEN_HEIGHT2 - 32, 1))
+			continue;
+		
+		fixed_t diff = (y_old > y_new) ? (y_old - y_new) : (y_new - y_old);
+		if (diff > max_diff)
+			max_diff = diff;
+		(*visible)++;
+	}
+	return max_diff;
+}
+
+static void NoteBench_SetFrame(int frame)
+{
+	//Restart the song on the first frame
+	if (frame == 0)
+	{
+		stage.note_scroll = 0;
+		stage.cur_note = stage.notes;
+		Stage_SetSection(stage.sections);
+		for (u8 i = 0; i < 8; i++)
+			stage.note_lane[i].cur = 0;
+	}
+	StageHost_SetTime(FIXED_DIV((fixed_t)frame << FIXED_SHIFT, FIXED_DEC(60,1)));
+}
+
+int main(int argc, char *argv[])
+{
+	const char *path = (argc > 1) ? argv[1] : "iso/chart/week4/milf-hard.json.cht";
+	StageHost_LoadChart(StageId_4_3, path);
+	
+	//Sum section lengths for the old walk
+	time_base = malloc(stage.num_sections * sizeof(fixed_t));
+	SectionScroll scroll;
+	fixed_t start = 0;
+	for (size_t i = 0; i < stage.num_sections; i++)
+	{
+		time_base[i] = start;
+		Stage_GetSectionScroll(&scroll, &stage.sections[i]);
+		start += scroll.length;
+	}
+	
+	int frames = (StageHost_GetEndTime() * 60) >> FIXED_SHIFT;
+	printf("%s: %u notes, %u sections, %d frames\n", path, (unsigned)stage.num_notes, (unsigned)stage.num_sections, frames);
+	
+	//Check positions
+	fixed_t max_diff = 0;
+	u32 visible = 0;
+	Note *cur = stage.notes;
+	for (int f = 0; f < frames; f++)
+	{
+		NoteBench_SetFrame(f);
+		NoteBench_WalkNew(&cur);
+		fixed_t diff = NoteBench_Compare(cur, &visible);
+		if (diff > max_diff)
+			max_diff = diff;
+	}
+	printf("%.1f notes on screen per frame, Y differs by at most %d/1024 px\n", (double)visible / frames, max_diff);
+	
+	//Time both walks
+	static const char *walk_name[2] = {"old walk", "new walk"};
+	fixed_t (*walk[2])(Note**) = {NoteBench_WalkOld, NoteBench_WalkNew};
+	volatile fixed_t sink = 0;
+	for (int i = 0; i < 2; i++)
+	{
+		double time = NoteBench_Now();
+		for (int rep = 0; rep < BENCH_REPS; rep++)
+		{
+			cur = stage.notes;
+			for (int f = 0; f < frames; f++)
+			{
+				NoteBench_SetFrame(f);
+				sink += walk[i](&cur);
+			}
+		}
+		time = NoteBench_Now() - time;
+		printf("%-15s %6.1f ns/frame\n", walk_name[i], time * 1e9 / ((double)frames * BENCH_REPS));
+	}
+	
+	//Time the whole draw loop
+	stub_draws = 0;
+	double time = NoteBench_Now();
+	for (int rep = 0; rep < BENCH_REPS; rep++)
+	{
+		for (int f = 0; f < frames; f++)
+		{
+			NoteBench_SetFrame(f);
+			Stage_DrawNotes();
+		}
+		for (Note *note = stage.notes; note->pos != 0xFFFF; note++)
+			note->type &= ~NOTE_FLAG_HIT;
+	}
+	time = NoteBench_Now() - time;
+	printf("%-15s %6.1f ns/frame, %.1f quads/frame\n", "Stage_DrawNotes", time * 1e9 / ((double)frames * BENCH_REPS), (double)stub_draws / ((double)frames * BENCH_REPS));
+	
+	//Positions should be within rounding of each other
+	if (max_diff > 1)
+	{
+		puts("FAIL: precomputed note positions differ from the old walk");
+		return 1;
+	}
+	return 0;
+}
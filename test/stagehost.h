@@ -0,0 +1,78 @@
+/*
+	Host build of src/stage.c
+	Includes the stage source directly so tests can call its static functions, link with test/stub.c.
+*/
+
+#ifndef PSXF_GUARD_TEST_STAGEHOST_H
+#define PSXF_GUARD_TEST_STAGEHOST_H
+
+#include "../src/stage.c"
+
+#include "stub.h"
+
+//Character that draws nothing, tests can hook set_anim
+static void StageHost_CharNoop(Character *this)
+{
+	(void)this;
+}
+
+static void StageHost_CharSetAnim(Character *this, u8 anim)
+{
+	(void)this;
+	(void)anim;
+}
+
+static void StageHost_InitChar(Character *this)
+{
+	memset(this, 0, sizeof(Character));
+	this->tick = StageHost_CharNoop;
+	this->set_anim = StageHost_CharSetAnim;
+	this->free = StageHost_CharNoop;
+}
+
+static Character stagehost_player, stagehost_opponent;
+
+//Load a .cht as the given stage's chart and reset the stage state like Stage_Load does
+static void StageHost_LoadChart(StageId id, const char *path)
+{
+	stub_read_path = path;
+	stage.stage_def = &stage_defs[stage.stage_id = id];
+	stage.mode = StageMode_Normal;
+	stage.note_swap = 0;
+	
+	StageHost_InitChar(&stagehost_player);
+	StageHost_InitChar(&stagehost_opponent);
+	stage.player = &stagehost_player;
+	stage.opponent = &stagehost_opponent;
+	stage.gf = NULL;
+	
+	Stage_LoadChart();
+	Stage_LoadState();
+	stage.note_scroll = 0;
+	stage.song_time = 0;
+}
+
+//Move the song to the given time and update the scroll and section like Stage_Tick does
+static void StageHost_SetTime(fixed_t song_time)
+{
+	stage.song_time = song_time;
+	while (1)
+	{
+		fixed_t next_scroll = ((fixed_t)stage.step_base << FIXED_SHIFT) + FIXED_MUL(stage.song_time - stage.time_base, stage.step_crochet);
+		if (next_scroll > stage.note_scroll)
+			stage.note_scroll = next_scroll;
+		if (stage.cur_section == &stage.sections[stage.num_sections - 1] || (stage.note_scroll >> FIXED_SHIFT) < stage.cur_section->end)
+			break;
+		Stage_SetSection(stage.cur_section + 1);
+	}
+}
+
+//Song time at the end of the last section
+static fixed_t StageHost_GetEndTime(void)
+{
+	const SectionStart *start = &stage.section_start[stage.num_sections - 1];
+	u16 length = stage.sections[stage.num_sections - 1].end - start->step;
+	return start->time + FIXED_DIV((fixed_t)length << FIXED_SHIFT, Stage_GetStepCrochet(stage.bpm_changes[start->bpm_change].bpm));
+}
+
+#endif
@@ -0,0 +1,172 @@
+/*
+	Stubs for the parts of the game host tests don't build (drawing, audio, CD and characters)
+*/
+
+#include "stub.h"
+
+#include <stdarg.h>
+
+#include "../src/main.h"
+#include "../src/stage.h"
+#include "../src/audio.h"
+#include "../src/io.h"
+#include "../src/gfx.h"
+#include "../src/font.h"
+#include "../src/loadscr.h"
+#include "../src/menu.h"
+#include "../src/pad.h"
+#include "../src/random.h"
+#include "../src/timer.h"
+#include "../src/trans.h"
+#include "../src/object/combo.h"
+#include "../src/object/splash.h"
+
+const char *stub_read_path;
+u32 stub_draws;
+s32 stub_xa_track = -1;
+u32 stub_xa_milli;
+
+//Main
+GameLoop gameloop;
+char error_msg[0x200];
+
+void ErrorLock(void)
+{
+	fprintf(stderr, "%s\n", error_msg);
+	exit(1);
+}
+
+void FntPrint(const char *format, ...)
+{
+	(void)format;
+}
+
+//Timer and pad
+u32 frame_count, animf_count;
+fixed_t timer_sec, timer_dt;
+Pad pad_state, pad_state_2;
+
+void Timer_Reset(void) {}
+
+s32 RandomRange(s32 x, s32 y)
+{
+	(void)y;
+	return x;
+}
+
+//IO
+void IO_FindFile(CdlFILE *file, const char *path)
+{
+	(void)path;
+	memset(file, 0, sizeof(CdlFILE));
+}
+
+IO_Data IO_ReadFile(CdlFILE *file)
+{
+	(void)file;
+	return IO_Read(NULL);
+}
+
+IO_Data IO_Read(const char *path)
+{
+	(void)path;
+	
+	FILE *fp = fopen(stub_read_path, "rb");
+	if (fp == NULL)
+	{
+		fprintf(stderr, "Failed to open %s\n", stub_read_path);
+		exit(1);
+	}
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	
+	IO_Data data = malloc(size + 4);
+	if (data == NULL || fread(data, 1, size, fp) != (size_t)size)
+	{
+		fprintf(stderr, "Failed to read %s\n", stub_read_path);
+		exit(1);
+	}
+	fclose(fp);
+	return data;
+}
+
+boolean IO_IsReading(void)
+{
+	return false;
+}
+
+//Audio
+void Audio_ChannelXA(u8 channel) { (void)channel; }
+void Audio_ClearAlloc(void) {}
+u32 Audio_GetLength(XA_Track lengthtrack) { (void)lengthtrack; return 120; }
+u32 Audio_LoadVAGData(u32 *sound, u32 sound_size) { (void)sound; (void)sound_size; return 0; }
+void Audio_PauseXA(void) {}
+void Audio_PlaySound(u32 addr, u8 volume) { (void)addr; (void)volume; }
+void Audio_PlayXA_Track(XA_Track track, u8 volume, u8 channel, boolean loop) { (void)volume; (void)channel; (void)loop; stub_xa_track = track; stub_xa_milli = 0; }
+boolean Audio_PlayingXA(void) { return false; }
+void Audio_ResumeXA(void) {}
+void Audio_SeekXA_Track(XA_Track track) { (void)track; }
+void Audio_SeekXA_Milli(u32 milli) { stub_xa_milli = milli; }
+void Audio_StopXA(void) {}
+s32 Audio_TellXA_Milli(void) { return 0; }
+
+//Graphics, only counts quads
+void Gfx_SetClear(u8 r, u8 g, u8 b) { (void)r; (void)g; (void)b; }
+void Gfx_ClearTPageUse(void) {}
+void Gfx_FlushTex(void) {}
+Gfx_TexFence Gfx_LoadTex(Gfx_Tex *tex, IO_Data data, Gfx_LoadTex_Flag flag) { (void)tex; (void)flag; free(data); return 0; }
+void Gfx_BlendRect(const RECT *rect, u8 r, u8 g, u8 b, u8 mode) { (void)rect; (void)r; (void)g; (void)b; (void)mode; }
+void Gfx_DrawTexCol(Gfx_Tex *tex, const RECT *src, const RECT *dst, u8 r, u8 g, u8 b) { (void)tex; (void)src; (void)dst; (void)r; (void)g; (void)b; stub_draws++; }
+void Gfx_BlendTex(Gfx_Tex *tex, const RECT *src, const RECT *dst, u8 opacity, u8 mode) { (void)tex; (void)src; (void)dst; (void)opacity; (void)mode; stub_draws++; }
+void Gfx_DrawTexArb(Gfx_Tex *tex, const RECT *src, const POINT *p0, const POINT *p1, const POINT *p2, const POINT *p3) { (void)tex; (void)src; (void)p0; (void)p1; (void)p2; (void)p3; stub_draws++; }
+void Gfx_BlendTexArb(Gfx_Tex *tex, const RECT *src, const POINT *p0, const POINT *p1, const POINT *p2, const POINT *p3, u8 mode) { (void)tex; (void)src; (void)p0; (void)p1; (void)p2; (void)p3; (void)mode; stub_draws++; }
+void FontData_Load(FontData *this, Font font) { (void)this; (void)font; }
+
+//Screens
+void LoadScr_Start(void) {}
+void LoadScr_End(void) {}
+void Menu_Load(MenuPage page) { (void)page; }
+void Trans_Start(void) {}
+boolean Trans_Tick(void) { return false; }
+
+//Objects
+void ObjectList_Tick(ObjectList *list) { (void)list; }
+void ObjectList_Free(ObjectList *list) { (void)list; }
+void ObjectPool_Init(ObjectPool *pool, size_t size, u8 cap) { (void)pool; (void)size; (void)cap; }
+void ObjectPool_Tick(ObjectPool *pool) { (void)pool; }
+void ObjectPool_Clear(ObjectPool *pool) { (void)pool; }
+void ObjectPool_Free(ObjectPool *pool) { (void)pool; }
+Obj_Combo *Obj_Combo_New(ObjectPool *pool, fixed_t x, fixed_t y, u8 hit_type, u16 combo) { (void)pool; (void)x; (void)y; (void)hit_type; (void)combo; return NULL; }
+Obj_Splash *Obj_Splash_New(ObjectPool *pool, fixed_t x, fixed_t y, u8 colour) { (void)pool; (void)x; (void)y; (void)colour; return NULL; }
+
+//Characters and backgrounds, tests make their own
+void Character_Free(Character *this) { (void)this; }
+
+#define STUB_CHAR(name) Character *name(fixed_t x, fixed_t y) { (void)x; (void)y; return NULL; }
+STUB_CHAR(Char_BF_New)
+STUB_CHAR(Char_BFWeeb_New)
+STUB_CHAR(Char_Clucky_New)
+STUB_CHAR(Char_Dad_New)
+STUB_CHAR(Char_GF_New)
+STUB_CHAR(Char_GFWeeb_New)
+STUB_CHAR(Char_Mom_New)
+STUB_CHAR(Char_Monster_New)
+STUB_CHAR(Char_MonsterX_New)
+STUB_CHAR(Char_Pico_New)
+STUB_CHAR(Char_Senpai_New)
+STUB_CHAR(Char_SenpaiM_New)
+STUB_CHAR(Char_Spirit_New)
+STUB_CHAR(Char_Spook_New)
+STUB_CHAR(Char_XmasBF_New)
+STUB_CHAR(Char_XmasGF_New)
+STUB_CHAR(Char_XmasP_New)
+
+#define STUB_BACK(name) StageBack *name(void) { return NULL; }
+STUB_BACK(Back_Dummy_New)
+STUB_BACK(Back_Week1_New)
+STUB_BACK(Back_Week2_New)
+STUB_BACK(Back_Week3_New)
+STUB_BACK(Back_Week4_New)
+STUB_BACK(Back_Week5_New)
+STUB_BACK(Back_Week6_New)
@@ -0,0 +1,21 @@
+/*
+	Stubs for the parts of the game host tests don't build (drawing, audio, CD and characters)
+	Link test/stub.c with host builds of src/stage.c.
+*/
+
+#ifndef PSXF_GUARD_TEST_STUB_H
+#define PSXF_GUARD_TEST_STUB_H
+
+#include "../src/psx.h"
+
+//File read by IO_Read and IO_ReadFile, whatever path the game asks for
+extern const char *stub_read_path;
+
+//Number of textured quads drawn
+extern u32 stub_draws;
+
+//XA track last started with Audio_PlayXA_Track (-1 if none) and position last sought with Audio_SeekXA_Milli
+extern s32 stub_xa_track;
+extern u32 stub_xa_milli;
+
+#endif
@@ -23,6 +23,15 @@ void Write32(FILE *fp, uint32_t x)
 	fputc(x >> 24, fp);
 }
 
+//FNV-1a over the 12 byte zero padded name, must match ARCHIVE_HASH in src/archive.h
+uint32_t HashName(const char name[12])
+{
+	uint32_t hash = 0x811C9DC5;
+	for (int i = 0; i < 12; i++)
+		hash = (hash ^ (uint8_t)name[i]) * 0x01000193;
+	return hash;
+}
+
 int main(int argc, char *argv[])
 {
 	//Make sure the correct parameters have been given
@@ -44,12 +53,20 @@ int main(int argc, char *argv[])
 	typedef struct
 	{
 		char name[12];
+		uint32_t hash;
 		uint32_t pos;
 		uint32_t size;
 		uint8_t *data;
 	} Pkg_Directory;
 	
-	Pkg_Directory *dir = malloc(sizeof(Pkg_Directory) * (argc - 2));
+	int files = argc - 2;
+	if (files > 0x7FFF)
+	{
+		printf("Too many files\n");
+		return 1;
+	}
+	
+	Pkg_Directory *dir = malloc(sizeof(Pkg_Directory) * files);
 	if (dir == NULL)
 	{
 		printf("Failed to allocate directory\n");
@@ -87,20 +104,7 @@ int main(int argc, char *argv[])
 		fseek(in, 0, SEEK_SET);
 		fread(dirp->data, dirp->size, 1, in);
 		fclose(in);
-	}
-	
-	//Set directory positions
-	dirp = dir;
-	dirp->pos = 16 * (argc - 2);
-	dirp++;
-	
-	for (int i = 3; i < argc; i++, dirp++)
-		dirp->pos = (dirp[-1].pos + dirp[-1].size + 0xF) & ~0xF;
-	
-	//Write directory
-	dirp = dir;
-	for (int i = 2; i < argc; i++, dirp++)
-	{
+		
 		//Cut path
 		char *path = argv[i];
 		
@@ -109,19 +113,97 @@ int main(int argc, char *argv[])
 		while (cuts != (path - 1) && *cuts != '/' && *cuts != '\\') cuts--;
 		cuts++;
 		
-		//Write directory
 		if (strlen(cuts) > 12)
-		{
 			printf("Asset %s name is longer than 12 characters and will be truncated\n", cuts);
-			fwrite(cuts, 12, 1, out);
+		strncpy(dirp->name, cuts, 12);
+		
+		//Hash name
+		dirp->hash = HashName(dirp->name);
+		if (dirp->hash == 0)
+		{
+			printf("Asset %s hashes to 0, which ends a hash list\n", cuts);
+			for (int j = 2; j <= i; j++)
+				free(dir[j - 2].data);
+			free(dir);
+			return 1;
 		}
-		else
+		for (Pkg_Directory *check = dir; check != dirp; check++)
 		{
-			fwrite(cuts, strlen(cuts), 1, out);
-			for (size_t j = strlen(cuts); j < 12; j++)
-				fputc('\0', out);
+			if (check->hash == dirp->hash)
+			{
+				printf("Asset %s has the same %s as %.12s\n", cuts, memcmp(check->name, dirp->name, 12) ? "hash" : "name", check->name);
+				for (int j = 2; j <= i; j++)
+					free(dir[j - 2].data);
+				free(dir);
+				return 1;
+			}
 		}
+	}
+	
+	//Size hash table, grow it a few times to try and get every file in one probe
+	uint32_t table_size = 2;
+	while (table_size < (uint32_t)files * 2)
+		table_size <<= 1;
+	
+	uint16_t *table = NULL;
+	for (int tries = 0; tries < 3; tries++, table_size <<= 1)
+	{
+		free(table);
+		table = calloc(table_size, sizeof(uint16_t));
+		if (table == NULL)
+		{
+			printf("Failed to allocate hash table\n");
+			for (int j = 0; j < files; j++)
+				free(dir[j].data);
+			free(dir);
+			return 1;
+		}
+		
+		int collisions = 0;
+		for (int j = 0; j < files; j++)
+		{
+			uint32_t k = dir[j].hash & (table_size - 1);
+			if (table[k] != 0)
+				collisions++;
+			while (table[k] != 0)
+				k = (k + 1) & (table_size - 1);
+			table[k] = j + 1;
+		}
+		if (collisions == 0 || table_size >= 0x8000 || tries == 2)
+			break;
+	}
+	
+	//Set directory positions
+	uint32_t header_size = 8 + table_size * 2 + files * 24;
+	
+	dirp = dir;
+	dirp->pos = (header_size + 0xF) & ~0xF;
+	dirp++;
+	
+	for (int i = 3; i < argc; i++, dirp++)
+		dirp->pos = (dirp[-1].pos + dirp[-1].size + 0xF) & ~0xF;
+	
+	//Write header
+	fputc('\0', out);
+	fputc('A', out);
+	fputc('R', out);
+	fputc('2', out);
+	Write16(out, files);
+	Write16(out, table_size - 1);
+	
+	//Write hash table
+	for (uint32_t j = 0; j < table_size; j++)
+		Write16(out, table[j]);
+	free(table);
+	
+	//Write directory
+	dirp = dir;
+	for (int i = 2; i < argc; i++, dirp++)
+	{
+		Write32(out, dirp->hash);
 		Write32(out, dirp->pos);
+		Write32(out, dirp->size);
+		fwrite(dirp->name, 12, 1, out);
 	}
 	
 	//Write file data
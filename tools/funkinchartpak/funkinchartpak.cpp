@@ -5,10 +5,22 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <iomanip>
 #include <vector>
+#include <string>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
 #include <algorithm>
 #include <unordered_set>
+#include <unordered_map>
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
 
 #include "json.hpp"
 using json = nlohmann::json;
@@ -35,11 +47,44 @@ struct Note
 	uint8_t type, pad = 0;
 };
 
+//Note with its sustain notes run-length encoded, as stored in v3 charts
+struct PackedNote
+{
+	Note note;
+	unsigned sustain; //Number of sustain notes following, 12 sub-steps apart
+};
+
+#define CHART_MAX_SUSTAINS 32 //Sustains the game can expand at once
+
 typedef int32_t fixed_t;
 
 #define FIXED_SHIFT (10)
 #define FIXED_UNIT  (1 << FIXED_SHIFT)
 
+//Same as the game's FIXED_DIV, including its 32-bit wraparound
+fixed_t FixedDiv(fixed_t x, fixed_t y)
+{
+	return (fixed_t)((uint32_t)x * FIXED_UNIT) / y;
+}
+
+//v2 charts start with CHART_MAGIC, v1 charts start with their speed
+#define CHART_MAGIC   0x54484346 //"FCHT"
+#define CHART_VERSION 3
+
+struct SectionStart
+{
+	fixed_t time; //Seconds, accumulated exactly like the game does at each section change
+	uint16_t step; //1/12 steps
+	uint16_t bpm_change; //Index into the BPM timeline
+};
+
+struct BPMChange
+{
+	fixed_t time;
+	uint16_t step;
+	uint16_t bpm; //1/24
+};
+
 uint16_t PosRound(double pos, double crochet)
 {
 	return (uint16_t)std::floor(pos / crochet + 0.5);
@@ -59,71 +104,306 @@ void WriteLong(std::ostream &out, uint32_t word)
 	out.put(word >> 24);
 }
 
-int main(int argc, char *argv[])
+//Chart contents, as read by ChartReader
+//Values are kept as json so they convert and compare exactly like they would in a full document
+struct ChartNote
 {
-	if (argc < 2)
+	json v[4]; //time, type, sustain, alt/kind
+	size_t size = 0;
+	
+	void Push(json &&value)
 	{
-		std::cout << "usage: funkinchtpak in_json" << std::endl;
-		return 0;
+		if (size < 4)
+			v[size] = std::move(value);
+		size++;
 	}
-	
-	//Read json
-	std::ifstream i(argv[1]);
+	const json &operator[](size_t k) const
+	{
+		static const json null_value;
+		return (k < size && k < 4) ? v[k] : null_value;
+	}
+};
+
+struct ChartSection
+{
+	json must_hit, change_bpm, bpm, alt_anim;
+	std::vector<ChartNote> notes;
+};
+
+struct Chart
+{
+	json bpm, speed;
+	std::vector<ChartSection> sections;
+};
+
+//Streams a json chart into a Chart without building a document
+//Anything other than song.bpm, song.speed and song.notes is skipped over
+class ChartReader : public nlohmann::json_sax<json>
+{
+	private:
+		enum Context
+		{
+			CTX_SKIP,
+			CTX_ROOT,          //{
+			CTX_SONG,          //"song": {
+			CTX_SECTIONS,      //"notes": [
+			CTX_SECTION,       //{
+			CTX_SECTION_NOTES, //"sectionNotes": [
+			CTX_NOTE,          //[
+		};
+		
+		Chart &chart;
+		std::vector<Context> stack;
+		std::string last_key;
+		
+		bool Value(json &&value)
+		{
+			if (stack.empty())
+				return true;
+			switch (stack.back())
+			{
+				case CTX_SONG:
+					if (last_key == "bpm")
+						chart.bpm = std::move(value);
+					else if (last_key == "speed")
+						chart.speed = std::move(value);
+					break;
+				case CTX_SECTION:
+				{
+					ChartSection &section = chart.sections.back();
+					if (last_key == "mustHitSection")
+						section.must_hit = std::move(value);
+					else if (last_key == "changeBPM")
+						section.change_bpm = std::move(value);
+					else if (last_key == "bpm")
+						section.bpm = std::move(value);
+					else if (last_key == "altAnim")
+						section.alt_anim = std::move(value);
+					break;
+				}
+				case CTX_NOTE:
+					chart.sections.back().notes.back().Push(std::move(value));
+					break;
+				default:
+					break;
+			}
+			return true;
+		}
+		
+	public:
+		std::string error;
+		
+		ChartReader(Chart &_chart) : chart(_chart) {}
+		
+		bool null() override { return Value(json()); }
+		bool boolean(bool val) override { return Value(json(val)); }
+		bool number_integer(number_integer_t val) override { return Value(json(val)); }
+		bool number_unsigned(number_unsigned_t val) override { return Value(json(val)); }
+		bool number_float(number_float_t val, const string_t &s) override { return Value(json(val)); }
+		bool string(string_t &val) override { return Value(json(std::move(val))); }
+		bool binary(binary_t &val) override { return Value(json()); }
+		
+		bool start_object(std::size_t elements) override
+		{
+			Context context = CTX_SKIP;
+			if (stack.empty())
+			{
+				context = CTX_ROOT;
+			}
+			else if (stack.back() == CTX_ROOT && last_key == "song")
+			{
+				context = CTX_SONG;
+			}
+			else if (stack.back() == CTX_SECTIONS)
+			{
+				chart.sections.emplace_back();
+				context = CTX_SECTION;
+			}
+			else if (stack.back() == CTX_NOTE)
+			{
+				chart.sections.back().notes.back().Push(json(json::value_t::object));
+			}
+			stack.push_back(context);
+			return true;
+		}
+		bool start_array(std::size_t elements) override
+		{
+			Context context = CTX_SKIP;
+			if (stack.empty())
+			{
+				//Top level isn't an object
+			}
+			else if (stack.back() == CTX_SONG && last_key == "notes")
+			{
+				chart.sections.clear();
+				context = CTX_SECTIONS;
+			}
+			else if (stack.back() == CTX_SECTION && last_key == "sectionNotes")
+			{
+				chart.sections.back().notes.clear();
+				context = CTX_SECTION_NOTES;
+			}
+			else if (stack.back() == CTX_SECTION_NOTES)
+			{
+				chart.sections.back().notes.emplace_back();
+				context = CTX_NOTE;
+			}
+			else if (stack.back() == CTX_NOTE)
+			{
+				chart.sections.back().notes.back().Push(json(json::value_t::array));
+			}
+			stack.push_back(context);
+			return true;
+		}
+		bool key(string_t &val) override
+		{
+			last_key = std::move(val);
+			return true;
+		}
+		bool end_object() override { stack.pop_back(); return true; }
+		bool end_array() override { stack.pop_back(); return true; }
+		
+		bool parse_error(std::size_t position, const std::string &last_token, const nlohmann::detail::exception &ex) override
+		{
+			error = ex.what();
+			return false;
+		}
+};
+
+bool ReadFile(const std::string &path, std::string &data)
+{
+	std::ifstream i(path, std::ifstream::binary);
 	if (!i.is_open())
+		return false;
+	std::ostringstream ss;
+	ss << i.rdbuf();
+	data = ss.str();
+	return true;
+}
+
+bool ReadChart(const std::string &data, Chart &chart, std::string &error)
+{
+	ChartReader reader(chart);
+	if (!json::sax_parse(data, &reader))
 	{
-		std::cout << "Failed to open " << argv[1] << std::endl;
-		return 1;
+		error = reader.error;
+		return false;
+	}
+	return true;
+}
+
+void WriteVarint(std::vector<uint8_t> &out, unsigned value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back((value & 0x7F) | 0x80);
+		value >>= 7;
 	}
-	json j;
-	i >> j;
+	out.push_back(value);
+}
+
+//Expands packed notes the same way Stage_LoadChart does
+//Sustain notes go after every note starting at their position, ties between sustains in the order their notes started
+bool ExpandNotes(const std::vector<PackedNote> &packed, std::vector<Note> &notes)
+{
+	struct Sustain
+	{
+		Note note;
+		unsigned left;
+	};
+	std::vector<Sustain> sustains;
 	
-	auto song_info = j["song"];
+	auto flush = [&](unsigned pos)
+	{
+		while (1)
+		{
+			//Find earliest sustain note before pos
+			Sustain *next = nullptr;
+			for (auto &i : sustains)
+				if (i.note.pos < pos && (next == nullptr || i.note.pos < next->note.pos))
+					next = &i;
+			if (next == nullptr)
+				return;
+			
+			Note sus_note = next->note;
+			if (--next->left != 0)
+				sus_note.type &= ~NOTE_FLAG_SUSTAIN_END;
+			notes.push_back(sus_note);
+			
+			if (next->left == 0)
+				sustains.erase(sustains.begin() + (next - sustains.data()));
+			else
+				next->note.pos += 12;
+		}
+	};
 	
-	double bpm = song_info["bpm"];
+	notes.clear();
+	for (auto &i : packed)
+	{
+		flush(i.note.pos);
+		notes.push_back(i.note);
+		if (i.sustain != 0)
+		{
+			if (sustains.size() >= CHART_MAX_SUSTAINS)
+				return false;
+			Sustain sustain;
+			sustain.note.pos = i.note.pos + 12;
+			sustain.note.type = i.note.type | NOTE_FLAG_SUSTAIN;
+			sustain.left = i.sustain;
+			sustains.push_back(sustain);
+		}
+	}
+	flush(0x10000);
+	return true;
+}
+
+bool WriteChart(const Chart &chart, const std::string &name, std::ostream &log)
+{
+	double bpm = chart.bpm;
 	double crochet = (60.0 / bpm) * 1000.0;
 	double step_crochet = crochet / 4;
 	
-	double speed = song_info["speed"];
+	double speed = chart.speed;
 	
-	std::cout << argv[1] << " speed: " << speed << " ini bpm: " << bpm << " step_crochet: " << step_crochet << std::endl;
+	log << name << " speed: " << speed << " ini bpm: " << bpm << " step_crochet: " << step_crochet << std::endl;
 	
 	double milli_base = 0;
 	uint16_t step_base = 0;
 	
 	std::vector<Section> sections;
-	std::vector<Note> notes;
+	std::vector<PackedNote> packed;
 	
 	uint16_t section_end = 0;
 	int score = 0, dups = 0;
 	std::unordered_set<uint32_t> note_fudge;
 	
-	for (auto &i : song_info["notes"]) //Iterate through sections
+	for (auto &i : chart.sections) //Iterate through sections
 	{
-		bool is_opponent = i["mustHitSection"] != true; //Note: swapped
+		bool is_opponent = i.must_hit != true; //Note: swapped
 		
 		//Read section
 		Section new_section;
-		if (i["changeBPM"] == true)
+		if (i.change_bpm == true)
 		{
 			//Update BPM (THIS IS HELL!)
 			milli_base += step_crochet * (section_end - step_base);
 			step_base = section_end;
 			
-			bpm = i["bpm"];
+			bpm = i.bpm;
 			crochet = (60.0 / bpm) * 1000.0;
 			step_crochet = crochet / 4;
 			
-			std::cout << "chg bpm: " << bpm << " step_crochet: " << step_crochet << " milli_base: " << milli_base << " step_base: " << step_base << std::endl;
+			log << "chg bpm: " << bpm << " step_crochet: " << step_crochet << " milli_base: " << milli_base << " step_base: " << step_base << std::endl;
 		}
 		new_section.end = (section_end += 16) * 12; //(uint16_t)i["lengthInSteps"]) * 12; //I had to do this for compatibility
 		new_section.flag = PosRound(bpm, 1.0 / 24.0) & SECTION_FLAG_BPM_MASK; 
-		bool is_alt = i["altAnim"] == true;
+		bool is_alt = i.alt_anim == true;
 		if (is_opponent)
 			new_section.flag |= SECTION_FLAG_OPPFOCUS;
 		sections.push_back(new_section);
 		
 		//Read notes
-		for (auto &j : i["sectionNotes"])
+		for (auto &j : i.notes)
 		{
 			//Push main note
 			Note new_note;
@@ -153,54 +433,93 @@ int main(int argc, char *argv[])
 			}
 			note_fudge.insert(*((uint32_t*)&new_note));
 				
-			notes.push_back(new_note);
+			//Sustain notes are run-length encoded
+			packed.push_back({new_note, (unsigned)(sustain + 1)});
 			if (!(new_note.type & NOTE_FLAG_OPPONENT))
 				score += 350;
-			
-			//Push sustain notes
-			for (int k = 0; k <= sustain; k++)
-			{
-				Note sus_note; //jerma
-				sus_note.pos = new_note.pos + ((k + 1) * 12);
-				sus_note.type = new_note.type | NOTE_FLAG_SUSTAIN;
-				if (k != sustain)
-					sus_note.type &= ~NOTE_FLAG_SUSTAIN_END;
-				notes.push_back(sus_note);
-			}
 		}
 	}
-	std::cout << "max score: " << score << " dups excluded: " << dups << std::endl;
+	log << "max score: " << score << " dups excluded: " << dups << std::endl;
 	
-	//Sort notes
-	std::sort(notes.begin(), notes.end(), [](Note a, Note b) {
-		if (a.pos == b.pos)
-			return (b.type & NOTE_FLAG_SUSTAIN) && !(a.type & NOTE_FLAG_SUSTAIN);
-		else
-			return a.pos < b.pos;
+	//Sort notes, then expand sustains between them
+	std::stable_sort(packed.begin(), packed.end(), [](const PackedNote &a, const PackedNote &b) {
+		return a.note.pos < b.note.pos;
 	});
 	
+	std::vector<Note> notes;
+	if (!ExpandNotes(packed, notes))
+	{
+		log << "More than " << CHART_MAX_SUSTAINS << " sustains at once" << std::endl;
+		return false;
+	}
+	
+	//Pack notes as position deltas and types, with sustain lengths after sustained notes
+	std::vector<uint8_t> note_data;
+	WriteVarint(note_data, packed.size());
+	uint16_t last_pos = 0;
+	for (auto &i : packed)
+	{
+		WriteVarint(note_data, i.note.pos - last_pos);
+		note_data.push_back(i.note.type);
+		if (i.note.type & NOTE_FLAG_SUSTAIN_END)
+			WriteVarint(note_data, i.sustain);
+		last_pos = i.note.pos;
+	}
+	if (notes.size() >= 0xFFFF)
+	{
+		log << "Too many notes" << std::endl;
+		return false;
+	}
+	
 	//Push dummy section and note
 	Section dum_section;
 	dum_section.end = 0xFFFF;
 	dum_section.flag = sections[sections.size() - 1].flag;
 	sections.push_back(dum_section);
 	
-	Note dum_note;
-	dum_note.pos = 0xFFFF;
-	dum_note.type = NOTE_FLAG_HIT;
-	notes.push_back(dum_note);
+
+	//Get section start times and BPM timeline
+	std::vector<SectionStart> starts;
+	std::vector<BPMChange> bpm_changes;
+	fixed_t start_time = 0, start_crochet = 0;
+	uint16_t start_step = 0;
+	for (size_t i = 0; i < sections.size(); i++)
+	{
+		uint16_t step = (i != 0) ? sections[i - 1].end : 0;
+		if (start_crochet)
+			start_time += FixedDiv(((fixed_t)step - start_step) << FIXED_SHIFT, start_crochet);
+		start_step = step;
+		
+		uint16_t section_bpm = sections[i].flag & SECTION_FLAG_BPM_MASK;
+		if (bpm_changes.empty() || bpm_changes.back().bpm != section_bpm)
+			bpm_changes.push_back({start_time, start_step, section_bpm});
+		starts.push_back({start_time, start_step, (uint16_t)(bpm_changes.size() - 1)});
+		start_crochet = ((fixed_t)section_bpm << FIXED_SHIFT) * 8 / 240; //15/12/24
+	}
 	
 	//Write to output
-	std::ofstream out(std::string(argv[1]) + ".cht", std::ostream::binary);
+	std::ofstream out(name + ".cht", std::ostream::binary);
 	if (!out.is_open())
 	{
-		std::cout << "Failed to open " << argv[1] << ".cht" << std::endl;
-		return 1;
+		log << "Failed to open " << name << ".cht" << std::endl;
+		return false;
 	}
 	
 	//Write header
+	uint32_t section_off = 32;
+	uint32_t start_off = section_off + sections.size() * 4;
+	uint32_t bpm_off = start_off + starts.size() * 8;
+	uint32_t note_off = bpm_off + bpm_changes.size() * 8;
+	WriteLong(out, CHART_MAGIC);
+	WriteWord(out, CHART_VERSION);
+	WriteWord(out, sections.size());
 	WriteLong(out, (fixed_t)(speed * FIXED_UNIT));
-	WriteWord(out, 6 + (sections.size() << 2));
+	WriteLong(out, section_off);
+	WriteLong(out, start_off);
+	WriteLong(out, bpm_off);
+	WriteLong(out, note_off);
+	WriteWord(out, bpm_changes.size());
+	WriteWord(out, notes.size());
 	
 	//Write sections
 	for (auto &i : sections)
@@ -209,12 +528,225 @@ int main(int argc, char *argv[])
 		WriteWord(out, i.flag);
 	}
 	
+	//Write section starts
+	for (auto &i : starts)
+	{
+		WriteLong(out, i.time);
+		WriteWord(out, i.step);
+		WriteWord(out, i.bpm_change);
+	}
+	
+	//Write BPM timeline
+	for (auto &i : bpm_changes)
+	{
+		WriteLong(out, i.time);
+		WriteWord(out, i.step);
+		WriteWord(out, i.bpm);
+	}
+	
 	//Write notes
-	for (auto &i : notes)
+	out.write((const char*)note_data.data(), note_data.size());
+	
+	size_t raw_size = (notes.size() + 1) * 4;
+	log << "notes: " << raw_size << " -> " << note_data.size() << " bytes (" << (100 - note_data.size() * 100 / raw_size) << "% smaller), chart: " << (note_off + raw_size) << " -> " << (note_off + note_data.size()) << " bytes" << std::endl;
+	return true;
+}
+
+//Batch mode
+#define CACHE_NAME    ".chtcache"
+#define CACHE_VERSION 3 //Bump whenever the .cht output changes, so cached charts are rebuilt
+
+uint64_t HashData(const std::string &data)
+{
+	//FNV-1a
+	uint64_t hash = 0xCBF29CE484222325ULL ^ CACHE_VERSION;
+	for (unsigned char c : data)
+	{
+		hash ^= c;
+		hash *= 0x100000001B3ULL;
+	}
+	return hash;
+}
+
+double GetTime()
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct BatchChart
+{
+	std::string path;
+	uint64_t hash = 0;
+	bool ok = false;
+};
+
+int Batch(const std::string &dir, unsigned threads)
+{
+	//Find every chart
+	std::vector<BatchChart> charts;
+	std::error_code ec;
+	for (auto &i : std::filesystem::recursive_directory_iterator(dir, ec))
+	{
+		if (i.is_regular_file() && i.path().extension() == ".json")
+		{
+			BatchChart chart;
+			chart.path = i.path().generic_string();
+			charts.push_back(chart);
+		}
+	}
+	if (ec)
+	{
+		std::cout << "Failed to read " << dir << std::endl;
+		return 1;
+	}
+	std::sort(charts.begin(), charts.end(), [](const BatchChart &a, const BatchChart &b) { return a.path < b.path; });
+	
+	//Read cache
+	std::string cache_path = (std::filesystem::path(dir) / CACHE_NAME).generic_string();
+	std::unordered_map<std::string, uint64_t> cache;
+	{
+		std::ifstream i(cache_path);
+		std::string line;
+		while (std::getline(i, line))
+		{
+			unsigned long long hash;
+			int n;
+			if (std::sscanf(line.c_str(), "%16llx %n", &hash, &n) == 1)
+				cache[line.substr(n)] = hash;
+		}
+	}
+	
+	//Compile across threads
+	std::atomic<size_t> next(0);
+	std::mutex print_mutex;
+	size_t done = 0, skipped = 0, failed = 0;
+	double start = GetTime();
+	
+	auto worker = [&]()
+	{
+		size_t index;
+		while ((index = next++) < charts.size())
+		{
+			BatchChart &chart = charts[index];
+			std::ostringstream log;
+			double parse_time = 0, emit_time = 0;
+			bool skip = false;
+			
+			double t0 = GetTime();
+			std::string data;
+			if (!ReadFile(chart.path, data))
+			{
+				log << "Failed to open " << chart.path << std::endl;
+			}
+			else
+			{
+				//Unchanged charts are skipped before parsing
+				chart.hash = HashData(data);
+				auto cached = cache.find(chart.path);
+				if (cached != cache.end() && cached->second == chart.hash && std::filesystem::exists(chart.path + ".cht"))
+				{
+					chart.ok = skip = true;
+				}
+				else
+				{
+					Chart read;
+					std::string error;
+					if (!ReadChart(data, read, error))
+					{
+						log << "Failed to parse " << chart.path << ": " << error << std::endl;
+					}
+					else
+					{
+						double t1 = GetTime();
+						parse_time = t1 - t0;
+						try
+						{
+							chart.ok = WriteChart(read, chart.path, log);
+						}
+						catch (const std::exception &e)
+						{
+							log << "Failed to compile " << chart.path << ": " << e.what() << std::endl;
+						}
+						emit_time = GetTime() - t1;
+					}
+				}
+			}
+			
+			std::lock_guard<std::mutex> lock(print_mutex);
+			done++;
+			if (skip)
+				skipped++;
+			else if (!chart.ok)
+				failed++;
+			std::cout << log.str() << "[" << done << "/" << charts.size() << "] " << chart.path << ": ";
+			if (skip)
+				std::cout << "unchanged" << std::endl;
+			else if (chart.ok)
+				std::cout << std::fixed << std::setprecision(2) << "parse " << parse_time << " ms, emit " << emit_time << " ms" << std::defaultfloat << std::endl;
+			else
+				std::cout << "failed" << std::endl;
+		}
+	};
+	
+	std::vector<std::thread> pool;
+	for (unsigned i = 1; i < threads; i++)
+		pool.emplace_back(worker);
+	worker();
+	for (auto &i : pool)
+		i.join();
+	
+	std::cout << "Compiled " << (done - skipped - failed) << " charts, " << skipped << " unchanged, " << failed << " failed in " << std::fixed << std::setprecision(2) << (GetTime() - start) << " ms" << std::defaultfloat << std::endl;
+	
+	//Write cache, leaving out failed charts so they're retried
+	std::ofstream out(cache_path);
+	for (auto &i : charts)
 	{
-		WriteWord(out, i.pos);
-		out.put(i.type);
-		out.put(0);
+		if (!i.ok)
+			continue;
+		char hash[17];
+		std::snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)i.hash);
+		out << hash << " " << i.path << "\n";
+	}
+	return failed != 0;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		std::cout << "usage: funkinchtpak in_json" << std::endl;
+		std::cout << "       funkinchtpak -B chart_dir [-j threads]" << std::endl;
+		return 0;
+	}
+	
+	if (std::strcmp(argv[1], "-B") == 0)
+	{
+		if (argc < 3)
+		{
+			std::cout << "No chart directory given" << std::endl;
+			return 1;
+		}
+		unsigned threads = std::thread::hardware_concurrency();
+		if (argc >= 5 && std::strcmp(argv[3], "-j") == 0)
+			threads = std::atoi(argv[4]);
+		if (threads < 1)
+			threads = 1;
+		return Batch(argv[2], threads);
+	}
+	
+	//Read json
+	std::string data;
+	if (!ReadFile(argv[1], data))
+	{
+		std::cout << "Failed to open " << argv[1] << std::endl;
+		return 1;
+	}
+	Chart chart;
+	std::string error;
+	if (!ReadChart(data, chart, error))
+	{
+		std::cout << "Failed to parse " << argv[1] << ": " << error << std::endl;
+		return 1;
 	}
-	return 0;
+	return WriteChart(chart, argv[1], std::cout) ? 0 : 1;
 }
@@ -1,34 +1,431 @@
 /*
- * funkinpicopak by Regan "CuckyDev" Green
- * Packs Friday Night Funkin' json formatted charts (PICO CHART) into a binary file for the PSX port
+ * funkinchrpak by Regan "CuckyDev" Green
+ * Trims and repacks the frames of Friday Night Funkin' character sheets for the PSX port
 */
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <string>
 #include <vector>
 #include <cstdint>
+#include <cstring>
 #include <algorithm>
-#include <unordered_set>
+#include <bitset>
+#include <unordered_map>
 
 #include "json.hpp"
 using json = nlohmann::json;
 
-void WriteWord(std::ostream &out, uint16_t word)
+#define STB_IMAGE_IMPLEMENTATION
+#include "../funkintimconv/stb_image.c"
+
+//Pages are one 256x256 texture, the most a character's texture slot holds
+#define PAGE_WIDTH 256
+#define PAGE_HEIGHT 256
+
+//Sheet and frame types
+struct Sheet
+{
+	std::string path;
+	std::string param; //Contents of its .png.txt
+	int width, height;
+	std::vector<uint8_t> data; //RGBA8888
+	int bpp;
+};
+
+struct Frame
+{
+	int sheet;
+	int src[4]; //Rect in the sheet after trimming
+	int off[2];
+	std::vector<uint16_t> reps; //RGB555 with the top bit set if opaque, 0 if transparent
+	
+	//Packed position
+	int page, x, y;
+	int same; //Frame with identical contents, or -1
+};
+
+//Packing
+struct SkylineNode
+{
+	int x, y, w;
+};
+
+struct Page
+{
+	std::vector<SkylineNode> skyline = {{0, 0, PAGE_WIDTH}};
+	std::bitset<0x8000> colour;
+	bool has_trans = false;
+	int colours = 0;
+	int used_w = 0, used_h = 0;
+};
+
+static uint16_t PixelRep(const uint8_t *px)
+{
+	//Same conversion funkintimconv does
+	if (!(px[3] & 0x80))
+		return 0;
+	return (px[0] >> 3) | ((px[1] >> 3) << 5) | ((px[2] >> 3) << 10) | 0x8000;
+}
+
+static int Page_NewColours(const Page &page, const Frame &frame, int max_colour)
+{
+	//Count colours the frame would add to the page, -1 if they don't fit
+	std::bitset<0x8000> added;
+	bool has_trans = page.has_trans;
+	int colours = page.colours;
+	for (uint16_t rep : frame.reps)
+	{
+		if (!(rep & 0x8000))
+		{
+			if (!has_trans)
+			{
+				has_trans = true;
+				colours++;
+			}
+		}
+		else if (!page.colour[rep & 0x7FFF] && !added[rep & 0x7FFF])
+		{
+			added[rep & 0x7FFF] = true;
+			colours++;
+		}
+		if (colours > max_colour)
+			return -1;
+	}
+	return colours - page.colours;
+}
+
+static void Page_AddColours(Page &page, const Frame &frame)
+{
+	for (uint16_t rep : frame.reps)
+	{
+		if (!(rep & 0x8000))
+		{
+			if (!page.has_trans)
+			{
+				page.has_trans = true;
+				page.colours++;
+			}
+		}
+		else if (!page.colour[rep & 0x7FFF])
+		{
+			page.colour[rep & 0x7FFF] = true;
+			page.colours++;
+		}
+	}
+}
+
+static bool Page_FindPosition(const Page &page, int w, int h, int &best_i, int &best_x, int &best_y)
+{
+	//Bottom left placement on the skyline, lowest top edge first
+	int best_top = INT32_MAX;
+	best_i = -1;
+	for (size_t i = 0; i < page.skyline.size(); i++)
+	{
+		int x = page.skyline[i].x;
+		if (x + w > PAGE_WIDTH)
+			break;
+		
+		//Rest on the highest node under the frame
+		int y = 0;
+		for (size_t j = i; j < page.skyline.size() && page.skyline[j].x < x + w; j++)
+			y = std::max(y, page.skyline[j].y);
+		if (y + h > PAGE_HEIGHT)
+			continue;
+		
+		if (y + h < best_top)
+		{
+			best_top = y + h;
+			best_i = (int)i;
+			best_x = x;
+			best_y = y;
+		}
+	}
+	return best_i >= 0;
+}
+
+static void Page_Place(Page &page, int i, int x, int y, int w, int h)
+{
+	//Insert new node, then cut the ones it covers
+	page.skyline.insert(page.skyline.begin() + i, {x, y + h, w});
+	for (size_t j = i + 1; j < page.skyline.size();)
+	{
+		SkylineNode &node = page.skyline[j];
+		int cover = x + w - node.x;
+		if (cover <= 0)
+			break;
+		if (cover < node.w)
+		{
+			node.x += cover;
+			node.w -= cover;
+			break;
+		}
+		page.skyline.erase(page.skyline.begin() + j);
+	}
+	
+	//Merge nodes of the same height
+	for (size_t j = 0; j + 1 < page.skyline.size();)
+	{
+		if (page.skyline[j].y == page.skyline[j + 1].y)
+		{
+			page.skyline[j].w += page.skyline[j + 1].w;
+			page.skyline.erase(page.skyline.begin() + j + 1);
+		}
+		else
+		{
+			j++;
+		}
+	}
+	
+	page.used_w = std::max(page.used_w, x + w);
+	page.used_h = std::max(page.used_h, y + h);
+}
+
+//Packing candidates
+enum PackSort
+{
+	PackSort_Height,
+	PackSort_Area,
+	PackSort_Width,
+	PackSort_Max,
+};
+
+struct Packing
+{
+	std::vector<Page> pages;
+	std::vector<int> page, x, y; //Per frame
+	long bytes = 0;
+};
+
+static long Page_Bytes(const Page &page, int bpp)
+{
+	return (long)std::max((page.used_w + 3) & ~3, 4) * std::max(page.used_h, 1) * bpp / 8;
+}
+
+static void PackSheets(Packing &packing, const std::vector<Frame> &frames, size_t sheets, int bpp)
+{
+	//Each sheet keeps its layout, cropped to its frames
+	std::vector<int> sheet_page(sheets, -1), min_x(sheets, PAGE_WIDTH), min_y(sheets, PAGE_HEIGHT);
+	for (const Frame &frame : frames)
+	{
+		if (frame.same >= 0)
+			continue;
+		min_x[frame.sheet] = std::min(min_x[frame.sheet], frame.src[0]);
+		min_y[frame.sheet] = std::min(min_y[frame.sheet], frame.src[1]);
+	}
+	
+	packing.page.assign(frames.size(), -1);
+	packing.x.assign(frames.size(), 0);
+	packing.y.assign(frames.size(), 0);
+	for (size_t k = 0; k < frames.size(); k++)
+	{
+		const Frame &frame = frames[k];
+		if (frame.same >= 0)
+			continue;
+		if (sheet_page[frame.sheet] < 0)
+		{
+			sheet_page[frame.sheet] = (int)packing.pages.size();
+			packing.pages.emplace_back();
+		}
+		Page &page = packing.pages[sheet_page[frame.sheet]];
+		packing.page[k] = sheet_page[frame.sheet];
+		packing.x[k] = frame.src[0] - min_x[frame.sheet];
+		packing.y[k] = frame.src[1] - min_y[frame.sheet];
+		page.used_w = std::max(page.used_w, packing.x[k] + frame.src[2]);
+		page.used_h = std::max(page.used_h, packing.y[k] + frame.src[3]);
+	}
+	for (const Page &page : packing.pages)
+		packing.bytes += Page_Bytes(page, bpp);
+}
+
+static bool PackFrames(Packing &packing, const std::vector<Frame> &frames, PackSort sort, bool colour_fit, int max_colour, int bpp)
+{
+	//Place biggest frames first
+	std::vector<int> order;
+	for (size_t k = 0; k < frames.size(); k++)
+		if (frames[k].same < 0)
+			order.push_back((int)k);
+	std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+		int key_a, key_b;
+		switch (sort)
+		{
+			case PackSort_Area:
+				key_a = frames[a].src[2] * frames[a].src[3];
+				key_b = frames[b].src[2] * frames[b].src[3];
+				break;
+			case PackSort_Width:
+				key_a = frames[a].src[2];
+				key_b = frames[b].src[2];
+				break;
+			default:
+				key_a = frames[a].src[3];
+				key_b = frames[b].src[3];
+				break;
+		}
+		return key_a > key_b;
+	});
+	
+	packing.page.assign(frames.size(), -1);
+	packing.x.assign(frames.size(), 0);
+	packing.y.assign(frames.size(), 0);
+	for (int k : order)
+	{
+		//Either the first page with room, or the one needing the fewest new colours so frames sharing a palette stay together
+		const Frame &frame = frames[k];
+		int best_page = -1, best_new = INT32_MAX, best_node = 0, best_x = 0, best_y = 0;
+		for (size_t p = 0; p <= packing.pages.size(); p++)
+		{
+			if (p == packing.pages.size())
+			{
+				if (best_page >= 0)
+					break;
+				packing.pages.emplace_back();
+			}
+			int node, x, y;
+			int new_colours = Page_NewColours(packing.pages[p], frame, max_colour);
+			if (new_colours < 0 || !Page_FindPosition(packing.pages[p], frame.src[2], frame.src[3], node, x, y))
+			{
+				if (p + 1 == packing.pages.size() && packing.pages[p].colours == 0)
+					return false; //More colours than a page can have
+				continue;
+			}
+			if (best_page < 0 || (colour_fit && new_colours < best_new))
+			{
+				best_page = (int)p;
+				best_new = new_colours;
+				best_node = node;
+				best_x = x;
+				best_y = y;
+				if (!colour_fit)
+					break;
+			}
+		}
+		
+		Page &page = packing.pages[best_page];
+		Page_Place(page, best_node, best_x, best_y, frame.src[2], frame.src[3]);
+		Page_AddColours(page, frame);
+		packing.page[k] = best_page;
+		packing.x[k] = best_x;
+		packing.y[k] = best_y;
+	}
+	
+	for (const Page &page : packing.pages)
+		packing.bytes += Page_Bytes(page, bpp);
+	return true;
+}
+
+//PNG writing, stored deflate so no compressor is needed
+static uint32_t crc_table[0x100];
+
+static void PNG_InitCRC()
+{
+	for (uint32_t i = 0; i < 0x100; i++)
+	{
+		uint32_t c = i;
+		for (int j = 0; j < 8; j++)
+			c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+		crc_table[i] = c;
+	}
+}
+
+static void PNG_WriteLong(std::ostream &out, uint32_t v)
+{
+	out.put(v >> 24);
+	out.put(v >> 16);
+	out.put(v >> 8);
+	out.put(v >> 0);
+}
+
+static void PNG_WriteChunk(std::ostream &out, const char *type, const std::vector<uint8_t> &data)
 {
-	out.put(word >> 0);
-	out.put(word >> 8);
+	PNG_WriteLong(out, data.size());
+	uint32_t crc = 0xFFFFFFFF;
+	for (int i = 0; i < 4; i++)
+		crc = crc_table[(crc ^ type[i]) & 0xFF] ^ (crc >> 8);
+	for (uint8_t v : data)
+		crc = crc_table[(crc ^ v) & 0xFF] ^ (crc >> 8);
+	out.write(type, 4);
+	out.write((const char*)data.data(), data.size());
+	PNG_WriteLong(out, crc ^ 0xFFFFFFFF);
+}
+
+static bool PNG_Write(const std::string &path, const uint8_t *rgba, int width, int height)
+{
+	std::ofstream out(path, std::ios::binary);
+	if (!out.is_open())
+		return false;
+	
+	static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+	out.write((const char*)signature, sizeof(signature));
+	
+	//Header, 8-bit RGBA
+	std::vector<uint8_t> ihdr = {
+		(uint8_t)(width >> 24), (uint8_t)(width >> 16), (uint8_t)(width >> 8), (uint8_t)width,
+		(uint8_t)(height >> 24), (uint8_t)(height >> 16), (uint8_t)(height >> 8), (uint8_t)height,
+		8, 6, 0, 0, 0
+	};
+	PNG_WriteChunk(out, "IHDR", ihdr);
+	
+	//Unfiltered rows
+	std::vector<uint8_t> raw;
+	raw.reserve((size_t)(width * 4 + 1) * height);
+	for (int y = 0; y < height; y++)
+	{
+		raw.push_back(0);
+		raw.insert(raw.end(), rgba + (size_t)y * width * 4, rgba + (size_t)(y + 1) * width * 4);
+	}
+	
+	std::vector<uint8_t> idat = {0x78, 0x01};
+	uint32_t a = 1, b = 0;
+	for (size_t i = 0; i < raw.size(); i++)
+	{
+		a = (a + raw[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+	for (size_t i = 0; i < raw.size() || i == 0; i += 0xFFFF)
+	{
+		size_t len = std::min<size_t>(raw.size() - i, 0xFFFF);
+		idat.push_back((i + len >= raw.size()) ? 1 : 0);
+		idat.push_back(len);
+		idat.push_back(len >> 8);
+		idat.push_back(~len);
+		idat.push_back(~len >> 8);
+		idat.insert(idat.end(), raw.begin() + i, raw.begin() + i + len);
+	}
+	uint32_t adler = (b << 16) | a;
+	idat.push_back(adler >> 24);
+	idat.push_back(adler >> 16);
+	idat.push_back(adler >> 8);
+	idat.push_back(adler >> 0);
+	PNG_WriteChunk(out, "IDAT", idat);
+	PNG_WriteChunk(out, "IEND", {});
+	
+	return out.good();
 }
 
 int main(int argc, char *argv[])
 {
 	if (argc < 3)
 	{
-		std::cout << "usage: funkinchrpak in_tim out_chr" << std::endl;
+		std::cout << "usage: funkinchrpak out.chr.h in.chr.json" << std::endl;
 		return 0;
 	}
 	
+	std::string out_path = argv[1];
+	std::string json_path = argv[2];
+	std::string json_dir = json_path.substr(0, json_path.find_last_of("/\\") + 1);
+	std::string out_dir = out_path.substr(0, out_path.find_last_of("/\\") + 1);
+	std::string out_name = out_path.substr(out_dir.size());
+	out_name = out_name.substr(0, out_name.find('.'));
+	
+	//Character name for the table is the folder the json is in
+	std::string char_name = json_dir.substr(0, json_dir.size() - 1);
+	char_name = char_name.substr(char_name.find_last_of("/\\") + 1);
+	if (char_name.empty())
+		char_name = out_name;
+	
 	//Read json
-	std::string json_path = std::string(argv[2]) + ".json";
 	std::ifstream i(json_path);
 	if (!i.is_open())
 	{
@@ -38,5 +435,210 @@ int main(int argc, char *argv[])
 	json j;
 	i >> j;
 	
+	//Read sheets, referenced as their converted .tim
+	std::vector<Sheet> sheets;
+	for (auto &i : j["path"])
+	{
+		Sheet sheet;
+		std::string name = i;
+		if (name.size() > 4 && name.compare(name.size() - 4, 4, ".tim") == 0)
+			name = name.substr(0, name.size() - 4) + ".png";
+		sheet.path = json_dir + name;
+		
+		std::ifstream param_file(sheet.path + ".txt");
+		if (!std::getline(param_file, sheet.param))
+		{
+			std::cout << "Failed to read parameters from " << sheet.path << ".txt" << std::endl;
+			return 1;
+		}
+		std::istringstream param(sheet.param);
+		int tex_x, tex_y, pal_x, pal_y;
+		if (!(param >> tex_x >> tex_y >> pal_x >> pal_y >> sheet.bpp) || (sheet.bpp != 4 && sheet.bpp != 8))
+		{
+			std::cout << "Sheet " << sheet.path << " needs a bpp of 4 or 8" << std::endl;
+			return 1;
+		}
+		
+		stbi_uc *data = stbi_load(sheet.path.c_str(), &sheet.width, &sheet.height, NULL, 4);
+		if (data == NULL)
+		{
+			std::cout << "Failed to read texture data from " << sheet.path << std::endl;
+			return 1;
+		}
+		sheet.data.assign(data, data + (size_t)sheet.width * sheet.height * 4);
+		stbi_image_free(data);
+		
+		if (!sheets.empty() && sheet.param != sheets[0].param)
+			std::cout << "Warning: " << sheet.path << " has different parameters to " << sheets[0].path << ", using " << sheets[0].path << "'s" << std::endl;
+		sheets.push_back(sheet);
+	}
+	if (sheets.empty())
+	{
+		std::cout << json_path << " has no sheets" << std::endl;
+		return 1;
+	}
+	int max_colour = (sheets[0].bpp == 4) ? 16 : 256;
+	
+	//Read frames and trim them to their opaque pixels
+	std::vector<Frame> frames;
+	long area_before = 0, area_after = 0;
+	for (auto &i : j["frame"])
+	{
+		Frame frame;
+		frame.sheet = i["tim"];
+		int sx = i["src"]["x"], sy = i["src"]["y"], sw = i["src"]["w"], sh = i["src"]["h"];
+		frame.off[0] = i["offset"]["x"];
+		frame.off[1] = i["offset"]["y"];
+		if (frame.sheet < 0 || frame.sheet >= (int)sheets.size())
+		{
+			std::cout << "Frame " << frames.size() << " uses sheet " << frame.sheet << " which doesn't exist" << std::endl;
+			return 1;
+		}
+		const Sheet &sheet = sheets[frame.sheet];
+		if (sx < 0 || sy < 0 || sw < 0 || sh < 0 || sx >= sheet.width || sy >= sheet.height)
+		{
+			std::cout << "Frame " << frames.size() << " is outside of " << sheet.path << std::endl;
+			return 1;
+		}
+		area_before += sw * sh;
+		
+		//Rects may hang off the edge of the sheet, which is just transparent
+		sw = std::min(sw, sheet.width - sx);
+		sh = std::min(sh, sheet.height - sy);
+		
+		int x0 = sx + sw, y0 = sy + sh, x1 = sx, y1 = sy;
+		for (int y = sy; y < sy + sh; y++)
+		{
+			for (int x = sx; x < sx + sw; x++)
+			{
+				if (PixelRep(&sheet.data[((size_t)y * sheet.width + x) * 4]) & 0x8000)
+				{
+					x0 = std::min(x0, x);
+					y0 = std::min(y0, y);
+					x1 = std::max(x1, x + 1);
+					y1 = std::max(y1, y + 1);
+				}
+			}
+		}
+		if (x0 >= x1 || y0 >= y1)
+			x0 = x1 = sx, y0 = y1 = sy;
+		
+		frame.src[0] = x0;
+		frame.src[1] = y0;
+		frame.src[2] = x1 - x0;
+		frame.src[3] = y1 - y0;
+		frame.off[0] -= x0 - sx;
+		frame.off[1] -= y0 - sy;
+		for (int y = y0; y < y1; y++)
+			for (int x = x0; x < x1; x++)
+				frame.reps.push_back(PixelRep(&sheet.data[((size_t)y * sheet.width + x) * 4]));
+		
+		//Frames that look the same share their pixels
+		frame.same = -1;
+		for (size_t k = 0; k < frames.size(); k++)
+		{
+			if (frames[k].same < 0 && frames[k].src[2] == frame.src[2] && frames[k].src[3] == frame.src[3] && frames[k].reps == frame.reps)
+			{
+				frame.same = (int)k;
+				break;
+			}
+		}
+		if (frame.same < 0)
+			area_after += frame.src[2] * frame.src[3];
+		frames.push_back(frame);
+	}
+	
+	//Try a few packing orders, along with keeping the sheets' own layout, and use whichever needs the fewest pages
+	for (size_t k = 0; k < frames.size(); k++)
+	{
+		if (frames[k].src[2] > PAGE_WIDTH || frames[k].src[3] > PAGE_HEIGHT)
+		{
+			std::cout << "Frame " << k << " is bigger than a page" << std::endl;
+			return 1;
+		}
+	}
+	
+	Packing packing;
+	PackSheets(packing, frames, sheets.size(), sheets[0].bpp);
+	for (int sort = 0; sort < PackSort_Max; sort++)
+	{
+		for (int colour_fit = 0; colour_fit < 2; colour_fit++)
+		{
+			Packing candidate;
+			if (PackFrames(candidate, frames, (PackSort)sort, colour_fit, max_colour, sheets[0].bpp) &&
+			    (candidate.pages.size() < packing.pages.size() || (candidate.pages.size() == packing.pages.size() && candidate.bytes < packing.bytes)))
+				packing = candidate;
+		}
+	}
+	std::vector<Page> &pages = packing.pages;
+	for (size_t k = 0; k < frames.size(); k++)
+	{
+		int from = (frames[k].same >= 0) ? frames[k].same : (int)k;
+		frames[k].page = packing.page[from];
+		frames[k].x = packing.x[from];
+		frames[k].y = packing.y[from];
+	}
+	
+	//Write pages, cropped to what's used
+	PNG_InitCRC();
+	long page_bytes = 0, sheet_bytes = 0;
+	for (const Sheet &sheet : sheets)
+		sheet_bytes += (long)sheet.width * sheet.height * sheet.bpp / 8;
+	for (size_t p = 0; p < pages.size(); p++)
+	{
+		Page &page = pages[p];
+		int width = std::max((page.used_w + 3) & ~3, 4);
+		int height = std::max(page.used_h, 1);
+		std::vector<uint8_t> rgba((size_t)width * height * 4, 0);
+		for (const Frame &frame : frames)
+		{
+			if (frame.page != (int)p || frame.same >= 0)
+				continue;
+			const Sheet &sheet = sheets[frame.sheet];
+			for (int y = 0; y < frame.src[3]; y++)
+			{
+				const uint8_t *src = &sheet.data[((size_t)(frame.src[1] + y) * sheet.width + frame.src[0]) * 4];
+				uint8_t *dst = &rgba[((size_t)(frame.y + y) * width + frame.x) * 4];
+				for (int x = 0; x < frame.src[2]; x++, src += 4, dst += 4)
+					if (src[3] & 0x80)
+						memcpy(dst, src, 4);
+			}
+		}
+		
+		std::string page_path = out_dir + out_name + "p" + std::to_string(p) + ".png";
+		if (!PNG_Write(page_path, rgba.data(), width, height))
+		{
+			std::cout << "Failed to write " << page_path << std::endl;
+			return 1;
+		}
+		std::ofstream param(page_path + ".txt");
+		param << sheets[0].param << std::endl;
+		page_bytes += (long)width * height * sheets[0].bpp / 8;
+	}
+	
+	//Write frame table
+	std::ofstream out(out_path);
+	if (!out.is_open())
+	{
+		std::cout << "Failed to open " << out_path << std::endl;
+		return 1;
+	}
+	out << "//Generated by funkinchrpak from " << json_path << ", " << sheets.size() << " sheets packed into " << pages.size() << " pages" << std::endl;
+	out << "//Pages:";
+	for (size_t p = 0; p < pages.size(); p++)
+		out << " " << out_name << "p" << p << ".tim";
+	out << std::endl;
+	out << "static const CharFrame char_" << char_name << "_frame[] = {" << std::endl;
+	for (size_t k = 0; k < frames.size(); k++)
+	{
+		const Frame &frame = frames[k];
+		char line[96];
+		sprintf(line, "\t{%d, {%3d, %3d, %3d, %3d}, {%3d, %3d}}, //%d", frame.page, frame.x, frame.y, frame.src[2], frame.src[3], frame.off[0], frame.off[1], (int)k);
+		out << line << std::endl;
+	}
+	out << "};" << std::endl;
+	
+	std::cout << json_path << ": " << frames.size() << " frames, " << sheets.size() << " sheets -> " << pages.size() << " pages, "
+	          << area_before << " -> " << area_after << " pixels, " << sheet_bytes << " -> " << page_bytes << " texture bytes" << std::endl;
 	return 0;
 }
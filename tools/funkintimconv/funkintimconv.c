@@ -9,6 +9,16 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <math.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.c"
@@ -25,23 +35,413 @@ typedef union
 	uint16_t v;
 } RGBI;
 
-int main(int argc, char *argv[])
+//Converts RGBA8888 pixels to the RGBI values used for the palette, 0 for transparent pixels
+static void ConvertPixels(const uint8_t *src, uint16_t *dst, size_t pixels)
 {
-	//Read parameters
-	if (argc < 3)
+	size_t i = 0;
+	
+#if defined(__SSE2__)
+	//8 pixels at a time
+	const __m128i mask5 = _mm_set1_epi32(0x1F);
+	const __m128i stp = _mm_set1_epi32(0x8000);
+	for (; i + 8 <= pixels; i += 8)
 	{
-		printf("usage: funkintimconv out.tim in.png\n");
-		return 0;
+		__m128i v[2];
+		for (int j = 0; j < 2; j++)
+		{
+			__m128i p = _mm_loadu_si128((const __m128i*)(src + (i + j * 4) * 4));
+			__m128i r = _mm_and_si128(_mm_srli_epi32(p, 3), mask5);
+			__m128i g = _mm_and_si128(_mm_srli_epi32(p, 11), mask5);
+			__m128i b = _mm_and_si128(_mm_srli_epi32(p, 19), mask5);
+			__m128i rgbi = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 5)), _mm_or_si128(_mm_slli_epi32(b, 10), stp));
+			__m128i opaque = _mm_srai_epi32(p, 31); //Alpha's top bit
+			
+			//Sign extend so the signed pack below keeps all 16 bits
+			v[j] = _mm_srai_epi32(_mm_slli_epi32(_mm_and_si128(rgbi, opaque), 16), 16);
+		}
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(v[0], v[1]));
+	}
+#endif
+	
+	for (; i < pixels; i++)
+	{
+		//Get palette representation
+		const uint8_t *px = src + i * 4;
+		RGBI rep;
+		if (px[3] & 0x80)
+		{
+			//Opaque
+			rep.c.r = px[0] / 8;
+			rep.c.g = px[1] / 8;
+			rep.c.b = px[2] / 8;
+			rep.c.i = 1;
+		}
+		else
+		{
+			//Transparent
+			rep.v = 0;
+		}
+		dst[i] = rep.v;
+	}
+}
+
+//Colour quantisation, used when an image has more colours than its bpp allows
+#define AUTO_PSNR_DEFAULT 36.0 //auto bpp uses 4bpp when quantising to 16 colours stays above this many dB
+#define QUANT_KMEANS_PASSES 4
+#define DITHER_SPREAD 8 //RGB555 steps covered by the ordered dither pattern
+
+static double auto_psnr = AUTO_PSNR_DEFAULT;
+
+static const uint8_t dither_bayer[4][4] = {
+	{ 0,  8,  2, 10},
+	{12,  4, 14,  6},
+	{ 3, 11,  1,  9},
+	{15,  7, 13,  5},
+};
+
+typedef struct
+{
+	uint16_t colour; //RGB555
+	uint32_t count;
+} QuantColour;
+
+typedef struct
+{
+	int start, end; //Range of colours
+	double error; //Weighted squared error along axis
+	int axis;
+} QuantBox;
+
+static int Quant_Channel(uint16_t colour, int axis)
+{
+	return (colour >> (axis * 5)) & 0x1F;
+}
+
+static int Quant_Distance(uint16_t a, uint16_t b)
+{
+	int dist = 0;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		int d = Quant_Channel(a, axis) - Quant_Channel(b, axis);
+		dist += d * d;
+	}
+	return dist;
+}
+
+static void Quant_MeasureBox(QuantBox *box, const QuantColour *colours)
+{
+	//Find the channel with the most spread
+	box->error = 0.0;
+	box->axis = 0;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		double sum = 0.0, sum2 = 0.0, n = 0.0;
+		for (int i = box->start; i < box->end; i++)
+		{
+			double v = Quant_Channel(colours[i].colour, axis);
+			sum += v * colours[i].count;
+			sum2 += v * v * colours[i].count;
+			n += colours[i].count;
+		}
+		double error = sum2 - sum * sum / n;
+		if (error > box->error)
+		{
+			box->error = error;
+			box->axis = axis;
+		}
+	}
+}
+
+static void Quant_SplitBox(QuantBox *box, QuantBox *new_box, QuantColour *colours, QuantColour *temp)
+{
+	//Sort the box's colours along its axis
+	int bucket[33] = {0};
+	for (int i = box->start; i < box->end; i++)
+		bucket[Quant_Channel(colours[i].colour, box->axis) + 1]++;
+	for (int i = 1; i < 33; i++)
+		bucket[i] += bucket[i - 1];
+	for (int i = box->start; i < box->end; i++)
+		temp[bucket[Quant_Channel(colours[i].colour, box->axis)]++] = colours[i];
+	memcpy(colours + box->start, temp, (box->end - box->start) * sizeof(QuantColour));
+	
+	//Split at the weighted median
+	uint64_t total = 0, half = 0;
+	for (int i = box->start; i < box->end; i++)
+		total += colours[i].count;
+	int split = box->start + 1;
+	for (int i = box->start; i < box->end - 1; i++)
+	{
+		half += colours[i].count;
+		split = i + 1;
+		if (half * 2 >= total)
+			break;
+	}
+	
+	new_box->start = split;
+	new_box->end = box->end;
+	box->end = split;
+	Quant_MeasureBox(box, colours);
+	Quant_MeasureBox(new_box, colours);
+}
+
+//Maps pixels to their nearest entry of a palette with colours entries, returns the PSNR of opaque pixels
+static double MapColours(const uint16_t *reps, int width, int height, const RGBI *pal, int colours, bool dither, uint8_t *indices)
+{
+	size_t pixels = (size_t)width * height;
+	uint16_t *nearest = malloc(0x8000 * sizeof(uint16_t));
+	if (nearest == NULL)
+		return -1.0;
+	
+	//Transparency has its own entry
+	int pal_trans = 0;
+	for (int j = 0; j < colours; j++)
+	{
+		if (!(pal[j].v & 0x8000))
+		{
+			pal_trans = j;
+			break;
+		}
+	}
+	
+	memset(nearest, 0xFF, 0x8000 * sizeof(uint16_t));
+	double error = 0.0;
+	size_t opaque = 0;
+	for (size_t i = 0; i < pixels; i++)
+	{
+		uint16_t rep = reps[i];
+		if (!(rep & 0x8000))
+		{
+			indices[i] = pal_trans;
+			continue;
+		}
+		
+		//Offset the colour by the ordered dither pattern
+		uint16_t colour = rep & 0x7FFF;
+		if (dither)
+		{
+			int offset = ((2 * dither_bayer[(i / width) & 3][(i % width) & 3] - 15) * DITHER_SPREAD) / 32;
+			colour = 0;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				int v = Quant_Channel(rep, axis) + offset;
+				if (v < 0)
+					v = 0;
+				if (v > 0x1F)
+					v = 0x1F;
+				colour |= v << (axis * 5);
+			}
+		}
+		
+		if (nearest[colour] == 0xFFFF)
+		{
+			int best = 0, best_dist = INT32_MAX;
+			for (int j = 0; j < colours; j++)
+			{
+				if (!(pal[j].v & 0x8000))
+					continue;
+				int dist = Quant_Distance(colour, pal[j].v & 0x7FFF);
+				if (dist < best_dist)
+				{
+					best_dist = dist;
+					best = j;
+				}
+			}
+			nearest[colour] = best;
+		}
+		indices[i] = nearest[colour];
+		
+		//Error against the unquantised colour, in 8-bit units
+		error += Quant_Distance(rep & 0x7FFF, pal[nearest[colour]].v & 0x7FFF) * 64.0;
+		opaque++;
 	}
+	free(nearest);
+	
+	if (error == 0.0)
+		return INFINITY;
+	return 10.0 * log10(255.0 * 255.0 * opaque * 3 / error);
+}
+
+//Quantises to max_colour colours with median cut refined by k-means, returns the PSNR of opaque pixels
+static double QuantiseColours(const uint16_t *reps, int width, int height, RGBI *pal, uint8_t *indices, int max_colour, bool dither, int *colours_out)
+{
+	size_t pixels = (size_t)width * height;
 	
-	const char *outpath = argv[1];
-	const char *inpath = argv[2];
+	//Get colour histogram
+	uint32_t *hist = calloc(0x8000, sizeof(uint32_t));
+	QuantColour *colours = malloc(0x8000 * sizeof(QuantColour));
+	QuantColour *temp = malloc(0x8000 * sizeof(QuantColour));
+	if (hist == NULL || colours == NULL || temp == NULL)
+	{
+		free(hist);
+		free(colours);
+		free(temp);
+		return -1.0;
+	}
+	
+	bool has_trans = false;
+	for (size_t i = 0; i < pixels; i++)
+	{
+		if (reps[i] & 0x8000)
+			hist[reps[i] & 0x7FFF]++;
+		else
+			has_trans = true;
+	}
+	int colours_len = 0;
+	for (int i = 0; i < 0x8000; i++)
+	{
+		if (hist[i] != 0)
+		{
+			colours[colours_len].colour = i;
+			colours[colours_len].count = hist[i];
+			colours_len++;
+		}
+	}
+	
+	//Transparency takes the first entry
+	int pal_base = has_trans ? 1 : 0;
+	int max_boxes = max_colour - pal_base;
+	
+	//Split the box with the most error until there are enough
+	QuantBox boxes[256];
+	int boxes_len = 0;
+	if (colours_len != 0)
+	{
+		boxes[0].start = 0;
+		boxes[0].end = colours_len;
+		Quant_MeasureBox(&boxes[0], colours);
+		boxes_len = 1;
+	}
+	while (boxes_len < max_boxes)
+	{
+		int split = -1;
+		for (int i = 0; i < boxes_len; i++)
+			if (boxes[i].end - boxes[i].start > 1 && boxes[i].error > 0.0 && (split < 0 || boxes[i].error > boxes[split].error))
+				split = i;
+		if (split < 0)
+			break;
+		Quant_SplitBox(&boxes[split], &boxes[boxes_len++], colours, temp);
+	}
+	
+	//Start from the box means, then move each entry to the mean of the colours nearest it
+	uint16_t centre[256];
+	for (int i = 0; i < boxes_len; i++)
+	{
+		double sum[3] = {0.0, 0.0, 0.0}, n = 0.0;
+		for (int j = boxes[i].start; j < boxes[i].end; j++)
+		{
+			for (int axis = 0; axis < 3; axis++)
+				sum[axis] += (double)Quant_Channel(colours[j].colour, axis) * colours[j].count;
+			n += colours[j].count;
+		}
+		centre[i] = 0;
+		for (int axis = 0; axis < 3; axis++)
+			centre[i] |= (uint16_t)(sum[axis] / n + 0.5) << (axis * 5);
+	}
+	
+	for (int pass = 0; pass < QUANT_KMEANS_PASSES; pass++)
+	{
+		double sum[256][3], n[256];
+		memset(sum, 0, sizeof(sum));
+		memset(n, 0, sizeof(n));
+		for (int j = 0; j < colours_len; j++)
+		{
+			int best = 0, best_dist = INT32_MAX;
+			for (int i = 0; i < boxes_len; i++)
+			{
+				int dist = Quant_Distance(colours[j].colour, centre[i]);
+				if (dist < best_dist)
+				{
+					best_dist = dist;
+					best = i;
+				}
+			}
+			for (int axis = 0; axis < 3; axis++)
+				sum[best][axis] += (double)Quant_Channel(colours[j].colour, axis) * colours[j].count;
+			n[best] += colours[j].count;
+		}
+		for (int i = 0; i < boxes_len; i++)
+		{
+			if (n[i] == 0.0)
+				continue;
+			centre[i] = 0;
+			for (int axis = 0; axis < 3; axis++)
+				centre[i] |= (uint16_t)(sum[i][axis] / n[i] + 0.5) << (axis * 5);
+		}
+	}
+	
+	//Write palette
+	memset(pal, 0, sizeof(RGBI) * 256);
+	for (int i = 0; i < boxes_len; i++)
+		pal[pal_base + i].v = centre[i] | 0x8000;
+	*colours_out = pal_base + boxes_len;
+	
+	free(hist);
+	free(colours);
+	free(temp);
+	
+	return MapColours(reps, width, height, pal, *colours_out, dither, indices);
+}
+
+//Indexes colours in the order they're first seen, returns -1 if there are more than max_colour
+static int IndexColours(const uint16_t *reps, size_t pixels, RGBI *pal, uint8_t *indices, int max_colour)
+{
+	//Palette indices of opaque colours by their RGB555 value, transparency has its own
+	uint16_t pal_lut[0x8000];
+	int pal_trans = -1;
+	int pals_i = 0;
+	memset(pal_lut, 0xFF, sizeof(pal_lut));
+	memset(pal, 0, sizeof(RGBI) * 256);
 	
+	for (size_t i = 0; i < pixels; i++)
+	{
+		uint16_t rep = reps[i];
+		int pal_i = (rep & 0x8000) ? pal_lut[rep & 0x7FFF] : pal_trans;
+		if (pal_i < 0 || pal_i == 0xFFFF)
+		{
+			if (pals_i >= max_colour)
+				return -1;
+			pal_i = pals_i++;
+			pal[pal_i].v = rep;
+			if (rep & 0x8000)
+				pal_lut[rep & 0x7FFF] = pal_i;
+			else
+				pal_trans = pal_i;
+		}
+		indices[i] = pal_i;
+	}
+	return pals_i;
+}
+
+//Gets a palette of up to max_colour colours, quantising if needed, returns the PSNR (infinite if exact) or a negative value on error
+static double GetPalette(const uint16_t *reps, int width, int height, RGBI *pal, uint8_t *indices, int max_colour, bool dither, int *colours)
+{
+	if ((*colours = IndexColours(reps, (size_t)width * height, pal, indices, max_colour)) >= 0)
+		return INFINITY;
+	return QuantiseColours(reps, width, height, pal, indices, max_colour, dither, colours);
+}
+
+static bool EndsWith(const char *str, const char *end)
+{
+	size_t str_len = strlen(str), end_len = strlen(end);
+	return str_len >= end_len && strcmp(str + str_len - end_len, end) == 0;
+}
+
+//Parameters read from a .png.txt
+typedef struct
+{
+	int tex_x, tex_y, pal_x, pal_y;
+	char bpp_str[16];
+	bool dither;
+	char bank[16]; //Palette bank the image shares, empty if it has its own palette
+} TimParam;
+
+static bool ReadParam(TimParam *param, const char *inpath)
+{
 	char *txtpath = malloc(strlen(inpath) + 5);
 	if (txtpath == NULL)
 	{
 		printf("Failed to allocate txt path\n");
-		return 1;
+		return false;
 	}
 	sprintf(txtpath, "%s.txt", inpath);
 	
@@ -51,157 +451,325 @@ int main(int argc, char *argv[])
 	if (txtfp == NULL)
 	{
 		printf("Failed to open %s.txt\n", inpath);
-		return 1;
+		return false;
 	}
 	
-	int tex_x, tex_y, pal_x, pal_y, bpp;
-	int txtread = fscanf(txtfp, "%d %d %d %d %d", &tex_x, &tex_y, &pal_x, &pal_y, &bpp);
+	char option[24];
+	param->dither = false;
+	param->bank[0] = '\0';
+	int txtread = fscanf(txtfp, "%d %d %d %d %15s", &param->tex_x, &param->tex_y, &param->pal_x, &param->pal_y, param->bpp_str);
+	while (txtread == 5 && fscanf(txtfp, "%23s", option) == 1)
+	{
+		if (strcmp(option, "dither") == 0)
+		{
+			param->dither = true;
+		}
+		else if (strncmp(option, "bank=", 5) == 0 && option[5] != '\0' && strlen(option + 5) < sizeof(param->bank))
+		{
+			strcpy(param->bank, option + 5);
+		}
+		else
+		{
+			printf("Unknown option %s in %s.txt\n", option, inpath);
+			fclose(txtfp);
+			return false;
+		}
+	}
 	fclose(txtfp);
 	
 	if (txtread != 5)
 	{
 		printf("Failed to read parameters from %s.txt\n", inpath);
-		return 1;
+		return false;
 	}
-	
-	//Validate parameters
-	int max_colour, width_shift;
-	switch (bpp)
-	{
-		case 4:
-			max_colour = 16;
-			width_shift = 2;
-			break;
-		case 8:
-			max_colour = 256;
-			width_shift = 1;
-			break;
-		default:
-			printf("Invalid bpp %d\n", bpp);
-			return 1;
-	}
-	
-	//Read image contents
-	int tex_width, tex_height;
-	stbi_uc *tex_data = stbi_load(inpath, &tex_width, &tex_height, NULL, 4);
+	return true;
+}
+
+//Reads an image as RGBI values, returns NULL on failure
+static uint16_t *ReadImage(const char *inpath, int *width, int *height)
+{
+	stbi_uc *tex_data = stbi_load(inpath, width, height, NULL, 4);
 	if (tex_data == NULL)
 	{
 		printf("Failed to read texture data from %s\n", inpath);
-		return 1;
+		return NULL;
 	}
 	
-	if (tex_width & ((1 << width_shift) - 1))
+	size_t pixels = (size_t)*width * *height;
+	uint16_t *reps = malloc(pixels * sizeof(uint16_t));
+	if (reps == NULL)
+		printf("Failed to allocate texture buffer\n");
+	else
+		ConvertPixels(tex_data, reps, pixels);
+	stbi_image_free(tex_data);
+	return reps;
+}
+
+//Palette banks, every image in a directory with bank=name in its .png.txt shares one palette,
+//which is written to name.tim in that directory so it only has to be uploaded once
+typedef struct
+{
+	int tex_x, tex_y, pal_x, pal_y, bpp;
+	RGBI pal[256];
+	int colours, members;
+	double psnr;
+} Bank;
+
+static int Bank_Compare(const void *a, const void *b)
+{
+	return strcmp(*(const char**)a, *(const char**)b);
+}
+
+//Finds the images in dir with bank=name, sorted so every image of the bank gets the same palette
+static char **Bank_FindMembers(const char *dir, const char *name, int *members)
+{
+	DIR *dirp = opendir(dir);
+	if (dirp == NULL)
 	{
-		printf("Width %d can't properly be represented with bpp of %d\n", tex_width, bpp);
-		stbi_image_free(tex_data);
-		return 1;
+		printf("Failed to open %s\n", dir);
+		return NULL;
 	}
 	
-	//Convert image
-	RGBI pal[256];
-	int pals_i = 0;
-	memset(pal, 0, sizeof(pal));
+	char **paths = NULL;
+	int paths_len = 0;
+	bool ok = true;
+	struct dirent *ent;
+	while (ok && (ent = readdir(dirp)) != NULL)
+	{
+		if (!EndsWith(ent->d_name, ".png"))
+			continue;
+		char **new_paths = realloc(paths, (paths_len + 1) * sizeof(char*));
+		if (new_paths == NULL)
+		{
+			ok = false;
+			break;
+		}
+		paths = new_paths;
+		char *path = malloc(strlen(dir) + strlen(ent->d_name) + 6);
+		if (path == NULL)
+		{
+			ok = false;
+			break;
+		}
+		sprintf(path, "%s/%s.txt", dir, ent->d_name);
+		bool has_txt = access(path, F_OK) == 0;
+		path[strlen(path) - 4] = '\0';
+		
+		TimParam param;
+		if (has_txt && ReadParam(&param, path) && strcmp(param.bank, name) == 0)
+			paths[paths_len++] = path;
+		else
+			free(path);
+	}
+	closedir(dirp);
 	
-	size_t tex_size = ((tex_width << 1) >> width_shift) * tex_height;
-	uint8_t *tex = malloc(tex_size);
-	if (tex == NULL)
+	if (ok && paths_len == 0)
 	{
-		printf("Failed to allocate texture buffer\n");
-		stbi_image_free(tex_data);
-		return 1;
+		printf("No images in %s use bank %s\n", dir, name);
+		ok = false;
 	}
+	if (!ok)
+	{
+		for (int i = 0; i < paths_len; i++)
+			free(paths[i]);
+		free(paths);
+		return NULL;
+	}
+	qsort(paths, paths_len, sizeof(char*), Bank_Compare);
+	*members = paths_len;
+	return paths;
+}
+
+static bool GetBank(Bank *bank, const char *dir, const char *name)
+{
+	int paths_len;
+	char **paths = Bank_FindMembers(dir, name, &paths_len);
+	if (paths == NULL)
+		return false;
+	bool ok = true;
 	
-	stbi_uc *tex_datap = tex_data;
-	uint8_t *texp = tex;
-	for (int i = tex_width * tex_height; i > 0; i--, tex_datap += 4)
+	//Gather every member's pixels, they must agree on the palette's position and size
+	uint16_t *reps = NULL;
+	size_t pixels = 0;
+	for (int i = 0; ok && i < paths_len; i++)
 	{
-		//Get palette representation
-		RGBI rep;
-		if (tex_datap[3] & 0x80)
+		TimParam param;
+		if (!ReadParam(&param, paths[i]))
 		{
-			//Opaque
-			rep.c.r = tex_datap[0] / 8;
-			rep.c.g = tex_datap[1] / 8;
-			rep.c.b = tex_datap[2] / 8;
-			rep.c.i = 1;
+			ok = false;
+			break;
 		}
-		else
+		int bpp = atoi(param.bpp_str);
+		if (i == 0)
 		{
-			//Transparent
-			rep.c.r = 0;
-			rep.c.g = 0;
-			rep.c.b = 0;
-			rep.c.i = 0;
+			bank->tex_x = param.tex_x;
+			bank->tex_y = param.tex_y;
+			bank->pal_x = param.pal_x;
+			bank->pal_y = param.pal_y;
+			bank->bpp = bpp;
 		}
-		
-		//Get palette index
-		int pal_i = 0;
-		while (1)
+		if (bpp != 4 && bpp != 8)
 		{
-			if (pal_i >= max_colour)
-			{
-				printf("Image has more than %d colours\n", max_colour);
-				free(tex);
-				stbi_image_free(tex_data);
-				return 1;
-			}
-			if (pal_i >= pals_i)
-			{
-				pal[pal_i].v = rep.v;
-				pals_i++;
-				break;
-			}
-			if (pal[pal_i].v == rep.v)
-				break;
-			pal_i++;
+			printf("%s needs a bpp of 4 or 8 to use bank %s\n", paths[i], name);
+			ok = false;
+			break;
+		}
+		if (bpp != bank->bpp || param.pal_x != bank->pal_x || param.pal_y != bank->pal_y)
+		{
+			printf("%s doesn't have the same palette position and bpp as %s\n", paths[i], paths[0]);
+			ok = false;
+			break;
 		}
 		
-		//Write pixel
-		switch (bpp)
+		int width, height;
+		uint16_t *member = ReadImage(paths[i], &width, &height);
+		uint16_t *new_reps = (member != NULL) ? realloc(reps, (pixels + (size_t)width * height) * sizeof(uint16_t)) : NULL;
+		if (new_reps == NULL)
 		{
-			case 4:
-				if (i & 1)
-					*texp++ = *texp | (pal_i << 4);
-				else
-					*texp = pal_i;
-				break;
-			case 8:
-				*texp++ = pal_i;
-				break;
+			free(member);
+			ok = false;
+			break;
 		}
+		reps = new_reps;
+		memcpy(reps + pixels, member, (size_t)width * height * sizeof(uint16_t));
+		pixels += (size_t)width * height;
+		free(member);
 	}
-	stbi_image_free(tex_data);
+	bank->members = paths_len;
+	for (int i = 0; i < paths_len; i++)
+		free(paths[i]);
+	free(paths);
 	
-	//Write output
-	FILE *outfp = fopen(outpath, "wb");
-	if (outfp == NULL)
+	//Use every colour if they fit, otherwise quantise them together
+	uint8_t *indices = ok ? malloc(pixels) : NULL;
+	if (ok && indices == NULL)
 	{
-		printf("Failed to open %s\n", outpath);
-		free(tex);
-		return 1;
+		printf("Failed to allocate bank buffer\n");
+		ok = false;
+	}
+	if (ok)
+	{
+		int max_colour = (bank->bpp == 4) ? 16 : 256;
+		if ((bank->colours = IndexColours(reps, pixels, bank->pal, indices, max_colour)) >= 0)
+			bank->psnr = INFINITY;
+		else
+			bank->psnr = QuantiseColours(reps, (int)pixels, 1, bank->pal, indices, max_colour, false, &bank->colours);
+		if (bank->psnr < 0.0)
+		{
+			printf("Failed to quantise bank %s\n", name);
+			ok = false;
+		}
+	}
+	free(reps);
+	free(indices);
+	return ok;
+}
+
+//Banks built so far, keyed by directory and name, so each one is only built once per run
+typedef struct BankCache
+{
+	struct BankCache *next;
+	char *dir;
+	char name[16];
+	pthread_mutex_t lock; //Held while the bank is being built
+	bool built, ok;
+	Bank bank;
+} BankCache;
+
+static BankCache *bank_cache;
+static pthread_mutex_t bank_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+//Gets bank name in dir, building it the first time it's asked for, NULL if it failed
+static const Bank *Bank_Get(const char *dir, const char *name)
+{
+	pthread_mutex_lock(&bank_cache_lock);
+	BankCache *entry;
+	for (entry = bank_cache; entry != NULL; entry = entry->next)
+		if (strcmp(entry->dir, dir) == 0 && strcmp(entry->name, name) == 0)
+			break;
+	if (entry == NULL && (entry = malloc(sizeof(BankCache))) != NULL)
+	{
+		if ((entry->dir = strdup(dir)) != NULL)
+		{
+			snprintf(entry->name, sizeof(entry->name), "%s", name);
+			pthread_mutex_init(&entry->lock, NULL);
+			entry->built = false;
+			entry->ok = false;
+			entry->next = bank_cache;
+			bank_cache = entry;
+		}
+		else
+		{
+			free(entry);
+			entry = NULL;
+		}
+	}
+	pthread_mutex_unlock(&bank_cache_lock);
+	if (entry == NULL)
+	{
+		printf("Failed to allocate bank %s\n", name);
+		return NULL;
 	}
 	
-	//Header
+	//Other members of the bank wait here while the first one builds it
+	pthread_mutex_lock(&entry->lock);
+	if (!entry->built)
+	{
+		entry->ok = GetBank(&entry->bank, dir, name);
+		entry->built = true;
+	}
+	pthread_mutex_unlock(&entry->lock);
+	return entry->ok ? &entry->bank : NULL;
+}
+
+static void Bank_FreeCache(void)
+{
+	while (bank_cache != NULL)
+	{
+		BankCache *next = bank_cache->next;
+		pthread_mutex_destroy(&bank_cache->lock);
+		free(bank_cache->dir);
+		free(bank_cache);
+		bank_cache = next;
+	}
+}
+
+//Gets the directory of path, "." if there's none
+static char *GetDir(const char *path)
+{
+	const char *slash = strrchr(path, '/');
+	size_t len = (slash != NULL) ? (size_t)(slash - path) : 0;
+	char *dir = malloc(len + 2);
+	if (dir == NULL)
+		return NULL;
+	if (slash != NULL)
+	{
+		memcpy(dir, path, len);
+		dir[len] = '\0';
+	}
+	else
+	{
+		strcpy(dir, ".");
+	}
+	return dir;
+}
+
+//Writes the TIM header and, if pal isn't NULL, its CLUT
+static void WriteTimHeader(FILE *outfp, int bpp, const RGBI *pal, int pal_x, int pal_y)
+{
 	fputc(0x10, outfp);
 	fputc(0, outfp);
 	fputc(0, outfp);
 	fputc(0, outfp);
-	switch (bpp)
-	{
-		case 4:
-			fputc(0x08, outfp);
-			break;
-		case 8:
-			fputc(0x09, outfp);
-			break;
-	}
+	fputc(((bpp == 4) ? 0x00 : 0x01) | ((pal != NULL) ? 0x08 : 0x00), outfp);
 	fputc(0, outfp);
 	fputc(0, outfp);
 	fputc(0, outfp);
+	if (pal == NULL)
+		return;
 	
-	//CLUT
-	pals_i = max_colour;
-	uint32_t clut_length = 12 + 2 * pals_i;
+	int max_colour = (bpp == 4) ? 16 : 256;
+	uint32_t clut_length = 12 + 2 * max_colour;
 	fputc(clut_length, outfp);
 	fputc(clut_length >> 8, outfp);
 	fputc(clut_length >> 16, outfp);
@@ -210,11 +778,212 @@ int main(int argc, char *argv[])
 	fputc(pal_x >> 8, outfp);
 	fputc(pal_y, outfp);
 	fputc(pal_y >> 8, outfp);
-	fputc(pals_i, outfp);
-	fputc(pals_i >> 8, outfp);
+	fputc(max_colour, outfp);
+	fputc(max_colour >> 8, outfp);
+	fputc(1, outfp);
+	fputc(0, outfp);
+	fwrite(pal, max_colour, 2, outfp);
+}
+
+//Bank name is the file name of its palette without .tim
+static void GetBankName(char *name, size_t size, const char *outpath)
+{
+	const char *slash = strrchr(outpath, '/');
+	snprintf(name, size, "%s", (slash != NULL) ? (slash + 1) : outpath);
+	if (EndsWith(name, ".tim"))
+		name[strlen(name) - 4] = '\0';
+}
+
+//Writes bank name's palette to outpath, with the name taken from outpath
+static bool ConvertBank(const char *outpath)
+{
+	char *dir = GetDir(outpath);
+	if (dir == NULL)
+	{
+		printf("Failed to allocate bank path\n");
+		return false;
+	}
+	char name[16];
+	GetBankName(name, sizeof(name), outpath);
+	
+	const Bank *bank = Bank_Get(dir, name);
+	free(dir);
+	if (bank == NULL)
+		return false;
+	
+	printf("%s: %d images share %d colours", outpath, bank->members, bank->colours);
+	if (bank->psnr != INFINITY)
+		printf(", quantised to PSNR %.2f dB", bank->psnr);
+	printf(", %d bytes of palettes saved\n", (bank->members - 1) * ((bank->bpp == 4) ? 32 : 512));
+	
+	FILE *outfp = fopen(outpath, "wb");
+	if (outfp == NULL)
+	{
+		printf("Failed to open %s\n", outpath);
+		return false;
+	}
+	WriteTimHeader(outfp, bank->bpp, bank->pal, bank->pal_x, bank->pal_y);
+	
+	//A single blank halfword of texture, it's loaded with GFX_LOADTEX_NOTEX so only the palette gets uploaded
+	uint32_t tex_length = 12 + 2;
+	fputc(tex_length, outfp);
+	fputc(tex_length >> 8, outfp);
+	fputc(tex_length >> 16, outfp);
+	fputc(tex_length >> 24, outfp);
+	fputc(bank->tex_x, outfp);
+	fputc(bank->tex_x >> 8, outfp);
+	fputc(bank->tex_y, outfp);
+	fputc(bank->tex_y >> 8, outfp);
+	fputc(1, outfp);
+	fputc(0, outfp);
 	fputc(1, outfp);
 	fputc(0, outfp);
-	fwrite(pal, pals_i, 2, outfp);
+	fputc(0, outfp);
+	fputc(0, outfp);
+	
+	fclose(outfp);
+	return true;
+}
+
+//Converts inpath to a TIM at outpath, using the parameters in inpath.txt
+static bool ConvertTim(const char *outpath, const char *inpath)
+{
+	TimParam param;
+	if (!ReadParam(&param, inpath))
+		return false;
+	int tex_x = param.tex_x, tex_y = param.tex_y, pal_x = param.pal_x, pal_y = param.pal_y;
+	bool dither = param.dither;
+	const char *bpp_str = param.bpp_str;
+	
+	//Validate parameters, auto picks between 4 and 8
+	bool auto_bpp = strcmp(bpp_str, "auto") == 0;
+	int bpp = auto_bpp ? 8 : atoi(bpp_str);
+	if (bpp != 4 && bpp != 8)
+	{
+		printf("Invalid bpp %s\n", bpp_str);
+		return false;
+	}
+	
+	if (auto_bpp && param.bank[0] != '\0')
+	{
+		printf("%s needs a bpp of 4 or 8 to use bank %s\n", inpath, param.bank);
+		return false;
+	}
+	
+	//Read image contents
+	int tex_width, tex_height;
+	uint16_t *reps = ReadImage(inpath, &tex_width, &tex_height);
+	if (reps == NULL)
+		return false;
+	
+	size_t pixels = (size_t)tex_width * tex_height;
+	uint8_t *indices = malloc(pixels);
+	if (indices == NULL)
+	{
+		printf("Failed to allocate texture buffer\n");
+		free(reps);
+		return false;
+	}
+	
+	//Get palette, auto uses 4bpp if 16 colours are enough or quantising to them is close enough
+	RGBI pal[256];
+	int colours;
+	double psnr = -1.0, psnr_4bpp = -1.0;
+	if (param.bank[0] != '\0')
+	{
+		//Banked images map to the bank's palette and don't get one of their own
+		char *dir = GetDir(inpath);
+		const Bank *bank = (dir != NULL) ? Bank_Get(dir, param.bank) : NULL;
+		free(dir);
+		if (bank == NULL)
+		{
+			free(reps);
+			free(indices);
+			return false;
+		}
+		colours = bank->colours;
+		psnr = MapColours(reps, tex_width, tex_height, bank->pal, bank->colours, dither && bank->psnr != INFINITY, indices);
+	}
+	else if (auto_bpp && !(tex_width & 3) && (psnr = psnr_4bpp = GetPalette(reps, tex_width, tex_height, pal, indices, 16, dither, &colours)) >= auto_psnr)
+	{
+		bpp = 4;
+	}
+	else
+	{
+		psnr = GetPalette(reps, tex_width, tex_height, pal, indices, (bpp == 4) ? 16 : 256, dither, &colours);
+	}
+	free(reps);
+	
+	if (psnr < 0.0)
+	{
+		printf("Failed to quantise %s\n", inpath);
+		free(indices);
+		return false;
+	}
+	
+	int width_shift = (bpp == 4) ? 2 : 1;
+	if (tex_width & ((1 << width_shift) - 1))
+	{
+		printf("Width %d can't properly be represented with bpp of %d\n", tex_width, bpp);
+		free(indices);
+		return false;
+	}
+	
+	//Report anything that wasn't converted as is
+	if (auto_bpp || psnr != INFINITY)
+	{
+		printf("%s: %dbpp, %d colours", inpath, bpp, colours);
+		if (param.bank[0] != '\0')
+			printf(" in bank %s", param.bank);
+		if (psnr != INFINITY)
+			printf(", quantised to PSNR %.2f dB", psnr);
+		if (bpp == 4)
+			printf(", %d bytes smaller than 8bpp", (int)(pixels / 2 + 2 * (256 - 16)));
+		else if (auto_bpp && (tex_width & 3))
+			printf(", width can't be 4bpp");
+		else if (auto_bpp)
+			printf(", 4bpp PSNR %.2f dB is under %.2f dB", psnr_4bpp, auto_psnr);
+		printf("\n");
+	}
+	
+	//Write pixels
+	size_t tex_size = ((tex_width << 1) >> width_shift) * tex_height;
+	uint8_t *tex = malloc(tex_size);
+	if (tex == NULL)
+	{
+		printf("Failed to allocate texture buffer\n");
+		free(indices);
+		return false;
+	}
+	uint8_t *texp = tex;
+	for (size_t i = 0; i < pixels; i++)
+	{
+		switch (bpp)
+		{
+			case 4:
+				if (i & 1)
+					*texp++ |= indices[i] << 4;
+				else
+					*texp = indices[i];
+				break;
+			case 8:
+				*texp++ = indices[i];
+				break;
+		}
+	}
+	free(indices);
+	
+	//Write output
+	FILE *outfp = fopen(outpath, "wb");
+	if (outfp == NULL)
+	{
+		printf("Failed to open %s\n", outpath);
+		free(tex);
+		return false;
+	}
+	
+	//Header and CLUT, banked images leave the CLUT out
+	WriteTimHeader(outfp, bpp, (param.bank[0] != '\0') ? NULL : pal, pal_x, pal_y);
 	
 	//Texture
 	uint32_t tex_length = 12 + (((tex_width << 1) >> width_shift) * tex_height);
@@ -235,5 +1004,305 @@ int main(int argc, char *argv[])
 	
 	fclose(outfp);
 	
-	return 0;
+	return true;
+}
+
+//Batch mode
+typedef struct
+{
+	char *inpath, *outpath; //inpath is NULL for a bank's palette
+	bool ok;
+} BatchJob;
+
+typedef struct
+{
+	BatchJob *jobs;
+	int jobs_len, jobs_size;
+	int next, done, failed;
+	pthread_mutex_t lock;
+} Batch;
+
+static double GetTime(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static bool Batch_Add(Batch *batch, const char *inpath)
+{
+	if (batch->jobs_len >= batch->jobs_size)
+	{
+		batch->jobs_size = batch->jobs_size ? (batch->jobs_size * 2) : 64;
+		BatchJob *jobs = realloc(batch->jobs, batch->jobs_size * sizeof(BatchJob));
+		if (jobs == NULL)
+			return false;
+		batch->jobs = jobs;
+	}
+	
+	//Output is the input with .png replaced by .tim
+	BatchJob *job = &batch->jobs[batch->jobs_len++];
+	size_t len = strlen(inpath);
+	job->inpath = strdup(inpath);
+	job->outpath = malloc(len + 5);
+	if (job->inpath == NULL || job->outpath == NULL)
+		return false;
+	strcpy(job->outpath, inpath);
+	if (EndsWith(inpath, ".png"))
+		job->outpath[len - 4] = '\0';
+	strcat(job->outpath, ".tim");
+	job->ok = false;
+	return true;
+}
+
+//Adds the palette of the bank inpath uses, once per bank
+static bool Batch_AddBank(Batch *batch, const char *inpath)
+{
+	TimParam param;
+	if (!ReadParam(&param, inpath))
+		return false;
+	if (param.bank[0] == '\0')
+		return true;
+	
+	char *dir = GetDir(inpath);
+	char *outpath = (dir != NULL) ? malloc(strlen(dir) + strlen(param.bank) + 6) : NULL;
+	if (outpath == NULL)
+	{
+		free(dir);
+		return false;
+	}
+	sprintf(outpath, "%s/%s.tim", dir, param.bank);
+	free(dir);
+	
+	for (int i = 0; i < batch->jobs_len; i++)
+	{
+		if (batch->jobs[i].inpath == NULL && strcmp(batch->jobs[i].outpath, outpath) == 0)
+		{
+			free(outpath);
+			return true;
+		}
+	}
+	
+	if (batch->jobs_len >= batch->jobs_size)
+	{
+		batch->jobs_size = batch->jobs_size ? (batch->jobs_size * 2) : 64;
+		BatchJob *jobs = realloc(batch->jobs, batch->jobs_size * sizeof(BatchJob));
+		if (jobs == NULL)
+		{
+			free(outpath);
+			return false;
+		}
+		batch->jobs = jobs;
+	}
+	BatchJob *job = &batch->jobs[batch->jobs_len++];
+	job->inpath = NULL;
+	job->outpath = outpath;
+	job->ok = false;
+	return true;
+}
+
+//Adds every .png with a .png.txt under path
+static bool Batch_AddDir(Batch *batch, const char *path)
+{
+	DIR *dir = opendir(path);
+	if (dir == NULL)
+	{
+		printf("Failed to open %s\n", path);
+		return false;
+	}
+	
+	bool ok = true;
+	struct dirent *ent;
+	while (ok && (ent = readdir(dir)) != NULL)
+	{
+		if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
+			continue;
+		
+		char *subpath = malloc(strlen(path) + strlen(ent->d_name) + 6);
+		if (subpath == NULL)
+		{
+			ok = false;
+			break;
+		}
+		sprintf(subpath, "%s/%s", path, ent->d_name);
+		
+		struct stat st;
+		if (stat(subpath, &st) == 0)
+		{
+			if (S_ISDIR(st.st_mode))
+			{
+				ok = Batch_AddDir(batch, subpath);
+			}
+			else if (EndsWith(subpath, ".png"))
+			{
+				size_t len = strlen(subpath);
+				strcat(subpath, ".txt");
+				bool has_txt = access(subpath, F_OK) == 0;
+				subpath[len] = '\0';
+				if (has_txt)
+					ok = Batch_Add(batch, subpath) && Batch_AddBank(batch, subpath);
+			}
+		}
+		free(subpath);
+	}
+	closedir(dir);
+	return ok;
+}
+
+static void *Batch_Worker(void *arg)
+{
+	Batch *batch = (Batch*)arg;
+	while (1)
+	{
+		pthread_mutex_lock(&batch->lock);
+		int i = batch->next++;
+		pthread_mutex_unlock(&batch->lock);
+		if (i >= batch->jobs_len)
+			break;
+		
+		BatchJob *job = &batch->jobs[i];
+		double start = GetTime();
+		job->ok = (job->inpath != NULL) ? ConvertTim(job->outpath, job->inpath) : ConvertBank(job->outpath);
+		double time = GetTime() - start;
+		
+		pthread_mutex_lock(&batch->lock);
+		batch->done++;
+		if (!job->ok)
+			batch->failed++;
+		printf("[%d/%d] %s: %s %.2f ms\n", batch->done, batch->jobs_len, (job->inpath != NULL) ? job->inpath : job->outpath, job->ok ? "converted in" : "failed after", time * 1000.0);
+		pthread_mutex_unlock(&batch->lock);
+	}
+	return NULL;
+}
+
+//Runs every job added to batch, then frees it
+static int Batch_Finish(Batch *batch, int threads)
+{
+	if (threads > batch->jobs_len)
+		threads = batch->jobs_len;
+	if (threads < 1)
+		threads = 1;
+	
+	double start = GetTime();
+	pthread_t *pool = malloc(threads * sizeof(pthread_t));
+	if (pool == NULL)
+		return 1;
+	for (int i = 1; i < threads; i++)
+		pthread_create(&pool[i], NULL, Batch_Worker, batch);
+	Batch_Worker(batch);
+	for (int i = 1; i < threads; i++)
+		pthread_join(pool[i], NULL);
+	free(pool);
+	
+	printf("Converted %d images, %d failed in %.2f ms on %d threads\n", batch->done - batch->failed, batch->failed, (GetTime() - start) * 1000.0, threads);
+	
+	for (int i = 0; i < batch->jobs_len; i++)
+	{
+		free(batch->jobs[i].inpath);
+		free(batch->jobs[i].outpath);
+	}
+	free(batch->jobs);
+	pthread_mutex_destroy(&batch->lock);
+	Bank_FreeCache();
+	return batch->failed != 0;
+}
+
+//Converts every path given, directories are searched for .png files with a .png.txt
+static int Batch_Run(char **paths, int paths_len, int threads)
+{
+	Batch batch;
+	memset(&batch, 0, sizeof(batch));
+	pthread_mutex_init(&batch.lock, NULL);
+	
+	for (int i = 0; i < paths_len; i++)
+	{
+		struct stat st;
+		bool ok;
+		if (stat(paths[i], &st) == 0 && S_ISDIR(st.st_mode))
+			ok = Batch_AddDir(&batch, paths[i]);
+		else
+			ok = Batch_Add(&batch, paths[i]);
+		if (!ok)
+			return 1;
+	}
+	return Batch_Finish(&batch, threads);
+}
+
+//Writes a bank's palette to outpath and converts every image in it, so the bank is only built once
+static int Batch_RunBank(const char *outpath, int threads)
+{
+	Batch batch;
+	memset(&batch, 0, sizeof(batch));
+	pthread_mutex_init(&batch.lock, NULL);
+	
+	char *dir = GetDir(outpath);
+	char name[16];
+	GetBankName(name, sizeof(name), outpath);
+	int members;
+	char **paths = (dir != NULL) ? Bank_FindMembers(dir, name, &members) : NULL;
+	free(dir);
+	if (paths == NULL)
+		return 1;
+	
+	batch.jobs_size = members + 1;
+	if ((batch.jobs = malloc(batch.jobs_size * sizeof(BatchJob))) == NULL || (batch.jobs[0].outpath = strdup(outpath)) == NULL)
+		return 1;
+	batch.jobs[0].inpath = NULL;
+	batch.jobs[0].ok = false;
+	batch.jobs_len = 1;
+	
+	bool ok = true;
+	for (int i = 0; i < members; i++)
+	{
+		if (ok)
+			ok = Batch_Add(&batch, paths[i]);
+		free(paths[i]);
+	}
+	free(paths);
+	if (!ok)
+		return 1;
+	return Batch_Finish(&batch, threads);
+}
+
+int main(int argc, char *argv[])
+{
+	//Read parameters
+	int arg = 1;
+	if (argc >= 3 && strcmp(argv[1], "-q") == 0)
+	{
+		auto_psnr = atof(argv[2]);
+		arg = 3;
+	}
+	
+	bool bank = false;
+	if (argc >= arg + 1 && (strcmp(argv[arg], "-B") == 0 || (bank = strcmp(argv[arg], "-P") == 0)))
+	{
+		int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+		arg++;
+		if (argc >= arg + 2 && strcmp(argv[arg], "-j") == 0)
+		{
+			threads = atoi(argv[arg + 1]);
+			arg += 2;
+		}
+		if (arg >= argc)
+		{
+			printf(bank ? "No bank given\n" : "No images given\n");
+			return 1;
+		}
+		if (bank)
+			return Batch_RunBank(argv[arg], threads);
+		return Batch_Run(argv + arg, argc - arg, threads);
+	}
+	
+	if (argc < arg + 2)
+	{
+		printf("usage: funkintimconv [-q psnr] out.tim in.png\n");
+		printf("       funkintimconv [-q psnr] -B [-j threads] in.png|dir...\n");
+		printf("       funkintimconv -P [-j threads] dir/bank.tim\n");
+		printf("-q sets the PSNR (default %.0f dB) auto bpp needs to quantise to 4bpp\n", AUTO_PSNR_DEFAULT);
+		printf("-P writes the palette shared by the images in dir with bank=bank in their .png.txt and converts those images\n");
+		return 0;
+	}
+	
+	return ConvertTim(argv[arg], argv[arg + 1]) ? 0 : 1;
 }
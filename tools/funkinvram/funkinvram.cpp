@@ -0,0 +1,733 @@
+/*
+ * funkinvram
+ * Checks and plans the VRAM layout of every stage in the Friday Night Funkin' PSX port
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <regex>
+#include <filesystem>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "../funkintimconv/stb_image.c"
+
+//VRAM layout
+#define VRAM_WIDTH 1024
+#define VRAM_HEIGHT 512
+#define TPAGE_WIDTH 64
+#define TPAGE_HEIGHT 256
+#define CLUT_X 0
+#define CLUT_Y 480
+#define CLUT_WIDTH 256
+#define CLUT_HEIGHT 32
+
+//Map cells
+#define MAP_CELL_W 16
+#define MAP_CELL_H 32
+
+struct Rect
+{
+	int x, y, w, h;
+	
+	bool Overlaps(const Rect &o) const
+	{
+		return x < o.x + o.w && o.x < x + w && y < o.y + o.h && o.y < y + h;
+	}
+};
+
+//A converted .png, as its .png.txt places it
+struct Tim
+{
+	std::string path; //.png path
+	std::string param_path;
+	int tex_x, tex_y, pal_x, pal_y, bpp;
+	std::string rest; //Anything after the bpp
+	int width, height; //In pixels
+	bool moved = false;
+	
+	Rect Image() const { return {tex_x, tex_y, width * bpp / 16, height}; }
+	Rect Clut() const { return {pal_x, pal_y, (bpp == 4) ? 16 : 256, 1}; }
+};
+
+//Something a stage loads (a character, the background, the HUD...), its textures may share positions with each other since it swaps between them
+struct Owner
+{
+	std::string name;
+	std::vector<int> tims;
+};
+
+struct Stage
+{
+	std::string name;
+	int week;
+	std::vector<int> owners;
+};
+
+struct Item
+{
+	int owner, tim;
+	bool clut;
+	Rect rect;
+};
+
+static std::string root;
+static std::vector<Tim> tims;
+static std::map<std::string, int> tim_index;
+static std::vector<Owner> owners;
+static std::map<std::string, int> owner_index;
+static std::vector<Stage> stages;
+static std::vector<Rect> texpages; //Spare TPages for character texture caches
+static std::vector<int> texpage_rows;
+
+//File helpers
+static bool ReadText(const std::string &path, std::string &text)
+{
+	std::ifstream file(root + path, std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cout << "Failed to open " << root << path << std::endl;
+		return false;
+	}
+	std::stringstream stream;
+	stream << file.rdbuf();
+	text = stream.str();
+	return true;
+}
+
+static std::string Upper(std::string s)
+{
+	for (char &c : s)
+		c = toupper((unsigned char)c);
+	return s;
+}
+
+//Checks if tim_path is the palette of a bank, which every image with bank=name in the same directory shares
+static bool IsBank(const std::string &tim_path)
+{
+	std::filesystem::path path(root + tim_path);
+	std::string option = "bank=" + path.stem().string();
+	std::error_code error;
+	for (auto &entry : std::filesystem::directory_iterator(path.parent_path(), error))
+	{
+		std::string name = entry.path().filename().string();
+		if (name.size() <= 8 || name.compare(name.size() - 8, 8, ".png.txt") != 0)
+			continue;
+		std::ifstream file(entry.path());
+		std::string token;
+		while (file >> token)
+			if (token == option)
+				return true;
+	}
+	return false;
+}
+
+static int LoadTim(const std::string &tim_path)
+{
+	//Already loaded
+	auto find = tim_index.find(tim_path);
+	if (find != tim_index.end())
+		return find->second;
+	
+	Tim tim;
+	tim.path = tim_path.substr(0, tim_path.size() - 4) + ".png";
+	tim.param_path = tim.path + ".txt";
+	
+	//Read parameters
+	std::string text;
+	if (!ReadText(tim.param_path, text))
+		return -1;
+	std::istringstream param(text);
+	std::string bpp;
+	if (!(param >> tim.tex_x >> tim.tex_y >> tim.pal_x >> tim.pal_y >> bpp))
+	{
+		std::cout << "Failed to read parameters from " << tim.param_path << std::endl;
+		return -1;
+	}
+	std::getline(param, tim.rest);
+	if (bpp == "auto")
+	{
+		//Use the converted TIM's bpp if there is one, otherwise assume the worst
+		tim.bpp = 8;
+		std::ifstream file(root + tim_path, std::ios::binary);
+		uint8_t header[8];
+		if (file.read((char*)header, sizeof(header)) && header[0] == 0x10)
+			tim.bpp = ((header[4] & 3) == 0) ? 4 : 8;
+	}
+	else
+	{
+		tim.bpp = std::stoi(bpp);
+	}
+	
+	//Read image size
+	if (!stbi_info((root + tim.path).c_str(), &tim.width, &tim.height, NULL))
+	{
+		std::cout << "Failed to read image size of " << root << tim.path << std::endl;
+		return -1;
+	}
+	
+	tims.push_back(tim);
+	return tim_index[tim_path] = (int)tims.size() - 1;
+}
+
+//Asset lookup
+static std::map<std::string, std::string> cd_files; //CD path to source file
+static std::map<std::string, std::vector<std::string>> arc_tims; //.arc to the .tims in it
+
+static bool ReadManifests()
+{
+	//Get where each CD file comes from
+	std::string xml;
+	if (!ReadText("funkin.xml", xml))
+		return false;
+	std::vector<std::string> dirs;
+	std::regex xml_tag("<dir\\s+name\\s*=\\s*\"([^\"]+)\"\\s*>|</dir>|<file\\s+name\\s*=\\s*\"([^\"]+)\"[^>]*source\\s*=\\s*\"([^\"]+)\"");
+	for (auto i = std::sregex_iterator(xml.begin(), xml.end(), xml_tag); i != std::sregex_iterator(); ++i)
+	{
+		const std::smatch &m = *i;
+		if (m[1].matched)
+		{
+			dirs.push_back(Upper(m[1]));
+		}
+		else if (m[2].matched)
+		{
+			std::string cd_path;
+			for (auto &dir : dirs)
+				cd_path += "\\" + dir;
+			cd_files[cd_path + "\\" + Upper(m[2]) + ";1"] = m[3];
+		}
+		else if (!dirs.empty())
+		{
+			dirs.pop_back();
+		}
+	}
+	
+	//Get archive contents
+	std::string makefile;
+	if (!ReadText("Makefile.tim", makefile))
+		return false;
+	std::regex arc_rule("^(iso/\\S+\\.arc):([^\\n]*)", std::regex::multiline);
+	for (auto i = std::sregex_iterator(makefile.begin(), makefile.end(), arc_rule); i != std::sregex_iterator(); ++i)
+	{
+		std::istringstream deps((*i)[2].str());
+		std::string dep;
+		while (deps >> dep)
+			arc_tims[(*i)[1]].push_back(dep);
+	}
+	return true;
+}
+
+static int LoadOwner(const std::string &name, const std::vector<std::string> &cd_paths)
+{
+	auto find = owner_index.find(name);
+	if (find != owner_index.end())
+		return find->second;
+	
+	Owner owner;
+	owner.name = name;
+	for (auto &cd_path : cd_paths)
+	{
+		auto file = cd_files.find(cd_path);
+		if (file == cd_files.end())
+		{
+			std::cout << name << " reads " << cd_path << " which isn't in funkin.xml" << std::endl;
+			return -1;
+		}
+		
+		std::vector<std::string> paths;
+		auto arc = arc_tims.find(file->second);
+		if (arc != arc_tims.end())
+			paths = arc->second;
+		else if (file->second.size() > 4 && file->second.compare(file->second.size() - 4, 4, ".tim") == 0)
+			paths.push_back(file->second);
+		
+		for (auto &path : paths)
+		{
+			//A bank's palette goes where its images' .png.txt put their palette, so they cover it already
+			if (!std::filesystem::exists(root + path.substr(0, path.size() - 4) + ".png") && IsBank(path))
+				continue;
+			
+			int tim = LoadTim(path);
+			if (tim < 0)
+				return -1;
+			if (std::find(owner.tims.begin(), owner.tims.end(), tim) == owner.tims.end())
+				owner.tims.push_back(tim);
+		}
+	}
+	
+	owners.push_back(owner);
+	return owner_index[name] = (int)owners.size() - 1;
+}
+
+static bool ReadStages()
+{
+	//Find which source file defines each character and background
+	std::map<std::string, std::string> func_files;
+	std::regex func_def("(?:Character|StageBack)\\s*\\*\\s*(\\w+_New)\\s*\\([^)]*\\)\\s*\\{");
+	for (const char *dir : {"src/character", "src/stage"})
+	{
+		for (auto &entry : std::filesystem::directory_iterator(root + dir))
+		{
+			if (entry.path().extension() != ".c")
+				continue;
+			std::string text;
+			if (!ReadText(std::string(dir) + "/" + entry.path().filename().string(), text))
+				return false;
+			for (auto i = std::sregex_iterator(text.begin(), text.end(), func_def); i != std::sregex_iterator(); ++i)
+				func_files[(*i)[1]] = text;
+		}
+	}
+	
+	//Read stage definitions
+	std::string defs;
+	if (!ReadText("src/stagedef_disc1.h", defs))
+		return false;
+	std::regex stage_start("\\{\\s*//(StageId_\\w+(?: \\([^)]*\\))?)");
+	std::regex character("\\{\\s*(Char_\\w+_New)\\s*,");
+	std::regex back("\\b(Back_\\w+_New)\\s*,");
+	std::regex song_info("//Song info\\s*(\\d+)\\s*,");
+	std::regex cd_read("(IO_FindFile\\s*\\([^\"]*)?\"((?:\\\\\\\\\\w+)+\\.(?:ARC|TIM);1)\"");
+	std::vector<Stage> game_overs;
+	
+	std::vector<std::pair<size_t, std::string>> starts;
+	for (auto i = std::sregex_iterator(defs.begin(), defs.end(), stage_start); i != std::sregex_iterator(); ++i)
+		starts.push_back({(size_t)i->position(), (*i)[1]});
+	
+	for (size_t s = 0; s < starts.size(); s++)
+	{
+		size_t end = (s + 1 < starts.size()) ? starts[s + 1].first : defs.size();
+		std::string block = defs.substr(starts[s].first, end - starts[s].first);
+		
+		Stage stage;
+		stage.name = starts[s].second;
+		std::smatch m;
+		stage.week = std::regex_search(block, m, song_info) ? std::stoi(m[1]) : 0;
+		
+		//Everything the stage itself loads, mirroring Stage_Load
+		int hud = LoadOwner((stage.week == 6) ? "hud (weeb)" : "hud", {
+			(stage.week == 6) ? "\\STAGE\\HUD0WEEB.TIM;1" : "\\STAGE\\HUD0.TIM;1",
+		});
+		int hud1 = LoadOwner("hud1", {"\\STAGE\\HUD1.TIM;1"});
+		int hude = LoadOwner("hudextra", {"\\STAGE\\HUDEXTRA.TIM;1"});
+		int font = LoadOwner("font", {"\\FONT\\FONT1.TIM;1"});
+		if (hud < 0 || hud1 < 0 || hude < 0 || font < 0)
+			return false;
+		stage.owners = {hud, hud1, hude, font};
+		
+		//Characters and background load whatever their source file reads
+		std::vector<std::string> funcs;
+		for (auto i = std::sregex_iterator(block.begin(), block.end(), character); i != std::sregex_iterator(); ++i)
+			funcs.push_back((*i)[1]);
+		if (std::regex_search(block, m, back))
+			funcs.push_back(m[1]);
+		
+		for (auto &func : funcs)
+		{
+			auto file = func_files.find(func);
+			if (file == func_files.end())
+			{
+				std::cout << stage.name << " uses " << func << " which wasn't found" << std::endl;
+				return false;
+			}
+			//Files only found at load are read later in place of the rest (BF's game over), so they're checked on their own
+			std::vector<std::string> cd_paths, later_paths;
+			for (auto i = std::sregex_iterator(file->second.begin(), file->second.end(), cd_read); i != std::sregex_iterator(); ++i)
+			{
+				std::string cd_path = std::regex_replace((*i)[2].str(), std::regex("\\\\\\\\"), "\\");
+				std::vector<std::string> &paths = (*i)[1].matched ? later_paths : cd_paths;
+				if (std::find(paths.begin(), paths.end(), cd_path) == paths.end())
+					paths.push_back(cd_path);
+			}
+			int owner = LoadOwner(func, cd_paths);
+			if (owner < 0)
+				return false;
+			if (std::find(stage.owners.begin(), stage.owners.end(), owner) == stage.owners.end())
+				stage.owners.push_back(owner);
+			
+			if (!later_paths.empty() && owner_index.count(func + " (game over)") == 0)
+			{
+				int later = LoadOwner(func + " (game over)", later_paths);
+				if (later < 0)
+					return false;
+				game_overs.push_back({owners[later].name, -1, {later}});
+			}
+		}
+		stages.push_back(stage);
+	}
+	stages.insert(stages.end(), game_overs.begin(), game_overs.end());
+	
+	//Spare TPages character texture caches use
+	std::string character_c;
+	if (!ReadText("src/character.c", character_c))
+		return false;
+	std::smatch table;
+	if (std::regex_search(character_c, table, std::regex("char_texpage\\[\\]\\s*=\\s*\\{([^;]*)\\};")))
+	{
+		std::string entries = table[1];
+		std::regex entry("\\{\\s*(\\d+)\\s*,\\s*(\\d+)\\s*,\\s*(\\d+)\\s*\\}");
+		for (auto i = std::sregex_iterator(entries.begin(), entries.end(), entry); i != std::sregex_iterator(); ++i)
+		{
+			texpages.push_back({std::stoi((*i)[1]), std::stoi((*i)[2]), TPAGE_WIDTH, TPAGE_HEIGHT});
+			texpage_rows.push_back(std::stoi((*i)[3]));
+		}
+	}
+	return true;
+}
+
+//Layout checking
+static const Rect framebuffer = {0, 0, 320, 480}; //Both 320x240 buffers, see Gfx_Init
+
+static std::vector<Item> StageItems(const Stage &stage)
+{
+	std::vector<Item> items;
+	for (int owner : stage.owners)
+	{
+		for (int tim : owners[owner].tims)
+		{
+			items.push_back({owner, tim, false, tims[tim].Image()});
+			items.push_back({owner, tim, true, tims[tim].Clut()});
+		}
+	}
+	return items;
+}
+
+static bool Conflicts(const Item &a, const Item &b)
+{
+	if (!a.rect.Overlaps(b.rect))
+		return false;
+	
+	//The same texture, or textures an owner swaps between at the same position, can share space
+	if (a.tim == b.tim && a.clut == b.clut)
+		return false;
+	if (a.owner == b.owner && a.clut == b.clut && a.rect.x == b.rect.x && a.rect.y == b.rect.y)
+		return false;
+	return true;
+}
+
+static std::string ItemName(const Item &item)
+{
+	char rect[64];
+	sprintf(rect, " (%d,%d %dx%d)", item.rect.x, item.rect.y, item.rect.w, item.rect.h);
+	return tims[item.tim].path + (item.clut ? " CLUT" : "") + rect;
+}
+
+static int CheckStage(const Stage &stage, std::vector<std::pair<Item, Item>> *conflicts, bool print)
+{
+	std::vector<Item> items = StageItems(stage);
+	int errors = 0;
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		const Item &a = items[i];
+		Rect bounds = a.clut ? Rect{CLUT_X, CLUT_Y, CLUT_WIDTH, CLUT_HEIGHT} : Rect{0, 0, VRAM_WIDTH, VRAM_HEIGHT};
+		if (a.rect.x < bounds.x || a.rect.y < bounds.y || a.rect.x + a.rect.w > bounds.x + bounds.w || a.rect.y + a.rect.h > bounds.y + bounds.h)
+		{
+			if (print)
+				std::cout << stage.name << ": " << ItemName(a) << " is outside of " << (a.clut ? "the CLUT area" : "VRAM") << std::endl;
+			if (conflicts != nullptr)
+				conflicts->push_back({a, a});
+			errors++;
+		}
+		if (a.rect.Overlaps(framebuffer))
+		{
+			if (print)
+				std::cout << stage.name << ": " << ItemName(a) << " overlaps the framebuffers" << std::endl;
+			if (conflicts != nullptr)
+				conflicts->push_back({a, a});
+			errors++;
+		}
+		for (size_t j = i + 1; j < items.size(); j++)
+		{
+			const Item &b = items[j];
+			if (!Conflicts(a, b))
+				continue;
+			if (print)
+				std::cout << stage.name << ": " << ItemName(a) << " from " << owners[a.owner].name << " overlaps " << ItemName(b) << " from " << owners[b.owner].name << std::endl;
+			if (conflicts != nullptr)
+				conflicts->push_back({a, b});
+			errors++;
+		}
+	}
+	return errors;
+}
+
+static void PrintMap(const Stage &stage)
+{
+	//One letter per owner, lower case for palettes, overlaps are listed by CheckStage
+	std::vector<Item> items = StageItems(stage);
+	std::vector<std::string> map(VRAM_HEIGHT / MAP_CELL_H, std::string(VRAM_WIDTH / MAP_CELL_W, '.'));
+	for (int y = 0; y < VRAM_HEIGHT / MAP_CELL_H; y++)
+	{
+		for (int x = 0; x < VRAM_WIDTH / MAP_CELL_W; x++)
+		{
+			Rect cell = {x * MAP_CELL_W, y * MAP_CELL_H, MAP_CELL_W, MAP_CELL_H};
+			if (cell.Overlaps(framebuffer))
+				map[y][x] = '#';
+			for (size_t i = 0; i < texpages.size(); i++)
+				if (cell.Overlaps(texpages[i]) && map[y][x] == '.')
+					map[y][x] = '0' + i;
+			for (const Item &item : items)
+			{
+				if (!cell.Overlaps(item.rect))
+					continue;
+				size_t o = std::find(stage.owners.begin(), stage.owners.end(), item.owner) - stage.owners.begin();
+				char c = (item.clut ? 'a' : 'A') + o;
+				map[y][x] = (map[y][x] == '.' || (map[y][x] >= '0' && map[y][x] <= '9') || map[y][x] == c) ? c : '+';
+			}
+		}
+	}
+	
+	std::cout << stage.name << std::endl;
+	for (auto &row : map)
+		std::cout << "  " << row << std::endl;
+	std::cout << "  # framebuffers, + more than one thing, digits are spare character texture pages";
+	for (size_t o = 0; o < stage.owners.size(); o++)
+		std::cout << ", " << (char)('A' + o) << " " << owners[stage.owners[o]].name;
+	std::cout << std::endl;
+}
+
+static std::vector<int> FreeTexPages(const Stage &stage)
+{
+	//Spare pages nothing else is loaded into
+	std::vector<Item> items = StageItems(stage);
+	std::vector<int> free;
+	for (size_t i = 0; i < texpages.size(); i++)
+	{
+		bool used = false;
+		for (const Item &item : items)
+			if (!item.clut && item.rect.Overlaps(texpages[i]))
+				used = true;
+		if (!used)
+			free.push_back((int)i);
+	}
+	return free;
+}
+
+//Slot assignment
+static int StagesLoading(int tim)
+{
+	int count = 0;
+	for (const Stage &stage : stages)
+	{
+		for (int owner : stage.owners)
+		{
+			if (std::find(owners[owner].tims.begin(), owners[owner].tims.end(), tim) != owners[owner].tims.end())
+			{
+				count++;
+				break;
+			}
+		}
+	}
+	return count;
+}
+
+static bool FitsEverywhere(const std::vector<int> &group, const Rect &rect)
+{
+	//Check every stage that loads any of the textures being moved
+	for (const Stage &stage : stages)
+	{
+		bool loads = false;
+		for (int owner : stage.owners)
+			for (int tim : owners[owner].tims)
+				if (std::find(group.begin(), group.end(), tim) != group.end())
+					loads = true;
+		if (!loads)
+			continue;
+		
+		if (rect.Overlaps(framebuffer))
+			return false;
+		for (const Item &item : StageItems(stage))
+		{
+			if (std::find(group.begin(), group.end(), item.tim) != group.end())
+				continue;
+			if (item.rect.Overlaps(rect))
+				return false;
+		}
+	}
+	return true;
+}
+
+static bool Reassign(const Item &item)
+{
+	//Move every texture the owner keeps at the same position, so it can still swap between them
+	const Owner &owner = owners[item.owner];
+	std::vector<int> group;
+	int w = 0, h = 0;
+	for (int tim : owner.tims)
+	{
+		Rect rect = item.clut ? tims[tim].Clut() : tims[tim].Image();
+		if (rect.x == item.rect.x && rect.y == item.rect.y)
+		{
+			group.push_back(tim);
+			w = std::max(w, rect.w);
+			h = std::max(h, rect.h);
+		}
+	}
+	
+	std::vector<Rect> candidates;
+	if (item.clut)
+	{
+		//Palettes go in the CLUT area, on 16 halfword boundaries, rows of spare character texture pages last
+		for (int pass = 0; pass < 2; pass++)
+		{
+			for (int y = CLUT_Y + CLUT_HEIGHT - 1; y >= CLUT_Y; y--)
+			{
+				bool spare = std::find(texpage_rows.begin(), texpage_rows.end(), y) != texpage_rows.end();
+				if (spare != (pass == 1))
+					continue;
+				for (int x = CLUT_X; x + w <= CLUT_X + CLUT_WIDTH; x += 16)
+					candidates.push_back({x, y, w, h});
+			}
+		}
+	}
+	else
+	{
+		//Textures go on TPage boundaries, spare character texture pages last
+		for (int pass = 0; pass < 2; pass++)
+		{
+			for (int y = 0; y + h <= VRAM_HEIGHT; y += TPAGE_HEIGHT)
+			{
+				for (int x = 0; x + w <= VRAM_WIDTH; x += TPAGE_WIDTH)
+				{
+					Rect rect = {x, y, w, h};
+					bool spare = false;
+					for (const Rect &page : texpages)
+						if (rect.Overlaps(page))
+							spare = true;
+					if (spare == (pass == 1))
+						candidates.push_back(rect);
+				}
+			}
+		}
+	}
+	
+	for (const Rect &rect : candidates)
+	{
+		if (!FitsEverywhere(group, rect))
+			continue;
+		for (int tim : group)
+		{
+			if (item.clut)
+			{
+				tims[tim].pal_x = rect.x;
+				tims[tim].pal_y = rect.y;
+			}
+			else
+			{
+				tims[tim].tex_x = rect.x;
+				tims[tim].tex_y = rect.y;
+			}
+			tims[tim].moved = true;
+			std::cout << "Moved " << tims[tim].path << (item.clut ? " CLUT" : "") << " to " << rect.x << "," << rect.y << std::endl;
+		}
+		return true;
+	}
+	std::cout << "No free " << (item.clut ? "CLUT" : "TPage") << " slot for " << ItemName(item) << std::endl;
+	return false;
+}
+
+static bool WriteParams()
+{
+	for (const Tim &tim : tims)
+	{
+		if (!tim.moved)
+			continue;
+		std::ofstream file(root + tim.param_path);
+		file << tim.tex_x << " " << tim.tex_y << " " << tim.pal_x << " " << tim.pal_y << " " << tim.bpp << tim.rest << std::endl;
+		if (!file.good())
+		{
+			std::cout << "Failed to write " << root << tim.param_path << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	//Read parameters
+	bool print_map = false, assign = false;
+	int arg = 1;
+	for (; arg < argc && argv[arg][0] == '-'; arg++)
+	{
+		if (strcmp(argv[arg], "-m") == 0)
+		{
+			print_map = true;
+		}
+		else if (strcmp(argv[arg], "-a") == 0)
+		{
+			assign = true;
+		}
+		else
+		{
+			std::cout << "usage: funkinvram [-m] [-a] [repo_dir]" << std::endl;
+			std::cout << "-m prints each stage's VRAM map, -a moves overlapping textures and palettes to free slots and rewrites their .png.txt" << std::endl;
+			return 0;
+		}
+	}
+	if (arg < argc)
+	{
+		root = argv[arg];
+		if (!root.empty() && root.back() != '/')
+			root += '/';
+	}
+	
+	//Read what every stage loads
+	if (!ReadManifests() || !ReadStages())
+		return 1;
+	
+	//Move what overlaps until nothing does
+	if (assign)
+	{
+		for (int pass = 0; pass < 64; pass++)
+		{
+			std::vector<std::pair<Item, Item>> conflicts;
+			for (const Stage &stage : stages)
+				if (CheckStage(stage, &conflicts, false) != 0)
+					break;
+			if (conflicts.empty())
+				break;
+			
+			//Move whichever fewer stages load
+			const Item &a = conflicts[0].first, &b = conflicts[0].second;
+			if (!Reassign((StagesLoading(a.tim) < StagesLoading(b.tim)) ? a : b))
+				break;
+		}
+		if (!WriteParams())
+			return 1;
+	}
+	
+	//Report
+	int errors = 0;
+	for (const Stage &stage : stages)
+	{
+		errors += CheckStage(stage, nullptr, true);
+		if (print_map)
+			PrintMap(stage);
+	}
+	
+	std::map<std::vector<int>, std::vector<std::string>> free_pages;
+	for (const Stage &stage : stages)
+		if (stage.week >= 0)
+			free_pages[FreeTexPages(stage)].push_back(stage.name.substr(0, stage.name.find(' ')));
+	for (auto &i : free_pages)
+	{
+		std::cout << i.first.size() << "/" << texpages.size() << " spare character texture pages free (";
+		for (size_t j = 0; j < i.first.size(); j++)
+			std::cout << (j ? " " : "") << texpages[i.first[j]].x << "," << texpages[i.first[j]].y;
+		std::cout << ") in " << i.second.size() << " stages:";
+		for (auto &name : i.second)
+			std::cout << " " << name;
+		std::cout << std::endl;
+	}
+	
+	std::cout << stages.size() << " stages, " << tims.size() << " textures, " << errors << " overlaps" << std::endl;
+	return (errors != 0) ? 1 : 0;
+}
@@ -25,11 +25,14 @@ This tool has been modified so that libpsxav isn't an external library
 
 #include <assert.h>
 #include <getopt.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 #include <libavutil/opt.h>
 #include <libavcodec/avcodec.h>
@@ -61,6 +64,15 @@ typedef struct {
 	int32_t *dct_block_lists[6];
 } vid_encoder_state_t;
 
+// Frames encoded ahead of the muxer, one per thread, see mdec.c
+typedef struct {
+	vid_encoder_state_t *frames;
+	int slots;
+	int head; // next frame to mux
+	int count; // encoded frames waiting to be muxed
+	int frame_block_overflow_num; // after the last encoded frame
+} vid_frame_queue_t;
+
 typedef struct {
 	int video_frame_src_size;
 	int video_frame_dst_size;
@@ -82,6 +94,20 @@ typedef struct {
 	double video_next_pts;
 } av_decoder_state_t;
 
+#define AV_STREAM_BLOCKS 2
+typedef struct {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	int16_t *blocks[AV_STREAM_BLOCKS];
+	int block_length[AV_STREAM_BLOCKS]; // samples, including all channels
+	int block_samples; // samples per full block, including all channels
+	int head; // next block to read
+	int count; // blocks ready to read
+	bool done;
+	int total_samples;
+} av_stream_state_t;
+
 typedef struct {
 	int format; // FORMAT_*
 	bool stereo; // false or true
@@ -95,14 +121,19 @@ typedef struct {
 	int video_fps_num; // FPS numerator
 	int video_fps_den; // FPS denominator
 
+	int threads; // XA encoder threads, or batch workers
+	const char *batch_path; // -B manifest, or NULL
+
 	int16_t *audio_samples;
 	int audio_sample_count;
 	uint8_t *video_frames;
 	int video_frame_count;
 
 	av_decoder_state_t decoder_state_av;
+	av_stream_state_t stream_state_av;
 
 	vid_encoder_state_t state_vid;
+	vid_frame_queue_t queue_vid;
 } settings_t;
 
 // cdrom.c
@@ -115,12 +146,19 @@ bool poll_av_data(settings_t *settings);
 bool ensure_av_data(settings_t *settings, int needed_audio_samples, int needed_video_frames);
 void pull_all_av_data(settings_t *settings);
 void retire_av_data(settings_t *settings, int retired_audio_samples, int retired_video_frames);
+bool start_av_stream(settings_t *settings, int block_samples);
+int read_av_stream(settings_t *settings, int16_t **samples);
+void release_av_stream(settings_t *settings);
+void stop_av_stream(settings_t *settings);
 void close_av_data(settings_t *settings);
 
 // filefmt.c
-void encode_file_spu(int16_t *audio_samples, int audio_sample_count, settings_t *settings, FILE *output);
-void encode_file_xa(int16_t *audio_samples, int audio_sample_count, settings_t *settings, FILE *output);
-void encode_file_str(settings_t *settings, FILE *output);
+// These return 0 on success, or 1 if the file couldn't be encoded
+int encode_file_spu(settings_t *settings, FILE *output);
+int encode_file_xa(settings_t *settings, FILE *output);
+int encode_file_str(settings_t *settings, FILE *output);
 
 // mdec.c
+void init_frame_queue_str(settings_t *settings);
+void free_frame_queue_str(settings_t *settings);
 void encode_block_str(uint8_t *video_frames, int video_frame_count, uint8_t *output, settings_t *settings);
@@ -319,18 +319,146 @@ void retire_av_data(settings_t *settings, int retired_audio_samples, int retired
 	assert(retired_video_frames <= settings->video_frame_count);
 
 	int sample_size = sizeof(int16_t);
-	if (settings->audio_sample_count > retired_audio_samples) {
+	if (settings->audio_sample_count >= retired_audio_samples) {
 		memmove(settings->audio_samples, settings->audio_samples + retired_audio_samples, (settings->audio_sample_count - retired_audio_samples)*sample_size);
 		settings->audio_sample_count -= retired_audio_samples;
 	}
 
 	int frame_size = av->video_frame_dst_size;
-	if (settings->video_frame_count > retired_video_frames) {
+	if (settings->video_frame_count >= retired_video_frames) {
 		memmove(settings->video_frames, settings->video_frames + retired_video_frames*frame_size, (settings->video_frame_count - retired_video_frames)*frame_size);
 		settings->video_frame_count -= retired_video_frames;
 	}
 }
 
+// Streaming audio
+//
+// The audio is decoded on a second thread and handed to the encoder in blocks of a fixed number of
+// samples, so only AV_STREAM_BLOCKS blocks and the decoder's own buffer are held in memory however
+// long the input is, and decoding overlaps encoding. Every block is full except the last one.
+
+static void *av_stream_thread(void *arg)
+{
+	settings_t *settings = (settings_t*) arg;
+	av_stream_state_t *stream = &(settings->stream_state_av);
+	bool more = true;
+
+	while (more) {
+		more = ensure_av_data(settings, stream->block_samples, 0);
+		int length = settings->audio_sample_count;
+		if (length > stream->block_samples) {
+			length = stream->block_samples;
+		}
+
+		pthread_mutex_lock(&(stream->lock));
+		while (stream->count == AV_STREAM_BLOCKS) {
+			pthread_cond_wait(&(stream->cond), &(stream->lock));
+		}
+		int index = (stream->head + stream->count) % AV_STREAM_BLOCKS;
+		pthread_mutex_unlock(&(stream->lock));
+
+		if (length > 0) {
+			memcpy(stream->blocks[index], settings->audio_samples, length * sizeof(int16_t));
+		}
+		// Video frames aren't used when only encoding audio
+		retire_av_data(settings, length, settings->video_frame_count);
+
+		pthread_mutex_lock(&(stream->lock));
+		stream->block_length[index] = length;
+		stream->total_samples += length;
+		if (length > 0) {
+			stream->count++;
+		}
+		stream->done = !more;
+		pthread_cond_broadcast(&(stream->cond));
+		pthread_mutex_unlock(&(stream->lock));
+	}
+
+	return NULL;
+}
+
+static void free_av_stream_blocks(av_stream_state_t *stream)
+{
+	for (int i = 0; i < AV_STREAM_BLOCKS; i++) {
+		free(stream->blocks[i]);
+		stream->blocks[i] = NULL;
+	}
+}
+
+bool start_av_stream(settings_t *settings, int block_samples)
+{
+	av_stream_state_t* stream = &(settings->stream_state_av);
+
+	stream->block_samples = block_samples;
+	stream->head = 0;
+	stream->count = 0;
+	stream->done = false;
+	stream->total_samples = 0;
+	for (int i = 0; i < AV_STREAM_BLOCKS; i++) {
+		stream->blocks[i] = malloc(block_samples * sizeof(int16_t));
+	}
+	for (int i = 0; i < AV_STREAM_BLOCKS; i++) {
+		if (stream->blocks[i] == NULL) {
+			free_av_stream_blocks(stream);
+			return false;
+		}
+	}
+
+	pthread_mutex_init(&(stream->lock), NULL);
+	pthread_cond_init(&(stream->cond), NULL);
+	if (pthread_create(&(stream->thread), NULL, av_stream_thread, settings) != 0) {
+		pthread_cond_destroy(&(stream->cond));
+		pthread_mutex_destroy(&(stream->lock));
+		free_av_stream_blocks(stream);
+		return false;
+	}
+
+	return true;
+}
+
+// Returns the number of samples in the next block, or 0 once the input has ended
+int read_av_stream(settings_t *settings, int16_t **samples)
+{
+	av_stream_state_t* stream = &(settings->stream_state_av);
+	int length = 0;
+
+	pthread_mutex_lock(&(stream->lock));
+	while (stream->count == 0 && !stream->done) {
+		pthread_cond_wait(&(stream->cond), &(stream->lock));
+	}
+	if (stream->count > 0) {
+		*samples = stream->blocks[stream->head];
+		length = stream->block_length[stream->head];
+	}
+	pthread_mutex_unlock(&(stream->lock));
+
+	return length;
+}
+
+// Hands the block returned by read_av_stream back to the decoding thread
+void release_av_stream(settings_t *settings)
+{
+	av_stream_state_t* stream = &(settings->stream_state_av);
+
+	pthread_mutex_lock(&(stream->lock));
+	stream->head = (stream->head + 1) % AV_STREAM_BLOCKS;
+	stream->count--;
+	pthread_cond_broadcast(&(stream->cond));
+	pthread_mutex_unlock(&(stream->lock));
+}
+
+void stop_av_stream(settings_t *settings)
+{
+	av_stream_state_t* stream = &(settings->stream_state_av);
+
+	pthread_join(stream->thread, NULL);
+	pthread_cond_destroy(&(stream->cond));
+	pthread_mutex_destroy(&(stream->lock));
+	free_av_stream_blocks(stream);
+
+	fprintf(stderr, "Loaded %d samples.\n", stream->total_samples);
+}
+
 void close_av_data(settings_t *settings)
 {
 	av_decoder_state_t* av = &(settings->decoder_state_av);
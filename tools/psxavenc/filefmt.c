@@ -45,47 +45,103 @@ static psx_audio_xa_settings_t settings_to_libpsxav_xa_audio(settings_t *setting
 	return new_settings;
 };
 
-void encode_file_spu(int16_t *audio_samples, int audio_sample_count, settings_t *settings, FILE *output) {
+// Blocks are encoded as they are decoded, a whole number of SPU blocks or XA sectors at a time
+#define STREAM_SPU_BLOCKS 4096
+#define STREAM_XA_SECTORS_PER_THREAD 32
+
+int encode_file_spu(settings_t *settings, FILE *output) {
 	psx_audio_encoder_state_t audio_state;	
 	int audio_samples_per_block = psx_audio_spu_get_samples_per_block();
-	uint8_t buffer[16];
+	int16_t *audio_samples;
+	int audio_sample_count;
+	uint8_t *buffer = malloc(STREAM_SPU_BLOCKS * 16);
+	uint8_t last_block[16]; // held back until we know whether it ends the file
+	int blocks = 0;
 
 	memset(&audio_state, 0, sizeof(psx_audio_encoder_state_t));
 
-	for (int i = 0; i < audio_sample_count; i += audio_samples_per_block) {
-		int samples_length = audio_sample_count - i;
-		if (samples_length > audio_samples_per_block) samples_length = audio_samples_per_block;
-		int length = psx_audio_spu_encode(&audio_state, audio_samples + i, samples_length, buffer);
-		if (i == 0) {
+	if (buffer == NULL || !start_av_stream(settings, STREAM_SPU_BLOCKS * audio_samples_per_block)) {
+		fprintf(stderr, "Could not start decoding!\n");
+		free(buffer);
+		return 1;
+	}
+
+	while ((audio_sample_count = read_av_stream(settings, &audio_samples)) > 0) {
+		int length = psx_audio_spu_encode(&audio_state, audio_samples, audio_sample_count, buffer);
+		release_av_stream(settings);
+
+		if (blocks == 0) {
 			buffer[1] = PSX_AUDIO_SPU_LOOP_START;
-		} else if ((i + audio_samples_per_block) >= audio_sample_count) {
-			buffer[1] = PSX_AUDIO_SPU_LOOP_END;
+		} else {
+			fwrite(last_block, 16, 1, output);
 		}
-		fwrite(buffer, length, 1, output);
+		fwrite(buffer, length - 16, 1, output);
+		memcpy(last_block, buffer + length - 16, 16);
+		blocks += length / 16;
 	}
+
+	if (blocks > 0) {
+		if (blocks > 1) {
+			last_block[1] = PSX_AUDIO_SPU_LOOP_END;
+		}
+		fwrite(last_block, 16, 1, output);
+	}
+
+	stop_av_stream(settings);
+	free(buffer);
+	return 0;
 }
 
-void encode_file_xa(int16_t *audio_samples, int audio_sample_count, settings_t *settings, FILE *output) {
+int encode_file_xa(settings_t *settings, FILE *output) {
 	psx_audio_xa_settings_t xa_settings = settings_to_libpsxav_xa_audio(settings);
 	psx_audio_encoder_state_t audio_state;	
 	int audio_samples_per_sector = psx_audio_xa_get_samples_per_sector(xa_settings);
 	int av_sample_mul = settings->stereo ? 2 : 1;
-	uint8_t buffer[2352];
+	int xa_sector_size = psx_audio_xa_get_buffer_size_per_sector(xa_settings);
+	int sectors = STREAM_XA_SECTORS_PER_THREAD * settings->threads;
+	int16_t *audio_samples;
+	int audio_sample_count;
+	// Sectors are written from their subheader, so 2336-byte sectors start 16 bytes in
+	uint8_t *buffer = malloc(sectors * 2352 + 16);
+	uint8_t last_sector[2352]; // held back until we know whether it ends the file
+	bool has_last_sector = false;
 
 	memset(&audio_state, 0, sizeof(psx_audio_encoder_state_t));
 
-	for (int i = 0; i < audio_sample_count; i += audio_samples_per_sector) {
-		int samples_length = audio_sample_count - i;
-		if (samples_length > audio_samples_per_sector) samples_length = audio_samples_per_sector;
-		int length = psx_audio_xa_encode(xa_settings, &audio_state, audio_samples + (i * av_sample_mul), samples_length, buffer);
-		if ((i + audio_samples_per_sector) >= audio_sample_count) {
-			psx_audio_xa_encode_finalize(xa_settings, buffer, length);
+	if (buffer == NULL || !start_av_stream(settings, sectors * audio_samples_per_sector * av_sample_mul)) {
+		fprintf(stderr, "Could not start decoding!\n");
+		free(buffer);
+		return 1;
+	}
+
+	while ((audio_sample_count = read_av_stream(settings, &audio_samples)) > 0) {
+		int length;
+		if (settings->threads > 1) {
+			length = psx_audio_xa_encode_threaded(xa_settings, &audio_state, audio_samples, audio_sample_count / av_sample_mul, buffer + 16, settings->threads);
+		} else {
+			length = psx_audio_xa_encode(xa_settings, &audio_state, audio_samples, audio_sample_count / av_sample_mul, buffer + 16);
+		}
+		release_av_stream(settings);
+
+		if (has_last_sector) {
+			fwrite(last_sector, xa_sector_size, 1, output);
 		}
-		fwrite(buffer, length, 1, output);
+		fwrite(buffer + 16, length - xa_sector_size, 1, output);
+		memcpy(last_sector, buffer + 16 + length - xa_sector_size, xa_sector_size);
+		has_last_sector = true;
 	}
+
+	if (has_last_sector) {
+		psx_audio_xa_encode_finalize(xa_settings, last_sector, xa_sector_size);
+		fwrite(last_sector, xa_sector_size, 1, output);
+	}
+
+	stop_av_stream(settings);
+	free(buffer);
+	return 0;
 }
 
-void encode_file_str(settings_t *settings, FILE *output) {
+int encode_file_str(settings_t *settings, FILE *output) {
 	uint8_t buffer[2352*8];
 	psx_audio_xa_settings_t xa_settings = settings_to_libpsxav_xa_audio(settings);
 	psx_audio_encoder_state_t audio_state;	
@@ -108,6 +164,7 @@ void encode_file_str(settings_t *settings, FILE *output) {
 	settings->state_vid.frame_block_base_overflow = 150*7*settings->video_fps_den;
 	settings->state_vid.frame_block_overflow_den = 8*settings->video_fps_num;
 	//fprintf(stderr, "%f\n", ((double)settings->state_vid.frame_block_base_overflow)/((double)settings->state_vid.frame_block_overflow_den)); abort();
+	init_frame_queue_str(settings);
 
 	// FIXME: this needs an extra frame to prevent A/V desync
 	const int frames_needed = 2;
@@ -134,4 +191,7 @@ void encode_file_str(settings_t *settings, FILE *output) {
 		retire_av_data(settings, audio_samples_per_sector*av_sample_mul, 0);
 		fwrite(buffer, 2352*8, 1, output);
 	}
+
+	free_frame_queue_str(settings);
+	return 0;
 }
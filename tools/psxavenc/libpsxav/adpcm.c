@@ -22,9 +22,16 @@ freely, subject to the following restrictions:
 */
 
 #include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
 #include <string.h>
 #include "libpsxav.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ADPCM_SIMD_X86
+#include <immintrin.h>
+#endif
+
 #define ADPCM_FILTER_COUNT 5
 #define XA_ADPCM_FILTER_COUNT 4
 #define SPU_ADPCM_FILTER_COUNT 5
@@ -32,7 +39,7 @@ freely, subject to the following restrictions:
 static const int16_t filter_k1[ADPCM_FILTER_COUNT] = {0, 60, 115, 98, 122};
 static const int16_t filter_k2[ADPCM_FILTER_COUNT] = {0, 0, -52, -55, -60};
 
-static int find_min_shift(const psx_audio_encoder_channel_state_t *state, int16_t *samples, int pitch, int filter) {
+static int find_min_shift(const psx_audio_encoder_channel_state_t *state, int16_t *samples, int sample_limit, int pitch, int filter) {
 	// Assumption made:
 	//
 	// There is value in shifting right one step further to allow the nibbles to clip.
@@ -51,7 +58,7 @@ static int find_min_shift(const psx_audio_encoder_channel_state_t *state, int16_
 	int32_t s_min = 0;
 	int32_t s_max = 0;
 	for (int i = 0; i < 28; i++) {
-		int32_t raw_sample = samples[i * pitch];
+		int32_t raw_sample = (i * pitch) >= sample_limit ? 0 : samples[i * pitch];
 		int32_t previous_values = (k1*prev1 + k2*prev2 + (1<<5))>>6;
 		int32_t sample = raw_sample - previous_values;
 		if (sample < s_min) { s_min = sample; }
@@ -114,14 +121,237 @@ static uint8_t attempt_to_encode_nibbles(psx_audio_encoder_channel_state_t *outs
 	return hdr;
 }
 
+// Vectorized filter/shift search
+//
+// Every filter/shift candidate of a unit runs the same recursive 28 sample loop as
+// attempt_to_encode_nibbles with its own prev1/prev2, so the candidates are encoded side by side in
+// SIMD lanes instead. The kernels produce exactly the same MSEs as the scalar loop. The kernel is
+// picked at runtime and can be forced with PSXAV_ADPCM_KERNEL=scalar|sse2|avx2, or with
+// psx_audio_set_adpcm_kernel before encoding.
+
+#define ADPCM_MAX_CANDIDATES 16
+
+typedef struct {
+	int count;
+	int filter[ADPCM_MAX_CANDIDATES];
+	int shift[ADPCM_MAX_CANDIDATES];
+	int32_t k[ADPCM_MAX_CANDIDATES];       // k1 | k2 << 16, for 16 bit multiply-adds
+	int32_t enc_mul[ADPCM_MAX_CANDIDATES]; // 1 << shift
+	int32_t dec_mul[ADPCM_MAX_CANDIDATES]; // 1 << (12 - shift)
+	uint64_t mse[ADPCM_MAX_CANDIDATES];
+} adpcm_candidates_t;
+
+typedef void (*adpcm_kernel_t)(adpcm_candidates_t *cand, const int16_t *samples, int prev1, int prev2);
+
+#ifdef ADPCM_SIMD_X86
+__attribute__((target("sse2")))
+static inline __m128i sse2_mullo_epi32(__m128i a, __m128i b) {
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+__attribute__((target("sse2")))
+static inline __m128i sse2_clamp_epi32(__m128i x, __m128i lo, __m128i hi) {
+	__m128i below = _mm_cmplt_epi32(x, lo);
+	x = _mm_or_si128(_mm_and_si128(below, lo), _mm_andnot_si128(below, x));
+	__m128i above = _mm_cmpgt_epi32(x, hi);
+	return _mm_or_si128(_mm_and_si128(above, hi), _mm_andnot_si128(above, x));
+}
+
+__attribute__((target("sse2")))
+static void adpcm_kernel_sse2(adpcm_candidates_t *cand, const int16_t *samples, int prev1, int prev2) {
+	const __m128i lo16 = _mm_set1_epi32(0xFFFF);
+	const __m128i enc_lo = _mm_set1_epi32(-8), enc_hi = _mm_set1_epi32(7);
+
+	for (int j = 0; j < cand->count; j += 4) {
+		__m128i k = _mm_loadu_si128((const __m128i*)(cand->k + j));
+		__m128i enc_mul = _mm_loadu_si128((const __m128i*)(cand->enc_mul + j));
+		__m128i dec_mul = _mm_loadu_si128((const __m128i*)(cand->dec_mul + j));
+		__m128i prev = _mm_set1_epi32((prev1 & 0xFFFF) | (prev2 << 16));
+		__m128i mse_even = _mm_setzero_si128(), mse_odd = _mm_setzero_si128();
+
+		for (int i = 0; i < 28; i++) {
+			__m128i sample = _mm_set1_epi32(samples[i]);
+			__m128i previous_values = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(prev, k), _mm_set1_epi32(1<<5)), 6);
+			__m128i sample_enc = _mm_sub_epi32(sample, previous_values);
+			sample_enc = _mm_srai_epi32(_mm_add_epi32(sse2_mullo_epi32(sample_enc, enc_mul), _mm_set1_epi32(1<<(12-1))), 12);
+			sample_enc = sse2_clamp_epi32(sample_enc, enc_lo, enc_hi);
+
+			// sample_enc * dec_mul always fits in 16 bits
+			__m128i sample_dec = _mm_srai_epi32(_mm_slli_epi32(_mm_mullo_epi16(sample_enc, dec_mul), 16), 16);
+			sample_dec = _mm_add_epi32(sample_dec, previous_values);
+			sample_dec = _mm_packs_epi32(sample_dec, sample_dec);
+			sample_dec = _mm_srai_epi32(_mm_unpacklo_epi16(sample_dec, sample_dec), 16);
+
+			__m128i sample_error = _mm_sub_epi32(sample_dec, sample);
+			__m128i sign = _mm_srai_epi32(sample_error, 31);
+			sample_error = _mm_sub_epi32(_mm_xor_si128(sample_error, sign), sign);
+			mse_even = _mm_add_epi64(mse_even, _mm_mul_epu32(sample_error, sample_error));
+			sample_error = _mm_srli_epi64(sample_error, 32);
+			mse_odd = _mm_add_epi64(mse_odd, _mm_mul_epu32(sample_error, sample_error));
+
+			prev = _mm_or_si128(_mm_and_si128(sample_dec, lo16), _mm_slli_epi32(prev, 16));
+		}
+
+		uint64_t even[2], odd[2];
+		_mm_storeu_si128((__m128i*)even, mse_even);
+		_mm_storeu_si128((__m128i*)odd, mse_odd);
+		cand->mse[j + 0] = even[0];
+		cand->mse[j + 1] = odd[0];
+		cand->mse[j + 2] = even[1];
+		cand->mse[j + 3] = odd[1];
+	}
+}
+
+__attribute__((target("avx2")))
+static void adpcm_kernel_avx2(adpcm_candidates_t *cand, const int16_t *samples, int prev1, int prev2) {
+	const __m256i lo16 = _mm256_set1_epi32(0xFFFF);
+	const __m256i enc_lo = _mm256_set1_epi32(-8), enc_hi = _mm256_set1_epi32(7);
+	const __m256i dec_lo = _mm256_set1_epi32(-0x8000), dec_hi = _mm256_set1_epi32(0x7FFF);
+
+	for (int j = 0; j < cand->count; j += 8) {
+		__m256i k = _mm256_loadu_si256((const __m256i*)(cand->k + j));
+		__m256i dec_mul = _mm256_loadu_si256((const __m256i*)(cand->dec_mul + j));
+		__m256i shift = _mm256_loadu_si256((const __m256i*)(cand->shift + j));
+		__m256i prev = _mm256_set1_epi32((prev1 & 0xFFFF) | (prev2 << 16));
+		__m256i mse_even = _mm256_setzero_si256(), mse_odd = _mm256_setzero_si256();
+
+		for (int i = 0; i < 28; i++) {
+			__m256i sample = _mm256_set1_epi32(samples[i]);
+			__m256i previous_values = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(prev, k), _mm256_set1_epi32(1<<5)), 6);
+			__m256i sample_enc = _mm256_sub_epi32(sample, previous_values);
+			sample_enc = _mm256_srai_epi32(_mm256_add_epi32(_mm256_sllv_epi32(sample_enc, shift), _mm256_set1_epi32(1<<(12-1))), 12);
+			sample_enc = _mm256_min_epi32(_mm256_max_epi32(sample_enc, enc_lo), enc_hi);
+
+			__m256i sample_dec = _mm256_add_epi32(_mm256_mullo_epi32(sample_enc, dec_mul), previous_values);
+			sample_dec = _mm256_min_epi32(_mm256_max_epi32(sample_dec, dec_lo), dec_hi);
+
+			__m256i sample_error = _mm256_abs_epi32(_mm256_sub_epi32(sample_dec, sample));
+			mse_even = _mm256_add_epi64(mse_even, _mm256_mul_epu32(sample_error, sample_error));
+			sample_error = _mm256_srli_epi64(sample_error, 32);
+			mse_odd = _mm256_add_epi64(mse_odd, _mm256_mul_epu32(sample_error, sample_error));
+
+			prev = _mm256_or_si256(_mm256_and_si256(sample_dec, lo16), _mm256_slli_epi32(prev, 16));
+		}
+
+		uint64_t even[4], odd[4];
+		_mm256_storeu_si256((__m256i*)even, mse_even);
+		_mm256_storeu_si256((__m256i*)odd, mse_odd);
+		for (int l = 0; l < 4; l++) {
+			cand->mse[j + l * 2 + 0] = even[l];
+			cand->mse[j + l * 2 + 1] = odd[l];
+		}
+	}
+}
+#endif
+
+static adpcm_kernel_t adpcm_kernel = NULL; // NULL for the scalar loop
+static pthread_once_t adpcm_kernel_once = PTHREAD_ONCE_INIT;
+
+static void adpcm_kernel_init(void) {
+#ifdef ADPCM_SIMD_X86
+	const char *name = getenv("PSXAV_ADPCM_KERNEL");
+	__builtin_cpu_init();
+	if (name != NULL && strcmp(name, "scalar") == 0) {
+		adpcm_kernel = NULL;
+	} else if (__builtin_cpu_supports("avx2") && (name == NULL || strcmp(name, "avx2") == 0)) {
+		adpcm_kernel = adpcm_kernel_avx2;
+	} else if (__builtin_cpu_supports("sse2")) {
+		adpcm_kernel = adpcm_kernel_sse2;
+	}
+#endif
+}
+
+const char *psx_audio_get_adpcm_kernel_name(void) {
+	pthread_once(&adpcm_kernel_once, adpcm_kernel_init);
+#ifdef ADPCM_SIMD_X86
+	if (adpcm_kernel == adpcm_kernel_avx2) { return "avx2"; }
+	if (adpcm_kernel == adpcm_kernel_sse2) { return "sse2"; }
+#endif
+	return "scalar";
+}
+
+int psx_audio_set_adpcm_kernel(const char *name) {
+	pthread_once(&adpcm_kernel_once, adpcm_kernel_init);
+	if (strcmp(name, "scalar") == 0) {
+		adpcm_kernel = NULL;
+		return 0;
+	}
+#ifdef ADPCM_SIMD_X86
+	if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2")) {
+		adpcm_kernel = adpcm_kernel_avx2;
+		return 0;
+	}
+	if (strcmp(name, "sse2") == 0 && __builtin_cpu_supports("sse2")) {
+		adpcm_kernel = adpcm_kernel_sse2;
+		return 0;
+	}
+#endif
+	return -1;
+}
+
 static uint8_t encode_nibbles(psx_audio_encoder_channel_state_t *state, int16_t *samples, int sample_limit, int pitch, uint8_t *data, int data_shift, int data_pitch, int filter_count) {
     psx_audio_encoder_channel_state_t proposed;
 	int64_t best_mse = ((int64_t)1<<(int64_t)50);
 	int best_filter = 0;
 	int best_sample_shift = 0;
 
+	pthread_once(&adpcm_kernel_once, adpcm_kernel_init);
+	if (adpcm_kernel != NULL && state->qerr == 0) {
+		// Gather the unit's samples
+		int16_t unit_samples[28];
+		for (int i = 0; i < 28; i++) {
+			unit_samples[i] = (i * pitch) >= sample_limit ? 0 : samples[i * pitch];
+		}
+
+		// Build candidates in the same order as the scalar loop below, padded to a whole vector
+		adpcm_candidates_t cand;
+		cand.count = 0;
+		for (int filter = 0; filter < filter_count; filter++) {
+			int true_min_shift = find_min_shift(state, unit_samples, 28, 1, filter);
+			int min_shift = true_min_shift - 1;
+			int max_shift = true_min_shift + 1;
+			if (min_shift < 0) { min_shift = 0; }
+			if (max_shift > 12) { max_shift = 12; }
+
+			for (int sample_shift = min_shift; sample_shift <= max_shift; sample_shift++) {
+				cand.filter[cand.count] = filter;
+				cand.shift[cand.count] = sample_shift;
+				cand.count++;
+			}
+		}
+		int count = cand.count;
+		while (cand.count & 7) {
+			cand.filter[cand.count] = 0;
+			cand.shift[cand.count] = 0;
+			cand.count++;
+		}
+		for (int j = 0; j < cand.count; j++) {
+			cand.k[j] = (filter_k1[cand.filter[j]] & 0xFFFF) | (filter_k2[cand.filter[j]] << 16);
+			cand.enc_mul[j] = 1 << cand.shift[j];
+			cand.dec_mul[j] = 1 << (12 - cand.shift[j]);
+		}
+
+		adpcm_kernel(&cand, unit_samples, state->prev1, state->prev2);
+
+		for (int j = 0; j < count; j++) {
+			if (best_mse > (int64_t)cand.mse[j]) {
+				best_mse = cand.mse[j];
+				best_filter = cand.filter[j];
+				best_sample_shift = cand.shift[j];
+			}
+		}
+
+		return attempt_to_encode_nibbles(
+			state, state,
+			samples, sample_limit, pitch,
+			data, data_shift, data_pitch,
+			best_filter, best_sample_shift);
+	}
+
 	for (int filter = 0; filter < filter_count; filter++) {
-		int true_min_shift = find_min_shift(state, samples, pitch, filter);
+		int true_min_shift = find_min_shift(state, samples, sample_limit, pitch, filter);
 
 		// Testing has shown that the optimal shift can be off the true minimum shift
 		// by 1 in *either* direction.
@@ -269,6 +499,198 @@ int psx_audio_xa_encode(psx_audio_xa_settings_t settings, psx_audio_encoder_stat
 	return (((j + 17) / 18) * xa_sector_size);
 }
 
+// Threaded XA encoding
+//
+// Each channel's sound units form one chain through prev1/prev2, and the left and right chains
+// are independent (mono alternates between the two states the same way). Every chain is split
+// into chunks which are encoded in parallel, each starting from the state left by encoding the
+// XA_MT_WARMUP units before it. The chunks are then fixed up in order: if a chunk's warm-up state
+// differs from the state the previous chunk really ended on, its units are re-encoded from the
+// real state until the state converges with the parallel result again, so the output is always
+// bit-identical to psx_audio_xa_encode.
+
+#define XA_MT_WARMUP 32
+#define XA_MT_MIN_CHUNK 256
+
+typedef struct {
+	uint8_t hdr;
+	uint8_t nibbles[28];
+	psx_audio_encoder_channel_state_t state; // state after this unit
+} xa_mt_unit_t;
+
+typedef struct {
+	int channel;
+	int start, end; // units
+	psx_audio_encoder_channel_state_t state; // state the chunk was started from
+} xa_mt_job_t;
+
+typedef struct {
+	psx_audio_xa_settings_t settings;
+	const psx_audio_encoder_state_t *state;
+	int16_t *samples;
+	int sample_count; // including both channels
+	xa_mt_unit_t *units[2];
+	xa_mt_job_t *jobs;
+	int job_count, job_next;
+	pthread_mutex_t lock;
+} xa_mt_context_t;
+
+static const uint8_t xa_mt_header_index[8] = {0, 1, 2, 3, 8, 9, 10, 11};
+
+static void xa_mt_encode_unit(xa_mt_context_t *ctx, int channel, int n, psx_audio_encoder_channel_state_t *state, xa_mt_unit_t *unit) {
+	// Unit n of a channel is unit (n%4)*2 + channel of block n/4
+	int u = ((n & 3) << 1) | channel;
+	int offset = (n >> 2) * 224 + (ctx->settings.stereo ? (56 * (u >> 1) + channel) : (28 * u));
+
+	memset(unit->nibbles, 0, sizeof(unit->nibbles));
+	unit->hdr = encode_nibbles(state, ctx->samples + offset, ctx->sample_count - offset, ctx->settings.stereo ? 2 : 1, unit->nibbles, 0, 1, XA_ADPCM_FILTER_COUNT);
+	unit->state = *state;
+}
+
+static bool xa_mt_state_equal(const psx_audio_encoder_channel_state_t *a, const psx_audio_encoder_channel_state_t *b) {
+	return a->prev1 == b->prev1 && a->prev2 == b->prev2 && a->qerr == b->qerr;
+}
+
+static void *xa_mt_worker(void *arg) {
+	xa_mt_context_t *ctx = (xa_mt_context_t*) arg;
+	xa_mt_unit_t scratch;
+
+	for (;;) {
+		pthread_mutex_lock(&ctx->lock);
+		int job_index = ctx->job_next++;
+		pthread_mutex_unlock(&ctx->lock);
+		if (job_index >= ctx->job_count) {
+			break;
+		}
+		xa_mt_job_t *job = &ctx->jobs[job_index];
+		xa_mt_unit_t *units = ctx->units[job->channel];
+
+		// Warm up from silence, or start from the real state at the start of the chain
+		psx_audio_encoder_channel_state_t state;
+		int warmup = job->start - XA_MT_WARMUP;
+		if (warmup <= 0) {
+			warmup = 0;
+			state = job->channel ? ctx->state->right : ctx->state->left;
+		} else {
+			memset(&state, 0, sizeof(state));
+		}
+		for (int n = warmup; n < job->start; n++) {
+			xa_mt_encode_unit(ctx, job->channel, n, &state, &scratch);
+		}
+		job->state = state;
+
+		for (int n = job->start; n < job->end; n++) {
+			xa_mt_encode_unit(ctx, job->channel, n, &state, &units[n]);
+		}
+	}
+
+	return NULL;
+}
+
+int psx_audio_xa_encode_threaded(psx_audio_xa_settings_t settings, psx_audio_encoder_state_t *state, int16_t* samples, int sample_count, uint8_t *output, int threads) {
+	int xa_sector_size = settings.format == PSX_AUDIO_XA_FORMAT_XA ? 2336 : 2352;
+	int xa_offset = 2352 - xa_sector_size;
+
+	if (settings.stereo) { sample_count <<= 1; }
+
+	// Same block count as the serial loop, rounded up to a whole sector
+	int blocks = ((sample_count + 223) / 224 + 17) / 18 * 18;
+	int unit_count = blocks * 4; // per channel
+
+	int chunks = threads;
+	if (chunks > unit_count / XA_MT_MIN_CHUNK) { chunks = unit_count / XA_MT_MIN_CHUNK; }
+	if (settings.bits_per_sample != 4 || chunks < 1) {
+		return psx_audio_xa_encode(settings, state, samples, settings.stereo ? (sample_count >> 1) : sample_count, output);
+	}
+
+	xa_mt_context_t ctx;
+	ctx.settings = settings;
+	ctx.state = state;
+	ctx.samples = samples;
+	ctx.sample_count = sample_count;
+	ctx.units[0] = malloc(sizeof(xa_mt_unit_t) * unit_count);
+	ctx.units[1] = malloc(sizeof(xa_mt_unit_t) * unit_count);
+	ctx.job_count = chunks * 2;
+	ctx.job_next = 0;
+	ctx.jobs = malloc(sizeof(xa_mt_job_t) * ctx.job_count);
+	pthread_t *thread = malloc(sizeof(pthread_t) * threads);
+	assert(ctx.units[0] != NULL && ctx.units[1] != NULL && ctx.jobs != NULL && thread != NULL);
+	pthread_mutex_init(&ctx.lock, NULL);
+
+	for (int i = 0; i < ctx.job_count; i++) {
+		ctx.jobs[i].channel = i % 2;
+		ctx.jobs[i].start = (int)((int64_t)unit_count * (i / 2) / chunks);
+		ctx.jobs[i].end = (int)((int64_t)unit_count * (i / 2 + 1) / chunks);
+	}
+
+	// Encode chunks
+	int thread_count = 0;
+	for (; thread_count < threads - 1; thread_count++) {
+		if (pthread_create(&thread[thread_count], NULL, xa_mt_worker, &ctx) != 0) {
+			break;
+		}
+	}
+	xa_mt_worker(&ctx);
+	for (int i = 0; i < thread_count; i++) {
+		pthread_join(thread[i], NULL);
+	}
+	pthread_mutex_destroy(&ctx.lock);
+
+	// Fix up chunks that didn't start from the real state
+	for (int i = 2; i < ctx.job_count; i++) {
+		xa_mt_job_t *job = &ctx.jobs[i];
+		xa_mt_unit_t *units = ctx.units[job->channel];
+		psx_audio_encoder_channel_state_t real = units[job->start - 1].state;
+		if (xa_mt_state_equal(&real, &job->state)) {
+			continue;
+		}
+		for (int n = job->start; n < job->end; n++) {
+			xa_mt_unit_t unit;
+			xa_mt_encode_unit(&ctx, job->channel, n, &real, &unit);
+			bool converged = xa_mt_state_equal(&unit.state, &units[n].state);
+			units[n] = unit;
+			if (converged) {
+				break;
+			}
+		}
+	}
+
+	// Assemble sectors
+	for (int j = 0; j < blocks; j++) {
+		uint8_t *sector_data = output + ((j/18) * xa_sector_size) - xa_offset;
+		uint8_t *block_data = sector_data + 0x18 + ((j%18) * 0x80);
+
+		if ((j%18) == 0) {
+			psx_audio_xa_encode_init_sector(sector_data, settings);
+		}
+
+		memset(block_data, 0, 0x80);
+		for (int u = 0; u < 8; u++) {
+			const xa_mt_unit_t *unit = &ctx.units[u & 1][j * 4 + (u >> 1)];
+			block_data[xa_mt_header_index[u]] = unit->hdr;
+			for (int i = 0; i < 28; i++) {
+				block_data[0x10 + (u >> 1) + i * 4] |= unit->nibbles[i] << ((u & 1) * 4);
+			}
+		}
+
+		memcpy(block_data + 4, block_data, 4);
+		memcpy(block_data + 12, block_data + 8, 4);
+
+		if ((j+1)%18 == 0) {
+			psx_cdrom_calculate_checksums(sector_data, PSX_CDROM_SECTOR_TYPE_MODE2_FORM2);
+		}
+	}
+
+	state->left = ctx.units[0][unit_count - 1].state;
+	state->right = ctx.units[1][unit_count - 1].state;
+
+	free(ctx.units[0]);
+	free(ctx.units[1]);
+	free(ctx.jobs);
+	free(thread);
+	return (blocks / 18) * xa_sector_size;
+}
+
 int psx_audio_xa_encode_finalize(psx_audio_xa_settings_t settings, uint8_t *output, int output_length) {
 	if (output_length >= 2336) {
 		output[output_length - 2352 + 0x12] |= 0x80;
@@ -25,10 +25,14 @@ This tool has been modified so that libpsxav isn't an external library
 
 #include "common.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 // high 8 bits = bit count
 // low 24 bits = value
 uint32_t huffman_encoding_map[0x10000];
-bool dct_done_init = false;
+static pthread_once_t dct_init_once = PTHREAD_ONCE_INIT;
 
 #define MAKE_HUFFMAN_PAIR(zeroes, value) (((zeroes)<<10)|((+(value))&0x3FF)),(((zeroes)<<10)|((-(value))&0x3FF))
 const struct {
@@ -295,12 +299,70 @@ static void encode_ac_value(vid_encoder_state_t *state, uint16_t value)
 #endif
 }
 
+#ifdef __SSE2__
+// Packs 8 values to 16 bits, returning false if any of them don't fit
+static inline bool pack_dct_row_sse2(const int32_t *row, __m128i *packed)
+{
+	__m128i lo = _mm_loadu_si128((const __m128i*)row);
+	__m128i hi = _mm_loadu_si128((const __m128i*)(row + 4));
+	*packed = _mm_packs_epi32(lo, hi);
+	__m128i lo_check = _mm_srai_epi32(_mm_unpacklo_epi16(*packed, *packed), 16);
+	__m128i hi_check = _mm_srai_epi32(_mm_unpackhi_epi16(*packed, *packed), 16);
+	__m128i same = _mm_and_si128(_mm_cmpeq_epi32(lo, lo_check), _mm_cmpeq_epi32(hi, hi_check));
+	return _mm_movemask_epi8(same) == 0xFFFF;
+}
+
+// Same passes as the scalar loop below, as 16x16->32 multiply-adds. The sums are exact, so the
+// result is identical, but it only applies while the block's values fit in 16 bits. Returns the
+// number of passes done.
+static int transform_dct_block_sse2(int32_t *block)
+{
+	__m128i scale[8];
+	for (int i = 0; i < 8; i++) {
+		scale[i] = _mm_loadu_si128((const __m128i*)(dct_scale_table + 8*i));
+	}
+
+	for (int reps = 0; reps < 2; reps++) {
+		__m128i rows[8];
+		for (int j = 0; j < 8; j++) {
+			if (!pack_dct_row_sse2(block + 8*j, &rows[j])) {
+				return reps;
+			}
+		}
+
+		// midblock[8*i+j] = sum over k of block[8*j+k]*dct_scale_table[8*i+k], four j at a time
+		int32_t midblock[8*8];
+		for (int i = 0; i < 8; i++) {
+		for (int j = 0; j < 8; j += 4) {
+			__m128i m0 = _mm_madd_epi16(rows[j+0], scale[i]);
+			__m128i m1 = _mm_madd_epi16(rows[j+1], scale[i]);
+			__m128i m2 = _mm_madd_epi16(rows[j+2], scale[i]);
+			__m128i m3 = _mm_madd_epi16(rows[j+3], scale[i]);
+			__m128i t0 = _mm_add_epi32(_mm_unpacklo_epi32(m0, m1), _mm_unpackhi_epi32(m0, m1));
+			__m128i t1 = _mm_add_epi32(_mm_unpacklo_epi32(m2, m3), _mm_unpackhi_epi32(m2, m3));
+			__m128i v = _mm_add_epi32(_mm_unpacklo_epi64(t0, t1), _mm_unpackhi_epi64(t0, t1));
+			v = _mm_srai_epi32(_mm_add_epi32(v, _mm_set1_epi32(1<<((14)-1))), 14);
+			_mm_storeu_si128((__m128i*)(midblock + 8*i + j), v);
+		}
+		}
+		memcpy(block, midblock, sizeof(midblock));
+	}
+
+	return 2;
+}
+#endif
+
 static void transform_dct_block(vid_encoder_state_t *state, int32_t *block)
 {
 	// Apply DCT to block
 	int32_t midblock[8*8];
 
-	for (int reps = 0; reps < 2; reps++) {
+#ifdef __SSE2__
+	int first_rep = transform_dct_block_sse2(block);
+#else
+	int first_rep = 0;
+#endif
+	for (int reps = first_rep; reps < 2; reps++) {
 		for (int i = 0; i < 8; i++) {
 		for (int j = 0; j < 8; j++) {
 			int32_t v = 0;
@@ -397,36 +459,26 @@ static int reduce_dct_block(vid_encoder_state_t *state, int32_t *block, int32_t
 	return nonzeroes+2;
 }
 
-static void encode_frame_str(uint8_t *video_frames, int video_frame_count, uint8_t *output, settings_t *settings)
+// Encodes one frame into state, using state->frame_block_count as its budget
+static void encode_frame_str(const uint8_t *video_frame, vid_encoder_state_t *state, settings_t *settings)
 {
 	int pitch = settings->video_width*4;
-	int real_index = (settings->state_vid.frame_index-1);
-	if (real_index > video_frame_count-1) {
-		real_index = video_frame_count-1;
-	}
-	//uint8_t *video_frame = video_frames + settings->video_width*settings->video_height*4*real_index;
-	uint8_t *video_frame = video_frames;
-
-	if (!dct_done_init) {
-		init_dct_data();
-		dct_done_init = true;
-	}
 
-	if (settings->state_vid.dct_block_lists[0] == NULL) {
+	if (state->dct_block_lists[0] == NULL) {
 		int dct_block_count_x = (settings->video_width+15)/16;
 		int dct_block_count_y = (settings->video_height+15)/16;
 		int dct_block_size = dct_block_count_x*dct_block_count_y*sizeof(int32_t)*8*8;
 		for (int i = 0; i < 6; i++) {
-			settings->state_vid.dct_block_lists[i] = malloc(dct_block_size);
+			state->dct_block_lists[i] = malloc(dct_block_size);
 		}
 	}
 
-	memset(settings->state_vid.unmuxed, 0, sizeof(settings->state_vid.unmuxed));
+	memset(state->unmuxed, 0, sizeof(state->unmuxed));
 
-	settings->state_vid.quant_scale = 1;
-	settings->state_vid.uncomp_hwords_used = 0;
-	settings->state_vid.bytes_used = 8;
-	settings->state_vid.blocks_used = 0;
+	state->quant_scale = 1;
+	state->uncomp_hwords_used = 0;
+	state->bytes_used = 8;
+	state->blocks_used = 0;
 
 	// TODO: non-16x16-aligned videos
 	assert((settings->video_width % 16) == 0);
@@ -438,12 +490,12 @@ static void encode_frame_str(uint8_t *video_frames, int video_frame_count, uint8
 		// Order: Cr Cb [Y1|Y2\nY3|Y4]
 		int block_offs = 8*8*((fy>>4)*((settings->video_width+15)/16)+(fx>>4));
 		int32_t *blocks[6] = {
-			settings->state_vid.dct_block_lists[0] + block_offs,
-			settings->state_vid.dct_block_lists[1] + block_offs,
-			settings->state_vid.dct_block_lists[2] + block_offs,
-			settings->state_vid.dct_block_lists[3] + block_offs,
-			settings->state_vid.dct_block_lists[4] + block_offs,
-			settings->state_vid.dct_block_lists[5] + block_offs,
+			state->dct_block_lists[0] + block_offs,
+			state->dct_block_lists[1] + block_offs,
+			state->dct_block_lists[2] + block_offs,
+			state->dct_block_lists[3] + block_offs,
+			state->dct_block_lists[4] + block_offs,
+			state->dct_block_lists[5] + block_offs,
 		};
 
 		for(int y = 0; y < 8; y++) {
@@ -490,7 +542,7 @@ static void encode_frame_str(uint8_t *video_frames, int video_frame_count, uint8
 		}
 		}
 		for(int i = 0; i < 6; i++) {
-			transform_dct_block(&(settings->state_vid), blocks[i]);
+			transform_dct_block(state, blocks[i]);
 		}
 	}
 	}
@@ -498,8 +550,8 @@ static void encode_frame_str(uint8_t *video_frames, int video_frame_count, uint8
 	// Now reduce all the blocks
 	// TODO: Base this on actual bit count
 	//const int accum_threshold = 6500;
-	const int accum_threshold = 1025*settings->state_vid.frame_block_count;
-	//const int accum_threshold = 900*settings->state_vid.frame_block_count;
+	const int accum_threshold = 1025*state->frame_block_count;
+	//const int accum_threshold = 900*state->frame_block_count;
 	int values_to_shed = 0;
 	for(int min_val = 0;; min_val += 1) {
 		int accum = 0;
@@ -508,17 +560,17 @@ static void encode_frame_str(uint8_t *video_frames, int video_frame_count, uint8
 			// Order: Cr Cb [Y1|Y2\nY3|Y4]
 			int block_offs = 8*8*((fy>>4)*((settings->video_width+15)/16)+(fx>>4));
 			int32_t *blocks[6] = {
-				settings->state_vid.dct_block_lists[0] + block_offs,
-				settings->state_vid.dct_block_lists[1] + block_offs,
-				settings->state_vid.dct_block_lists[2] + block_offs,
-				settings->state_vid.dct_block_lists[3] + block_offs,
-				settings->state_vid.dct_block_lists[4] + block_offs,
-				settings->state_vid.dct_block_lists[5] + block_offs,
+				state->dct_block_lists[0] + block_offs,
+				state->dct_block_lists[1] + block_offs,
+				state->dct_block_lists[2] + block_offs,
+				state->dct_block_lists[3] + block_offs,
+				state->dct_block_lists[4] + block_offs,
+				state->dct_block_lists[5] + block_offs,
 			};
 			const int luma_reduce_mul = 8;
 			const int chroma_reduce_mul = 8;
 			for(int i = 6-1; i >= 0; i--) {
-				accum += reduce_dct_block(&(settings->state_vid), blocks[i], (i < 2 ? min_val*luma_reduce_mul+1 : min_val*chroma_reduce_mul+1), &values_to_shed);
+				accum += reduce_dct_block(state, blocks[i], (i < 2 ? min_val*luma_reduce_mul+1 : min_val*chroma_reduce_mul+1), &values_to_shed);
 			}
 		}
 		}
@@ -536,40 +588,165 @@ static void encode_frame_str(uint8_t *video_frames, int video_frame_count, uint8
 		// Order: Cr Cb [Y1|Y2\nY3|Y4]
 		int block_offs = 8*8*((fy>>4)*((settings->video_width+15)/16)+(fx>>4));
 		int32_t *blocks[6] = {
-			settings->state_vid.dct_block_lists[0] + block_offs,
-			settings->state_vid.dct_block_lists[1] + block_offs,
-			settings->state_vid.dct_block_lists[2] + block_offs,
-			settings->state_vid.dct_block_lists[3] + block_offs,
-			settings->state_vid.dct_block_lists[4] + block_offs,
-			settings->state_vid.dct_block_lists[5] + block_offs,
+			state->dct_block_lists[0] + block_offs,
+			state->dct_block_lists[1] + block_offs,
+			state->dct_block_lists[2] + block_offs,
+			state->dct_block_lists[3] + block_offs,
+			state->dct_block_lists[4] + block_offs,
+			state->dct_block_lists[5] + block_offs,
 		};
 		for(int i = 0; i < 6; i++) {
-			encode_dct_block(&(settings->state_vid), blocks[i]);
+			encode_dct_block(state, blocks[i]);
 		}
 	}
 	}
 
-	encode_bits(&(settings->state_vid), 10, 0x1FF);
-	encode_bits(&(settings->state_vid), 2, 0x2);
-	settings->state_vid.uncomp_hwords_used += 2;
-	settings->state_vid.uncomp_hwords_used = (settings->state_vid.uncomp_hwords_used+0xF)&~0xF;
+	encode_bits(state, 10, 0x1FF);
+	encode_bits(state, 2, 0x2);
+	state->uncomp_hwords_used += 2;
+	state->uncomp_hwords_used = (state->uncomp_hwords_used+0xF)&~0xF;
 
-	flush_bits(&(settings->state_vid));
+	flush_bits(state);
 
-	settings->state_vid.blocks_used = ((settings->state_vid.uncomp_hwords_used+0xF)&~0xF)>>4;
+	state->blocks_used = ((state->uncomp_hwords_used+0xF)&~0xF)>>4;
 
 	// We need a multiple of 4
-	settings->state_vid.bytes_used = (settings->state_vid.bytes_used+0x3)&~0x3;
+	state->bytes_used = (state->bytes_used+0x3)&~0x3;
 
 	// Build the demuxed header
-	settings->state_vid.unmuxed[0x000] = (uint8_t)settings->state_vid.blocks_used;
-	settings->state_vid.unmuxed[0x001] = (uint8_t)(settings->state_vid.blocks_used>>8);
-	settings->state_vid.unmuxed[0x002] = (uint8_t)0x00;
-	settings->state_vid.unmuxed[0x003] = (uint8_t)0x38;
-	settings->state_vid.unmuxed[0x004] = (uint8_t)settings->state_vid.quant_scale;
-	settings->state_vid.unmuxed[0x005] = (uint8_t)(settings->state_vid.quant_scale>>8);
-	settings->state_vid.unmuxed[0x006] = 0x02; // Version 2
-	settings->state_vid.unmuxed[0x007] = 0x00;
+	state->unmuxed[0x000] = (uint8_t)state->blocks_used;
+	state->unmuxed[0x001] = (uint8_t)(state->blocks_used>>8);
+	state->unmuxed[0x002] = (uint8_t)0x00;
+	state->unmuxed[0x003] = (uint8_t)0x38;
+	state->unmuxed[0x004] = (uint8_t)state->quant_scale;
+	state->unmuxed[0x005] = (uint8_t)(state->quant_scale>>8);
+	state->unmuxed[0x006] = 0x02; // Version 2
+	state->unmuxed[0x007] = 0x00;
+}
+
+// Frame-level threading
+//
+// Frames only depend on their own pixels and on their block budget, which follows a fixed sequence,
+// so the frames already decoded are encoded ahead of the muxer on one thread each. They stay in
+// settings->video_frames until they are muxed, so the muxing loop sees exactly the same frame counts
+// as when encoding them one at a time.
+
+typedef struct {
+	settings_t *settings;
+	int count;
+	int next;
+	pthread_mutex_t lock;
+} frame_job_str_t;
+
+static void *encode_frame_worker_str(void *arg)
+{
+	frame_job_str_t *job = (frame_job_str_t*) arg;
+	settings_t *settings = job->settings;
+	vid_frame_queue_t *queue = &(settings->queue_vid);
+
+	for (;;) {
+		pthread_mutex_lock(&(job->lock));
+		int i = job->next++;
+		pthread_mutex_unlock(&(job->lock));
+		if (i >= job->count) {
+			break;
+		}
+		encode_frame_str(settings->video_frames + settings->decoder_state_av.video_frame_dst_size*i, &(queue->frames[i]), settings);
+	}
+
+	return NULL;
+}
+
+void init_frame_queue_str(settings_t *settings)
+{
+	vid_frame_queue_t *queue = &(settings->queue_vid);
+
+	pthread_once(&dct_init_once, init_dct_data);
+
+	queue->slots = settings->threads;
+	queue->frames = calloc(queue->slots, sizeof(vid_encoder_state_t));
+	assert(queue->frames != NULL);
+	for (int i = 0; i < queue->slots; i++) {
+		queue->frames[i].bits_value = 0;
+		queue->frames[i].bits_left = 16;
+	}
+	queue->head = 0;
+	queue->count = 0;
+	queue->frame_block_overflow_num = settings->state_vid.frame_block_overflow_num;
+}
+
+void free_frame_queue_str(settings_t *settings)
+{
+	vid_frame_queue_t *queue = &(settings->queue_vid);
+
+	for (int i = 0; i < queue->slots; i++) {
+		for (int j = 0; j < 6; j++) {
+			free(queue->frames[i].dct_block_lists[j]);
+		}
+	}
+	free(queue->frames);
+	queue->frames = NULL;
+}
+
+static void encode_frames_str(settings_t *settings)
+{
+	vid_frame_queue_t *queue = &(settings->queue_vid);
+
+	// Decode ahead, the muxing loop still stops at the same frame if this hits the end of the input
+	ensure_av_data(settings, 0, queue->slots);
+
+	frame_job_str_t job;
+	job.settings = settings;
+	job.count = settings->video_frame_count;
+	if (job.count > queue->slots) {
+		job.count = queue->slots;
+	}
+	if (job.count < 1) {
+		job.count = 1;
+	}
+	job.next = 0;
+
+	for (int i = 0; i < job.count; i++) {
+		// Same budget sequence as encode_block_str
+		queue->frame_block_overflow_num += settings->state_vid.frame_block_base_overflow;
+		queue->frames[i].frame_block_count = queue->frame_block_overflow_num / settings->state_vid.frame_block_overflow_den;
+		queue->frame_block_overflow_num %= settings->state_vid.frame_block_overflow_den;
+	}
+
+	pthread_mutex_init(&(job.lock), NULL);
+	pthread_t thread[job.count];
+	int thread_count = 0;
+	for (; thread_count < job.count - 1; thread_count++) {
+		if (pthread_create(&thread[thread_count], NULL, encode_frame_worker_str, &job) != 0) {
+			break;
+		}
+	}
+	encode_frame_worker_str(&job);
+	for (int i = 0; i < thread_count; i++) {
+		pthread_join(thread[i], NULL);
+	}
+	pthread_mutex_destroy(&(job.lock));
+
+	queue->head = 0;
+	queue->count = job.count;
+}
+
+// Moves the next encoded frame into settings->state_vid for muxing
+static void next_frame_str(settings_t *settings)
+{
+	vid_frame_queue_t *queue = &(settings->queue_vid);
+
+	if (queue->count == 0) {
+		encode_frames_str(settings);
+	}
+
+	vid_encoder_state_t *frame = &(queue->frames[queue->head++]);
+	queue->count--;
+	assert(frame->frame_block_count == settings->state_vid.frame_block_count);
+	memcpy(settings->state_vid.unmuxed, frame->unmuxed, sizeof(frame->unmuxed));
+	settings->state_vid.bytes_used = frame->bytes_used;
+	settings->state_vid.blocks_used = frame->blocks_used;
+	settings->state_vid.quant_scale = frame->quant_scale;
 
 	retire_av_data(settings, 0, 1);
 }
@@ -588,7 +765,7 @@ void encode_block_str(uint8_t *video_frames, int video_frame_count, uint8_t *out
 			settings->state_vid.frame_block_count = settings->state_vid.frame_block_overflow_num / settings->state_vid.frame_block_overflow_den;
 			settings->state_vid.frame_block_overflow_num %= settings->state_vid.frame_block_overflow_den;
 			settings->state_vid.frame_block_index = 0;
-			encode_frame_str(video_frames, video_frame_count, output, settings);
+			next_frame_str(settings);
 		}
 		// Header: MDEC0 register
 		header[0x000] = 0x60;
@@ -26,7 +26,8 @@ This tool has been modified so that libpsxav isn't an external library
 #include "common.h"
 
 void print_help(void) {
-	fprintf(stderr, "Usage: psxavenc [-f freq] [-b bitdepth] [-c channels] [-F num] [-C num] [-t xa|xacd|spu|str2] <in> <out>\n\n");
+	fprintf(stderr, "Usage: psxavenc [-f freq] [-b bitdepth] [-c channels] [-F num] [-C num] [-T threads] [-t xa|xacd|spu|str2] <in> <out>\n");
+	fprintf(stderr, "       psxavenc [-T workers] -B manifest\n\n");
 	fprintf(stderr, "    -f freq          Use specified frequency\n");
 	fprintf(stderr, "    -t format        Use specified output type:\n");
 	fprintf(stderr, "                       xa     [A.] .xa 2336-byte sectors\n");
@@ -37,11 +38,14 @@ void print_help(void) {
 	fprintf(stderr, "    -c channels      Use specified channel count (1 or 2)\n");
 	fprintf(stderr, "    -F num           [.xa] Set the file number to num (0-255)\n");
 	fprintf(stderr, "    -C num           [.xa] Set the channel number to num (0-31)\n");
+	fprintf(stderr, "    -T threads       [.xa] Encode using this many threads (default: all cores)\n");
+	fprintf(stderr, "    -B manifest      Encode every \"<in> <out> <format> [options]\" line of manifest\n");
+	fprintf(stderr, "                     (- for stdin), -T files at a time (default: all cores)\n");
 }
 
 int parse_args(settings_t* settings, int argc, char** argv) {
 	int c;
-	while ((c = getopt(argc, argv, "t:f:b:c:F:C:")) != -1) {
+	while ((c = getopt(argc, argv, "t:f:b:c:F:C:T:B:")) != -1) {
 		switch (c) {
 			case 't': {
 				if (strcmp(optarg, "xa") == 0) {
@@ -89,6 +93,16 @@ int parse_args(settings_t* settings, int argc, char** argv) {
 					return -1;
 				}
 			} break;
+			case 'T': {
+				settings->threads = atoi(optarg);
+				if (settings->threads < 1) {
+					fprintf(stderr, "Invalid thread count: %d\n", settings->threads);
+					return -1;
+				}
+			} break;
+			case 'B': {
+				settings->batch_path = optarg;
+			} break;
 			case '?':
 			case 'h': {
 				print_help();
@@ -111,79 +125,295 @@ int parse_args(settings_t* settings, int argc, char** argv) {
 	return optind;
 }
 
-int main(int argc, char **argv) {
-	settings_t settings;
-	int arg_offset;
-	FILE* output;
-
-	memset(&settings,0,sizeof(settings_t));
+static void init_settings(settings_t *settings) {
+	memset(settings,0,sizeof(settings_t));
 
-	settings.file_number = 0;
-	settings.channel_number = 0;
-	settings.stereo = true;
-	settings.frequency = PSX_AUDIO_XA_FREQ_DOUBLE;
-	settings.bits_per_sample = 4;
+	settings->file_number = 0;
+	settings->channel_number = 0;
+	settings->stereo = true;
+	settings->frequency = PSX_AUDIO_XA_FREQ_DOUBLE;
+	settings->bits_per_sample = 4;
+	settings->threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if (settings->threads < 1) {
+		settings->threads = 1;
+	}
 
-	settings.video_width = 320;
-	settings.video_height = 240;
+	settings->video_width = 320;
+	settings->video_height = 240;
 
-	settings.audio_samples = NULL;
-	settings.audio_sample_count = 0;
-	settings.video_frames = NULL;
-	settings.video_frame_count = 0;
+	settings->audio_samples = NULL;
+	settings->audio_sample_count = 0;
+	settings->video_frames = NULL;
+	settings->video_frame_count = 0;
 
 	// TODO: make this adjustable
 	// also for some reason ffmpeg seems to hard-code the framerate to 15fps
-	settings.video_fps_num = 15;
-	settings.video_fps_den = 1;
+	settings->video_fps_num = 15;
+	settings->video_fps_den = 1;
 	for(int i = 0; i < 6; i++) {
-		settings.state_vid.dct_block_lists[i] = NULL;
-	}
-
-	arg_offset = parse_args(&settings, argc, argv);
-	if (arg_offset < 0) {
-		return 1;
-	} else if (argc < arg_offset + 2) {
-		print_help();
-		return 1;
+		settings->state_vid.dct_block_lists[i] = NULL;
 	}
+}
 
-	fprintf(stderr, "Using settings: %d Hz @ %d bit depth, %s. F%d C%d\n",
-		settings.frequency, settings.bits_per_sample,
-		settings.stereo ? "stereo" : "mono",
-		settings.file_number, settings.channel_number
-	);
+static int encode_file(settings_t *settings, const char *input_path, const char *output_path) {
+	FILE* output;
+	int status = 1;
 
-	bool did_open_data = open_av_data(argv[arg_offset + 0], &settings);
+	bool did_open_data = open_av_data(input_path, settings);
 	if (!did_open_data) {
-		fprintf(stderr, "Could not open input file!\n");
+		fprintf(stderr, "Could not open input file %s!\n", input_path);
 		return 1;
 	}
 
-	output = fopen(argv[arg_offset + 1], "wb");
+	output = fopen(output_path, "wb");
 	if (output == NULL) {
-		fprintf(stderr, "Could not open output file!\n");
+		fprintf(stderr, "Could not open output file %s!\n", output_path);
+		close_av_data(settings);
 		return 1;
 	}
 
-	int av_sample_mul = settings.stereo ? 2 : 1;
-
-	switch (settings.format) {
+	switch (settings->format) {
 		case FORMAT_XA:
 		case FORMAT_XACD:
-			pull_all_av_data(&settings);
-			encode_file_xa(settings.audio_samples, settings.audio_sample_count / av_sample_mul, &settings, output);
+			status = encode_file_xa(settings, output);
 			break;
 		case FORMAT_SPU:
-			pull_all_av_data(&settings);
-			encode_file_spu(settings.audio_samples, settings.audio_sample_count / av_sample_mul, &settings, output);
+			status = encode_file_spu(settings, output);
 			break;
 		case FORMAT_STR2:
-			encode_file_str(&settings, output);
+			status = encode_file_str(settings, output);
+			break;
+	}
+
+	if (ferror(output)) {
+		fprintf(stderr, "Could not write output file %s!\n", output_path);
+		status = 1;
+	}
+	if (fclose(output) != 0 && status == 0) {
+		fprintf(stderr, "Could not write output file %s!\n", output_path);
+		status = 1;
+	}
+	close_av_data(settings);
+
+	// Don't leave a partial file behind for make to think is up to date
+	if (status != 0) {
+		remove(output_path);
+	}
+	return status;
+}
+
+// Batch mode
+//
+// Every line of the manifest is "<in> <out> <format> [options]", taking the same options as the
+// command line. The files are encoded on a pool of workers in this process, one file per worker,
+// so the decoders and encoder tables are only set up once.
+
+#define BATCH_MAX_ARGS 64
+
+typedef struct {
+	settings_t settings;
+	char *input_path;
+	char *output_path;
+	int status;
+	double time;
+} batch_job_t;
+
+typedef struct {
+	batch_job_t *jobs;
+	int job_count;
+	int job_next;
+	int jobs_done;
+	pthread_mutex_t lock;
+} batch_state_t;
+
+static double get_time(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static double get_audio_seconds(settings_t *settings) {
+	if (settings->format == FORMAT_STR2) {
+		return 0.0;
+	}
+	return (double)settings->stream_state_av.total_samples / (settings->stereo ? 2 : 1) / settings->frequency;
+}
+
+static void *batch_worker(void *arg) {
+	batch_state_t *batch = (batch_state_t*) arg;
+
+	for (;;) {
+		pthread_mutex_lock(&batch->lock);
+		int job_index = batch->job_next++;
+		pthread_mutex_unlock(&batch->lock);
+		if (job_index >= batch->job_count) {
+			break;
+		}
+		batch_job_t *job = &batch->jobs[job_index];
+
+		double start = get_time();
+		job->status = encode_file(&job->settings, job->input_path, job->output_path);
+		job->time = get_time() - start;
+
+		pthread_mutex_lock(&batch->lock);
+		batch->jobs_done++;
+		fprintf(stderr, "[%d/%d] %s -> %s: ", batch->jobs_done, batch->job_count, job->input_path, job->output_path);
+		if (job->status != 0) {
+			fprintf(stderr, "FAILED\n");
+		} else if (get_audio_seconds(&job->settings) > 0.0) {
+			double audio_seconds = get_audio_seconds(&job->settings);
+			fprintf(stderr, "%.2f s, %.1f s of audio (%.1fx realtime)\n", job->time, audio_seconds, audio_seconds / job->time);
+		} else {
+			fprintf(stderr, "%.2f s\n", job->time);
+		}
+		pthread_mutex_unlock(&batch->lock);
+	}
+
+	return NULL;
+}
+
+static int parse_batch(const char *path, batch_job_t **jobs_out) {
+	FILE *manifest = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+	if (manifest == NULL) {
+		fprintf(stderr, "Could not open manifest %s!\n", path);
+		return -1;
+	}
+
+	batch_job_t *jobs = NULL;
+	int job_count = 0;
+	char line[4096];
+	for (int line_number = 1; fgets(line, sizeof(line), manifest) != NULL; line_number++) {
+		char *argv[BATCH_MAX_ARGS + 3];
+		int argc = 0;
+		char *save;
+
+		// Tokens: in, out, format, options
+		char *input_path = strtok_r(line, " \t\r\n", &save);
+		if (input_path == NULL || input_path[0] == '#') {
+			continue;
+		}
+		char *output_path = strtok_r(NULL, " \t\r\n", &save);
+		char *format = strtok_r(NULL, " \t\r\n", &save);
+		if (output_path == NULL || format == NULL) {
+			fprintf(stderr, "%s:%d: expected <in> <out> <format> [options]\n", path, line_number);
+			job_count = -1;
+			break;
+		}
+
+		argv[argc++] = "psxavenc";
+		argv[argc++] = "-t";
+		argv[argc++] = format;
+		char *token;
+		while ((token = strtok_r(NULL, " \t\r\n", &save)) != NULL && argc < BATCH_MAX_ARGS) {
+			argv[argc++] = token;
+		}
+		argv[argc] = NULL;
+
+		jobs = realloc(jobs, (job_count + 1) * sizeof(batch_job_t));
+		batch_job_t *job = &jobs[job_count];
+		init_settings(&job->settings);
+		job->settings.threads = 1; // Parallel over files by default, -T still applies per line
+
+		optind = 1;
+		if (parse_args(&job->settings, argc, argv) != argc || job->settings.batch_path != NULL) {
+			fprintf(stderr, "%s:%d: invalid options\n", path, line_number);
+			job_count = -1;
+			break;
+		}
+		job->input_path = strdup(input_path);
+		job->output_path = strdup(output_path);
+		job->status = 0;
+		job->time = 0.0;
+		job_count++;
+	}
+
+	if (manifest != stdin) {
+		fclose(manifest);
+	}
+	*jobs_out = jobs;
+	return job_count;
+}
+
+static int encode_batch(const char *path, int threads) {
+	batch_state_t batch;
+
+	batch.job_count = parse_batch(path, &batch.jobs);
+	if (batch.job_count < 0) {
+		return 1;
+	}
+	batch.job_next = 0;
+	batch.jobs_done = 0;
+	pthread_mutex_init(&batch.lock, NULL);
+
+	if (threads > batch.job_count) {
+		threads = batch.job_count;
+	}
+	fprintf(stderr, "Encoding %d files on %d workers, %s ADPCM kernel\n", batch.job_count, threads, psx_audio_get_adpcm_kernel_name());
+
+	double start = get_time();
+	pthread_t *thread = malloc(sizeof(pthread_t) * threads);
+	int thread_count = 0;
+	for (; thread_count < threads - 1; thread_count++) {
+		if (pthread_create(&thread[thread_count], NULL, batch_worker, &batch) != 0) {
 			break;
+		}
 	}
+	batch_worker(&batch);
+	for (int i = 0; i < thread_count; i++) {
+		pthread_join(thread[i], NULL);
+	}
+	double time = get_time() - start;
+
+	int failed = 0;
+	double job_time = 0.0;
+	double audio_seconds = 0.0;
+	for (int i = 0; i < batch.job_count; i++) {
+		batch_job_t *job = &batch.jobs[i];
+		if (job->status != 0) {
+			failed++;
+		} else {
+			audio_seconds += get_audio_seconds(&job->settings);
+		}
+		job_time += job->time;
+		free(job->input_path);
+		free(job->output_path);
+	}
+	fprintf(stderr, "Encoded %d files (%d failed) in %.2f s (%.2f s of work): %.1f s of audio, %.1fx realtime\n",
+		batch.job_count - failed, failed, time, job_time, audio_seconds, time > 0.0 ? audio_seconds / time : 0.0
+	);
+
+	pthread_mutex_destroy(&batch.lock);
+	free(thread);
+	free(batch.jobs);
+	return failed != 0;
+}
+
+int main(int argc, char **argv) {
+	settings_t settings;
+	int arg_offset;
+
+	init_settings(&settings);
+
+	arg_offset = parse_args(&settings, argc, argv);
+	if (arg_offset < 0) {
+		return 1;
+	} else if (settings.batch_path != NULL) {
+		if (arg_offset != argc) {
+			print_help();
+			return 1;
+		}
+		return encode_batch(settings.batch_path, settings.threads);
+	} else if (argc < arg_offset + 2) {
+		print_help();
+		return 1;
+	}
+
+	fprintf(stderr, "Using settings: %d Hz @ %d bit depth, %s. F%d C%d, %s ADPCM kernel\n",
+		settings.frequency, settings.bits_per_sample,
+		settings.stereo ? "stereo" : "mono",
+		settings.file_number, settings.channel_number,
+		psx_audio_get_adpcm_kernel_name()
+	);
 
-	fclose(output);
-	close_av_data(&settings);
-	return 0;
+	return encode_file(&settings, argv[arg_offset + 0], argv[arg_offset + 1]);
 }
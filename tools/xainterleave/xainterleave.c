@@ -29,6 +29,13 @@ This tool has been modified to only use 'just XA' mode, refer to .txt file autom
 
 #define ENTRY_MAX 64
 
+#define SECTOR_SIZE 2336
+#define READ_SECTORS 256 // sectors read from each input per fread
+#define WRITE_SIZE (1 << 20) // whole interleave chunks are gathered into writes of about this size
+#define VERIFY_MAX_ERRORS 8 // errors reported per input before going quiet
+
+#define INDEX_MAGIC 0x31494158 // "XAI1"
+
 #define TYPE_NULL 0
 #define TYPE_RAW 1
 #define TYPE_XA 2
@@ -38,9 +45,26 @@ typedef struct {
 	int sectors, type;
 
 	FILE *file;
+	char *path;
+
+	// Input is read READ_SECTORS at a time
+	uint8_t *buffer;
+	int buffer_sectors, buffer_pos;
+	int drained; // nothing left in the file
+	int eof; // a sector read has failed
 
 	int xa_file;
 	int xa_channel;
+
+	// For the track index, in output sectors
+	int read_sectors;
+	int first_sector, end_sector;
+	int coding;
+
+	// For --verify, the input's file/channel numbers and what they're written as
+	int in_file, in_channel;
+	int out_file, out_channel;
+	int errors;
 } entry_t;
 
 static entry_t entries[ENTRY_MAX];
@@ -59,6 +83,10 @@ int parse(char *filename) {
 	cute[1] = '\0';
 
 	while (fscanf(file, " %d %64s", &(e.sectors), type_str) > 0) {
+		if (entry_count >= ENTRY_MAX) { fprintf(stderr, "Too many entries\n"); return 0; }
+		e.file = NULL;
+		e.path = NULL;
+		e.buffer = NULL;
 		if (strcmp(type_str, "null") == 0) e.type = TYPE_NULL;
 		else if (strcmp(type_str, "raw") == 0) e.type = TYPE_RAW;
 		else if (strcmp(type_str, "xacd") == 0) e.type = TYPE_XACD;
@@ -69,14 +97,29 @@ int parse(char *filename) {
 			case TYPE_RAW:
 			case TYPE_XA:
 			case TYPE_XACD:
+				if (e.type != TYPE_XA) {
+					// Only 'just XA' mode is supported, which can't hold raw sectors
+					fprintf(stderr, "Can only write raw sectors in raw sector mode\n");
+					return 0;
+				}
 				if (fscanf(file, " %256s", fn_str) > 0) {
 					char *npath = malloc(strlen(filename) + strlen(fn_str) + 1);
 					if (npath == NULL)
 						return 0;
 					sprintf(npath, "%s%s", filename, fn_str);
 					e.file = fopen(npath, "rb");
-					free(npath);
-					if (e.file == NULL) return 0;
+					if (e.file == NULL) {
+						fprintf(stderr, "Could not open %s\n", npath);
+						free(npath);
+						return 0;
+					}
+					e.path = npath;
+
+					// Reads go straight into our own buffer
+					setvbuf(e.file, NULL, _IONBF, 0);
+					e.buffer = malloc(READ_SECTORS * SECTOR_SIZE);
+					if (e.buffer == NULL)
+						return 0;
 				} else return 0;
 				break;
 		}
@@ -93,6 +136,19 @@ int parse(char *filename) {
 				break;
 		}
 
+		e.buffer_sectors = 0;
+		e.buffer_pos = 0;
+		e.drained = 0;
+		e.eof = 0;
+		e.read_sectors = 0;
+		e.first_sector = 0;
+		e.end_sector = 0;
+		e.coding = 0;
+		e.in_file = 0;
+		e.in_channel = 0;
+		e.out_file = 0;
+		e.out_channel = 0;
+		e.errors = 0;
 		entries[entry_count] = e;
 		entry_count++;
 	}
@@ -101,16 +157,144 @@ int parse(char *filename) {
 	return entry_count;
 }
 
+static void write_u32(FILE *file, uint32_t x) {
+	fputc(x & 0xFF, file);
+	fputc((x >> 8) & 0xFF, file);
+	fputc((x >> 16) & 0xFF, file);
+	fputc((x >> 24) & 0xFF, file);
+}
+
+static int samples_per_sector(int coding) {
+	// Coding info byte: bit 0 stereo, bit 4 8-bit
+	return (((coding & 0x10) ? 112 : 224) * 18) >> ((coding & 0x01) ? 1 : 0);
+}
+
+// Writes <out>.idx, giving where each XA channel starts and ends in the output
+static int write_index(const char *path, int entry_count) {
+	char *idxpath = malloc(strlen(path) + 5);
+	sprintf(idxpath, "%s.idx", path);
+	FILE *index = fopen(idxpath, "wb");
+	if (index == NULL) {
+		fprintf(stderr, "Could not open %s\n", idxpath);
+		free(idxpath);
+		return 0;
+	}
+
+	int channel_count = 0;
+	for (int i = 0; i < entry_count; i++) {
+		if (entries[i].type == TYPE_XA || entries[i].type == TYPE_XACD) channel_count++;
+	}
+
+	write_u32(index, INDEX_MAGIC);
+	write_u32(index, channel_count);
+	for (int i = 0; i < entry_count; i++) {
+		entry_t *e = &entries[i];
+		if (e->type != TYPE_XA && e->type != TYPE_XACD) continue;
+
+		int samples = e->read_sectors * samples_per_sector(e->coding);
+		fputc(e->xa_channel & 0x1F, index);
+		fputc(e->xa_file & 0xFF, index);
+		fputc(0, index);
+		fputc(0, index);
+		write_u32(index, e->first_sector);
+		write_u32(index, e->end_sector);
+		write_u32(index, e->read_sectors);
+		write_u32(index, samples);
+		if (ferror(index)) break;
+		printf("Channel %d: sectors %d-%d, %d sectors, %d samples\n", e->xa_channel, e->first_sector, e->end_sector, e->read_sectors, samples);
+	}
+
+	// ferror stays set after any failed fputc, so this covers every write above
+	int failed = ferror(index);
+	if (fclose(index) != 0) failed = 1;
+	if (failed) {
+		fprintf(stderr, "Could not write %s\n", idxpath);
+		remove(idxpath);
+	}
+	free(idxpath);
+	return !failed;
+}
+
+// Returns the next sector of an input, or NULL once it's run out
+static const uint8_t *read_sector(entry_t *e) {
+	if (e->buffer_pos >= e->buffer_sectors) {
+		e->buffer_pos = 0;
+		e->buffer_sectors = e->drained ? 0 : (int)fread(e->buffer, SECTOR_SIZE, READ_SECTORS, e->file);
+		if (e->buffer_sectors < READ_SECTORS) e->drained = 1; // a trailing partial sector is dropped
+		if (e->buffer_sectors == 0) {
+			e->eof = 1;
+			return NULL;
+		}
+	}
+	return e->buffer + SECTOR_SIZE * e->buffer_pos++;
+}
+
+static void verify_error(entry_t *e, int out_sector, const char *msg) {
+	if (e->errors++ < VERIFY_MAX_ERRORS)
+		fprintf(stderr, "%s: sector %d (output sector %d): %s\n", e->path, e->read_sectors - 1, out_sector, msg);
+}
+
+// Checks an input sector, before its subheader is rewritten, against the input's first sector
+static void verify_sector(entry_t *e, const uint8_t *sector, int out_sector) {
+	// Subheader: file, channel, submode, coding info, then the same again
+	if (memcmp(sector, sector + 4, 4) != 0)
+		verify_error(e, out_sector, "subheader copies differ");
+	if ((sector[2] & 0x24) != 0x24)
+		verify_error(e, out_sector, "submode isn't form 2 audio");
+	if (sector[3] & 0xAA)
+		verify_error(e, out_sector, "reserved coding info bits set");
+
+	if (e->read_sectors == 1) {
+		e->in_file = sector[0];
+		e->in_channel = sector[1];
+		return;
+	}
+	if (sector[3] != e->coding)
+		verify_error(e, out_sector, "coding info changes mid-channel");
+	if (sector[0] != e->in_file || sector[1] != e->in_channel)
+		verify_error(e, out_sector, "file/channel number changes mid-channel");
+}
+
+// Checks no two inputs share a file/channel number, returns the total number of errors
+static int verify_entries(int entry_count) {
+	int errors = 0;
+	for (int i = 0; i < entry_count; i++) {
+		entry_t *e = &entries[i];
+		if (e->type != TYPE_XA) continue;
+
+		if (e->read_sectors == 0) {
+			fprintf(stderr, "%s: no sectors\n", e->path);
+			errors++;
+		}
+		if (e->errors > VERIFY_MAX_ERRORS)
+			fprintf(stderr, "%s: %d more errors\n", e->path, e->errors - VERIFY_MAX_ERRORS);
+		errors += e->errors;
+
+		for (int j = 0; j < i; j++) {
+			entry_t *o = &entries[j];
+			if (o->type != TYPE_XA || o->read_sectors == 0 || e->read_sectors == 0) continue;
+			if (o->out_file == e->out_file && o->out_channel == e->out_channel) {
+				fprintf(stderr, "%s: file %d channel %d is already used by %s\n", e->path, e->out_file, e->out_channel, o->path);
+				errors++;
+			}
+		}
+	}
+	return errors;
+}
+
 int main(int argc, char** argv) {
-	uint8_t buffer[2352];
+	int verify = 0;
+	if (argc >= 2 && strcmp(argv[1], "--verify") == 0) {
+		verify = 1;
+		argc--;
+		argv++;
+	}
 
 	if (argc < 2) {
-		fprintf(stderr, "Usage: xainterleave <out.xa>\n");
+		fprintf(stderr, "Usage: xainterleave [--verify] <out.xa>\n");
 		return 1;
 	}
 
-	int mode = 1; //Just XA
-
 	char *txtpath = malloc(strlen(argv[1]) + 5);
 	sprintf(txtpath, "%s.txt", argv[1]);
 
@@ -128,66 +312,95 @@ int main(int argc, char** argv) {
 	}
 	printf("Interleaving into %d-sector chunks\n", sector_div);
 
+	// Whole chunks are built in memory and written out together
+	int chunk_count = WRITE_SIZE / (sector_div * SECTOR_SIZE);
+	if (chunk_count < 1) chunk_count = 1;
+	uint8_t *chunk = malloc(chunk_count * sector_div * SECTOR_SIZE);
+	if (chunk == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
 	FILE *output = fopen(argv[1], "wb");
+	if (output == NULL) {
+		fprintf(stderr, "Could not open %s\n", argv[1]);
+		return 1;
+	}
+	int out_sector = 0;
 
-	while (1) {
-		int can_read = 0;
-		for (int i = 0; i < entry_count; i++) {
-			entry_t *e = &entries[i];
-			if (e->file != NULL) {
-				if (!feof(e->file)) can_read++;
-			}
-		}
-		if (can_read <= 0) break;
-
-		for (int i = 0; i < entry_count; i++) {
-			entry_t *e = &entries[i];
-			for (int is = 0; is < e->sectors; is++) {
-				int write_null = 0;
-				switch (e->type) {
-					case TYPE_NULL:
-						write_null = 1;
-						break;
-					case TYPE_RAW:
-						if (mode != 0) {
-							fprintf(stderr, "Can only write raw sectors in raw sector mode\n");
-							return 1;
-						}
-						if (!fread(buffer, 2352, 1, e->file)) { write_null = 1; break; }
-						fwrite(buffer, 2352, 1, output);
-						break;
-					case TYPE_XA:
-					case TYPE_XACD:
-						if (e->type == TYPE_XACD) {
-							if (mode != 0) {
-								fprintf(stderr, "Can only write raw sectors in raw sector mode\n");
-								return 1;
-							}
-							if (!fread(buffer, 2352, 1, e->file)) { write_null = 1; break; }
-						} else {
-							if (!fread(buffer + 0x10, 2336, 1, e->file)) { write_null = 1; break; }
-							memset(buffer, 0, 15);
-							buffer[15] = 0x02;
-						}
-						if (e->xa_file >= 0) buffer[0x010] = buffer[0x014] = e->xa_file;
-						if (e->xa_channel >= 0) buffer[0x011] = buffer[0x015] = e->xa_channel & 0x1F;
-						buffer[0x92F] = 0xFF; // make pscd-new generate EDC
-						if (mode == 0) {
-							fwrite(buffer, 2352, 1, output);
-						}
-						else if (mode == 1) {
-							fwrite(buffer + 0x10, 2336, 1, output);
-						}
-						break;
+	int done = 0;
+	while (!done) {
+		uint8_t *out = chunk;
+		for (int c = 0; c < chunk_count; c++) {
+			// Keep going until every input has had a read fail
+			int can_read = 0;
+			for (int i = 0; i < entry_count; i++) {
+				entry_t *e = &entries[i];
+				if (e->file != NULL) {
+					if (!e->eof) can_read++;
 				}
+			}
+			if (can_read <= 0) { done = 1; break; }
+
+			for (int i = 0; i < entry_count; i++) {
+				entry_t *e = &entries[i];
+				for (int is = 0; is < e->sectors; is++, out += SECTOR_SIZE, out_sector++) {
+					const uint8_t *sector = NULL;
+					if (e->type == TYPE_XA)
+						sector = read_sector(e);
+					if (sector == NULL) {
+						memset(out, 0, SECTOR_SIZE);
+						continue;
+					}
 
-				if (write_null) {
-					for (int j = 0; j < (mode == 0 ? 2352 : 2336); j++) fputc(0, output);
+					if (e->read_sectors++ == 0) {
+						e->first_sector = out_sector;
+						e->coding = sector[0x003];
+					}
+					e->end_sector = out_sector + 1;
+					if (verify)
+						verify_sector(e, sector, out_sector);
+
+					memcpy(out, sector, SECTOR_SIZE);
+					if (e->xa_file >= 0) out[0x000] = out[0x004] = e->xa_file;
+					if (e->xa_channel >= 0) out[0x001] = out[0x005] = e->xa_channel & 0x1F;
+					out[SECTOR_SIZE - 1] = 0xFF; // make pscd-new generate EDC
+					if (e->read_sectors == 1) {
+						e->out_file = out[0x000];
+						e->out_channel = out[0x001];
+					}
 				}
 			}
 		}
+
+		if (out != chunk && fwrite(chunk, out - chunk, 1, output) != 1) {
+			fprintf(stderr, "Could not write %s\n", argv[1]);
+			fclose(output);
+			return 1;
+		}
+	}
+
+	free(chunk);
+	for (int i = 0; i < entry_count; i++) {
+		entry_t *e = &entries[i];
+		if (e->file != NULL) fclose(e->file);
+		free(e->buffer);
 	}
 
-	fclose(output);
+	if (fclose(output) != 0) {
+		fprintf(stderr, "Could not write %s\n", argv[1]);
+		return 1;
+	}
+	if (!write_index(argv[1], entry_count)) {
+		return 1;
+	}
+	if (verify) {
+		int errors = verify_entries(entry_count);
+		if (errors > 0) {
+			fprintf(stderr, "%d verify errors\n", errors);
+			return 1;
+		}
+		printf("Verified %d sectors\n", out_sector);
+	}
 	return 0;
 }